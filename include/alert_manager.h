@@ -35,6 +35,41 @@ struct AlertConfig {
  */
 void alert_init();
 
+/**
+ * @brief Limit alert energy (energy governor)
+ *
+ * Applies to the window in progress and to later ones; (0, FIVE) plays
+ * ALERT_CONFIGS unchanged.
+ *
+ * @param cadence_shift Seconds between bursts x 2^n
+ * @param max_pattern Longest burst played
+ */
+void alert_set_limits(uint8_t cadence_shift, BeepPattern max_pattern);
+
+/**
+ * Alert window kept across a warm reset (warm_state.h)
+ */
+struct AlertWarmState {
+    uint32_t alert_start_tick;
+    uint32_t last_beep_tick;
+    WaterLevel level;
+    bool active;
+    bool started;
+};
+
+/**
+ * @brief Copy out the alert window in progress
+ */
+void alert_save_warm(AlertWarmState& out);
+
+/**
+ * @brief Resume a saved alert window (after alert_init())
+ *
+ * @param in Saved window
+ * @param tick_shift Added to its ticks (new time base - saved time base)
+ */
+void alert_restore_warm(const AlertWarmState& in, uint32_t tick_shift);
+
 /**
  * @brief Update alert manager with new water level
  *
@@ -45,11 +80,11 @@ void alert_init();
 void alert_on_level_change(WaterLevel level);
 
 /**
- * @brief Update alert manager (call every 10s tick)
+ * @brief Update alert manager (call every wake)
  *
  * Manages alert timing, triggers beep patterns, and handles window expiration
  *
- * @param tick Current tick counter (increments every 10 seconds)
+ * @param tick Current tick counter in seconds (rtc_get_ticks())
  * @return true if alert is active (for keeping VDD_SW on during beeping)
  */
 bool alert_update(uint32_t tick);
@@ -69,9 +104,20 @@ void alert_silence();
  */
 bool alert_is_active();
 
+/**
+ * @brief Get tick of the next alert action
+ *
+ * Next beep burst (per the level's cadence) or window expiry, whichever
+ * is earlier. Only meaningful while alert_is_active().
+ *
+ * @return Tick (seconds) at which alert_update() next has work to do
+ */
+uint32_t alert_next_event_tick();
+
 /**
  * @brief Get time remaining in current alert window
  *
+ * @param tick Current tick counter in seconds
  * @return Seconds remaining in current alert, 0 if no active alert
  */
-uint16_t alert_get_remaining_sec();
+uint16_t alert_get_remaining_sec(uint32_t tick);
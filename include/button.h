@@ -7,6 +7,9 @@
  * - Hold on boot (≥5s): Factory reset
  * - Short press: Silence current alert
  *
+ * Press and release edges are timestamped from the RTC counter in the
+ * pin-change ISR; events are reported on release and wake the main loop.
+ *
  * Note: Button shares pin with UPDI programmer.
  * Button connects to PA0 via 220Ω series resistor.
  * Internal pull-up enabled, button connects to GND when pressed.
@@ -23,22 +26,27 @@ enum class ButtonEvent : uint8_t {
     NONE = 0,
     SHORT_PRESS,      // < 3 seconds
     LONG_PRESS,       // ≥ 3 seconds (calibration)
-    BOOT_HOLD,        // ≥ 5 seconds on boot (factory reset)
+    BOOT_HOLD,        // ≥ 5 seconds, held since boot (factory reset)
 };
 
 /**
  * @brief Initialize button
  *
- * Configures PA0 as input with pull-up and enables pin change interrupt
+ * Configures PA0 as input with pull-up and enables pin change interrupt.
+ * Call after rtc_init() with interrupts still disabled; a button already
+ * held at this point counts as a boot hold.
+ *
+ * @param boot_hold false after a warm reset: a press held through it (e.g.
+ *        silencing when the beep browned out the cell) is a normal press
  */
-void button_init();
+void button_init(bool boot_hold = true);
 
 /**
- * @brief Check button state and return events
+ * @brief Take the pending button event
  *
- * Call this periodically (e.g., every 10s wake or more frequently during active monitoring)
+ * Call on every wake; a release flags WAKE_BUTTON (see power.h)
  *
- * @return ButtonEvent if detected, NONE otherwise
+ * @return ButtonEvent of the last release, NONE otherwise
  */
 ButtonEvent button_check();
 
@@ -49,22 +57,12 @@ ButtonEvent button_check();
  */
 bool button_is_pressed();
 
-/**
- * @brief Wait for button press with timeout (blocking)
- *
- * Used during boot to detect 5-second hold for factory reset
- *
- * @param timeout_ms Maximum time to wait
- * @return true if button was pressed within timeout
- */
-bool button_wait_pressed(uint16_t timeout_ms);
-
 /**
  * @brief Get button press duration
  *
- * Returns how long button has been pressed (in approximate deciseconds)
- * Used to distinguish short/long/boot presses
+ * Returns how long the button has been held so far, from the RTC
+ * timestamp of the press edge
  *
- * @return Duration in ~100ms units (deciseconds)
+ * @return Duration in ~100ms units (deciseconds), saturating at 255; 0 if released
  */
 uint8_t button_get_press_duration();
@@ -2,51 +2,105 @@
  * @file buzzer.h
  * @brief PWM tone generation for piezo buzzer via DRV8210
  *
- * Generates ~2.7 kHz tone using TCA0 WO0 on PA3
- * Beep patterns: 2, 3, or 5 beeps (100 ms each) with 100 ms gaps
+ * Generates the piezo tone using TCA0 WO0 on PA3: nominally 3.8 kHz,
+ * or the resonance found by buzzer_tune() in calibration mode
+ *
+ * Every sound is a pattern: a few bytes of tone / silence / loop / pitch
+ * ops in a flash table (buzzer.cpp), played by the TCB0 interrupt.
+ * Alert bursts are 2, 3 or 5 beeps (100 ms each) with 100 ms gaps; a
+ * single beep is the low-battery chirp; calibration results and sensor
+ * errors have their own two-pitch patterns.
  */
 
 #pragma once
 
 #include <stdint.h>
 
+// Nominal drive frequency (piezo datasheet resonance)
+constexpr uint16_t BUZZER_FREQ_HZ = 3800;
+
 /**
- * Beep patterns (number of beeps in burst)
+ * Beep patterns (index into the pattern table)
+ *
+ * Alert bursts keep value = number of beeps, so the energy caps
+ * (EnergyPolicy::max_pattern) order them by length.
  */
 enum class BeepPattern : uint8_t {
     NONE = 0,
-    DOUBLE = 2,   // Low level
-    TRIPLE = 3,   // Very-Low level
-    FIVE = 5,     // Critical level
+    LOW_BATTERY = 1,  // Single chirp: cell sagging (governor.h)
+    DOUBLE = 2,       // Low level
+    TRIPLE = 3,       // Very-Low level
+    FIVE = 5,         // Critical level
+    CAL_OK = 6,       // Calibration saved: low-high chirp
+    CAL_FAIL = 7,     // Calibration rejected: long low tone
+    SENSOR_ERROR = 8, // Level went to ERROR: high-low buzz
+    CAPTURE_OK = 9,   // Boot capture step starts: short blip (main.cpp)
 };
 
 /**
  * @brief Initialize buzzer PWM
  *
- * Configures TCA0 for ~2.7 kHz PWM output on PA3 (DRV_IN1)
+ * Configures TCA0 for 50 % duty PWM output on PA3 (DRV_IN1)
  * PWM starts disabled
+ *
+ * @param period TCA0 period from buzzer_tune() (NvmConfig::buzzer_per);
+ *               0 or a value outside the tuning band selects the nominal
+ *               BUZZER_FREQ_HZ
  */
-void buzzer_init();
+void buzzer_init(uint16_t period = 0);
+
+/**
+ * @brief Find the piezo resonance
+ *
+ * Sweeps the drive frequency over ±25 % of BUZZER_FREQ_HZ (coarse, then
+ * fine around the best point; ~0.3 s of chirping) and measures the supply
+ * droop at each point with power_measure_supply(). The droop is weighted
+ * by the period to cancel the capacitive current that grows with
+ * frequency; the peak is where the piezo draws the most motional current,
+ * i.e. where it is loudest.
+ *
+ * Requires VDD_SW on and no pattern playing. The chosen period stays
+ * selected for later beeps.
+ *
+ * @return Tuned TCA0 period, or 0 if no droop was measurable (supply too
+ *         stiff or piezo open); the previous period is kept then
+ */
+uint16_t buzzer_tune();
 
 /**
  * @brief Start beep pattern
  *
- * Begins playing the specified pattern
- * Non-blocking - call buzzer_update() in main loop to advance pattern
+ * Begins playing the specified pattern, cutting off one still playing
+ * Non-blocking - the pattern is sequenced by the TCB0 interrupt
+ * (global interrupts must be enabled)
  *
- * @param pattern Number of beeps to play
+ * @param pattern Pattern to play (NONE stops the buzzer)
  */
 void buzzer_start(BeepPattern pattern);
 
 /**
- * @brief Update buzzer state machine
+ * @brief Sleep until the next buzzer phase edge (or any other interrupt)
+ *
+ * Enters IDLE sleep so TCA0/TCB0 keep running; restores STANDBY as the
+ * sleep mode on return. Returns immediately if no pattern is playing.
+ */
+void buzzer_sleep();
+
+/**
+ * @brief Block (in IDLE sleep) until the current pattern completes
+ */
+void buzzer_wait();
+
+/**
+ * @brief Silence guaranteed to remain in the current inter-beep gap
  *
- * Call this regularly from main loop (every ~1 ms or so)
- * Manages beep timing and pattern sequencing
+ * Lets callers fit work that must not overlap the tone (sensor
+ * conversions) into the gaps of a burst.
  *
- * @return true if still playing, false if pattern complete
+ * @return Milliseconds left in the gap (lower bound), 0 during a beep or
+ *         when no pattern is playing
  */
-bool buzzer_update();
+uint16_t buzzer_gap_left_ms();
 
 /**
  * @brief Stop buzzer immediately
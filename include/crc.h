@@ -0,0 +1,48 @@
+/**
+ * @file crc.h
+ * @brief Bitwise CRCs for the EEPROM journal and the warm-reset block
+ *
+ * Table-free (flash over speed); the blocks checked are a few dozen bytes.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @brief CRC-16/XMODEM
+ *
+ * Polynomial 0x1021 (x^16 + x^12 + x^5 + 1), initial value 0x0000
+ */
+static inline uint16_t crc16_xmodem(const uint8_t* data, uint16_t length) {
+    uint16_t crc = 0x0000;
+
+    for (uint16_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            if (crc & 0x8000) {
+                crc = (crc << 1) ^ 0x1021;
+            } else {
+                crc = crc << 1;
+            }
+        }
+    }
+
+    return crc;
+}
+
+/**
+ * @brief CRC-8 (polynomial 0x07, initial value 0x00)
+ */
+static inline uint8_t crc8(const uint8_t* data, uint8_t length) {
+    uint8_t crc = 0x00;
+
+    for (uint8_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+
+    return crc;
+}
@@ -4,9 +4,17 @@
  *
  * Stores:
  * - Thresholds (low, very-low, critical)
- * - Calibration baseline values
+ * - Calibration baseline values (with their tracked drift) and the
+ *   reference CAPDAC offset
  * - Hysteresis settings
  * - Installation validation flag
+ * - Level-transition / alert event history
+ *
+ * The EEPROM is an append-only journal of 8-byte, sequence-numbered
+ * records rotating over the whole array (wear levelling). Config changes
+ * are written as deltas of the 4-byte chunks that changed; a chunk whose
+ * only copy is about to be overwritten is copied forward first. On boot
+ * the newest valid record is located and the config is replayed.
  */
 
 #pragma once
@@ -18,7 +26,7 @@
  * Total size: ~24 bytes (well under 64-byte ATtiny202 EEPROM limit)
  */
 struct __attribute__((packed)) NvmConfig {
-    uint16_t version;           // Config version (0x0001)
+    uint16_t version;           // Config version (0x0002)
     uint16_t th_low_ff;         // Low threshold (femtofarads)
     uint16_t th_vlow_ff;        // Very-Low threshold (fF)
     uint16_t th_crit_ff;        // Critical threshold (fF)
@@ -27,12 +35,18 @@ struct __attribute__((packed)) NvmConfig {
     int16_t  base_c2_ff;        // Baseline CIN2-CIN4 (fF)
     int16_t  base_c3_ff;        // Baseline CIN3-CIN4 (fF)
     uint8_t  calibration_valid; // 1 if calibration performed, 0 otherwise
-    uint8_t  reserved[5];       // Reserved for future use
+    uint16_t buzzer_per;        // Tuned TCA0 period for the piezo (0 = nominal)
+    uint8_t  ref_capdac;        // CAPDAC offset of the CIN4 reference (fdc1004.h steps, 0 = off)
+    uint16_t drift_steps;       // Net baseline drift since calibration (level_logic, 5 bits/channel)
     uint16_t crc16;             // CRC-16/XMODEM checksum
 };
 
 // Config version
-constexpr uint16_t NVM_CONFIG_VERSION = 0x0001;
+constexpr uint16_t NVM_CONFIG_VERSION = 0x0002;
+
+// Single-ended readings, trip below the threshold itself: calibration is
+// dropped on migration, thresholds and piezo tuning are kept
+constexpr uint16_t NVM_CONFIG_VERSION_SINGLE_ENDED = 0x0001;
 
 // Factory defaults
 constexpr NvmConfig FACTORY_DEFAULTS = {
@@ -45,30 +59,56 @@ constexpr NvmConfig FACTORY_DEFAULTS = {
     .base_c2_ff = 0,
     .base_c3_ff = 0,
     .calibration_valid = 0,
-    .reserved = {0},
+    .buzzer_per = 0,
+    .ref_capdac = 0,
+    .drift_steps = 0,
     .crc16 = 0  // Will be calculated
 };
 
+/**
+ * Journaled event types
+ */
+enum class NvmEvent : uint8_t {
+    LEVEL_CHANGE = 0,    // arg = new WaterLevel
+    ALERT_SILENCED = 1,  // arg = WaterLevel being alerted
+    ENERGY_TIER = 2,     // arg = EnergyTier entered (governor.h)
+};
+
+/**
+ * Event record as read back from the journal
+ */
+struct NvmEventRecord {
+    uint32_t tick;  // rtc_get_ticks() when logged (seconds since boot)
+    NvmEvent event;
+    uint8_t arg;
+};
+
 /**
  * @brief Initialize EEPROM config module
  *
- * Loads configuration from EEPROM and validates CRC
- * If invalid, loads factory defaults
+ * Scans the journal for the newest valid record and replays the config.
+ * Falls back to a pre-journal config block, then to factory defaults,
+ * and writes every config chunk if the journal is empty. A config from
+ * single-ended firmware loses its calibration and must be recalibrated.
  */
 void eeprom_init();
 
 /**
  * @brief Load configuration from EEPROM
  *
+ * Replays the journal's config records, oldest to newest.
+ *
  * @param config Pointer to structure to fill
- * @return true if loaded and CRC valid, false otherwise
+ * @return true if a journal was found and the result is valid (possibly
+ *         an older version, migrated by eeprom_init())
  */
 bool eeprom_load(NvmConfig* config);
 
 /**
  * @brief Save configuration to EEPROM
  *
- * Calculates CRC before writing
+ * Journals only the bytes that differ from the current config
+ * (4-byte chunks), so small changes cost one or two records.
  *
  * @param config Pointer to configuration to save
  * @return true if saved successfully
@@ -78,6 +118,8 @@ bool eeprom_save(const NvmConfig* config);
 /**
  * @brief Factory reset - write defaults to EEPROM
  *
+ * Rewrites every config chunk with the defaults; event history is kept.
+ *
  * @return true if successful
  */
 bool eeprom_factory_reset();
@@ -85,20 +127,95 @@ bool eeprom_factory_reset();
 /**
  * @brief Get current configuration
  *
- * Returns cached copy (loaded at init or last save)
+ * Read-only view of the config replayed at init and kept current by
+ * saves; no copy is made. Replay takes only records whose CRC-8 checks
+ * (a migrated legacy block is checked against its CRC-16); the crc16
+ * field of the view is recomputed, not read back.
  *
- * @param config Pointer to structure to fill
+ * The view is a 24-byte RAM copy rather than a pointer into mapped
+ * EEPROM: the journal holds the config as chunks scattered over the
+ * ring, so there is no contiguous image to map, and the copy-forward
+ * in saves needs every chunk's current value at hand.
+ *
+ * @return Current configuration
  */
-void eeprom_get_config(NvmConfig* config);
+const NvmConfig& eeprom_config();
 
 /**
  * @brief Update calibration values
  *
- * Convenience function to update only calibration data
+ * Convenience function to update only calibration data. Rejected unless
+ * every baseline is within ±5 pF, above 200 fF and above its channel's
+ * threshold plus hysteresis (full-tank readings, trip = baseline - threshold).
+ *
+ * @param c1_ff CIN1-CIN4 baseline (fF)
+ * @param c2_ff CIN2-CIN4 baseline (fF)
+ * @param c3_ff CIN3-CIN4 baseline (fF)
+ * @param ref_capdac CAPDAC offset for the CIN4 reference measurement
+ * @return true if saved successfully
+ */
+bool eeprom_update_calibration(int16_t c1_ff, int16_t c2_ff, int16_t c3_ff,
+                               uint8_t ref_capdac);
+
+/**
+ * @brief Update the baseline after drift tracking
+ *
+ * Keeps the CAPDAC offset and the calibration flag; same range checks as
+ * eeprom_update_calibration(). Only the changed chunks are journaled.
  *
  * @param c1_ff CIN1-CIN4 baseline (fF)
  * @param c2_ff CIN2-CIN4 baseline (fF)
  * @param c3_ff CIN3-CIN4 baseline (fF)
+ * @param drift_steps Net drift since calibration (from level_baseline_drift())
  * @return true if saved successfully
  */
-bool eeprom_update_calibration(int16_t c1_ff, int16_t c2_ff, int16_t c3_ff);
+bool eeprom_update_baseline(int16_t c1_ff, int16_t c2_ff, int16_t c3_ff, uint16_t drift_steps);
+
+/**
+ * @brief Update the tuned buzzer period
+ *
+ * @param period TCA0 period from buzzer_tune() (0 = nominal)
+ * @return true if saved successfully
+ */
+bool eeprom_update_buzzer_period(uint16_t period);
+
+/**
+ * @brief Append an event record to the journal
+ *
+ * @param event Event type
+ * @param arg Event argument (e.g. WaterLevel)
+ * @param tick Timestamp (rtc_get_ticks())
+ * @return true if written
+ */
+bool eeprom_log_event(NvmEvent event, uint8_t arg, uint32_t tick);
+
+/**
+ * @brief Read back a journaled event
+ *
+ * Only events still in the ring are available (oldest are overwritten).
+ *
+ * @param index 0 = newest, 1 = the one before, ...
+ * @param record Pointer to structure to fill
+ * @return true if the event exists
+ */
+bool eeprom_get_event(uint8_t index, NvmEventRecord* record);
+
+/**
+ * @brief Append an instrumentation counter value to the journal
+ *
+ * Counter records age out of the ring like events.
+ *
+ * @param index Counter index (0-31)
+ * @param value Counter value
+ * @return true if written
+ */
+bool eeprom_log_counter(uint8_t index, uint32_t value);
+
+/**
+ * @brief Read back the newest journaled value of a counter
+ *
+ * @param index Counter index (0-31)
+ * @param value Pointer to fill
+ * @return true if the ring holds a value for the counter
+ */
+bool eeprom_get_counter(uint8_t index, uint32_t* value);
@@ -2,11 +2,13 @@
  * @file fdc1004.h
  * @brief Driver for TI FDC1004 capacitive sensor
  *
- * Differential capacitance measurement:
+ * One conversion set, four measurements:
  * - MEAS1: CIN1 - CIN4 (Low level)
  * - MEAS2: CIN2 - CIN4 (Very-Low level)
  * - MEAS3: CIN3 - CIN4 (Critical level)
- * - CIN4 is the "always-wet" reference electrode
+ * - MEAS4: CIN4 single-ended, minus the CAPDAC offset (reference check)
+ * - CIN4 is the "always-wet" reference electrode; the differential
+ *   measurements cancel the parasitic capacitance it shares with CIN1-3
  */
 
 #pragma once
@@ -20,61 +22,164 @@ constexpr uint8_t FDC1004_ADDR = 0x50;
  * FDC1004 measurement channels
  */
 enum class FdcChannel : uint8_t {
-    C1 = 0,  // CIN1 - CIN4
-    C2 = 1,  // CIN2 - CIN4
-    C3 = 2,  // CIN3 - CIN4
+    C1 = 0,   // CIN1 - CIN4
+    C2 = 1,   // CIN2 - CIN4
+    C3 = 2,   // CIN3 - CIN4
+    REF = 3,  // CIN4 (- CAPDAC)
 };
 
+// Number of level channels (MEAS1-3)
+constexpr uint8_t FDC_NUM_CHANNELS = 3;
+
+// Measurements per conversion set (level channels + CIN4 reference)
+constexpr uint8_t FDC_NUM_READINGS = 4;
+constexpr uint8_t FDC_REF = static_cast<uint8_t>(FdcChannel::REF);
+
+// Upper bound for the device to ACK after VDD_SW is enabled
+constexpr uint16_t FDC_POWERUP_TIMEOUT_MS = 10;
+
+// Sample rate (S/s): 100, 200 or 400. Faster rates are noisier per
+// conversion but shorten the rail-on time of each set
+#ifndef FDC_SAMPLE_RATE
+#define FDC_SAMPLE_RATE 100
+#endif
+static_assert(FDC_SAMPLE_RATE == 100 || FDC_SAMPLE_RATE == 200 || FDC_SAMPLE_RATE == 400,
+              "FDC1004 rates are 100, 200 and 400 S/s");
+
+// Conversion sets averaged per fdc_measure_all() (1 = single shot, more =
+// repeat-mode burst); sqrt(n) less noise for n times the conversion time
+#ifndef FDC_BURST_SETS
+#define FDC_BURST_SETS 1
+#endif
+static_assert(FDC_BURST_SETS >= 1 && FDC_BURST_SETS <= 16, "Burst of 1..16 sets");
+
+// Conversion time of one measurement at FDC_SAMPLE_RATE
+constexpr uint16_t FDC_CONVERSION_US = 1000000UL / FDC_SAMPLE_RATE;
+
+// Conversion time of a batched 4-measurement set (4 × 10 ms @ 100 S/s)
+constexpr uint16_t FDC_MEASURE_ALL_MS = (FDC_NUM_READINGS * (uint32_t)FDC_CONVERSION_US + 999) / 1000;
+
+// Timeout for a batched conversion set (conversion time + margin)
+constexpr uint16_t FDC_MEASURE_ALL_TIMEOUT_MS = FDC_MEASURE_ALL_MS + 20;
+
+// CAPDAC offset of the CIN4 reference (CIN4 - n × 3.125 pF, n = 0..31)
+// for a reference that sits high in the ±15 pF input range; 0 = none.
+// The FDC1004 takes the CAPDAC in place of CHB, so the differential
+// MEAS1-3 cannot use it (nor need it)
+constexpr uint16_t FDC_CAPDAC_STEP_FF = 3125;
+constexpr uint8_t FDC_CAPDAC_MAX = 31;
+
 /**
  * Measurement result
  */
 struct FdcReading {
-    int16_t capacitance_ff;  // Capacitance in femtofarads (fF)
-    bool valid;              // True if reading is valid
+    int32_t raw;  // 24-bit signed result code (sign-extended)
+    bool valid;   // True if reading is valid
 };
 
+/**
+ * Result code scaling: ±15 pF over the 24-bit signed range
+ * capacitance_fF = raw * 15000 / 2^23 = raw * 1875 / 2^20
+ *
+ * Both conversions stay within 32 bits (no 64-bit libgcc helpers).
+ * Level logic works in raw codes; fF is for calibration/diagnostics only.
+ */
+constexpr int16_t fdc_raw_to_ff(int32_t raw) {
+    return (int16_t)(((raw >> 4) * 1875) >> 16);
+}
+
+constexpr int32_t fdc_ff_to_raw(int16_t ff) {
+    return (int32_t)ff * 65536 / 1875 * 16;
+}
+
 /**
  * @brief Initialize FDC1004
  *
- * - Verifies device ID
- * - Configures for differential mode
- * - Sets sample rate to 100 S/s (best SNR)
+ * - Polls for the first ACK after power-up (bounded by FDC_POWERUP_TIMEOUT_MS);
+ *   without one, frees a stuck bus (twi_recover()) and probes again
+ * - Verifies device ID (cold boot or after an I2C error only)
+ * - Programs CONF_MEAS1..3 (CINx - CIN4) and CONF_MEAS4 (CIN4 with the
+ *   fdc_set_ref_capdac() offset); the rate is set when triggering
  *
  * @return true if initialization successful
  */
 bool fdc_init();
 
+/**
+ * @brief Select the CAPDAC offset of the CIN4 reference measurement
+ *
+ * Takes effect at the next fdc_init() (every rail-up programs CONF_MEASx).
+ *
+ * @param steps Offset in FDC_CAPDAC_STEP_FF steps (clamped to
+ *              FDC_CAPDAC_MAX); 0 disables the offset
+ */
+void fdc_set_ref_capdac(uint8_t steps);
+
 /**
  * @brief Trigger single-shot measurement on specified channel
  *
- * Configures the measurement (CINx - CIN4) and starts conversion
+ * Starts conversion of the measurement configured by fdc_init()
  *
  * @param ch Channel to measure
  * @return true if trigger successful
  */
 bool fdc_trigger_measurement(FdcChannel ch);
 
+/**
+ * @brief Trigger single-shot measurement of a full conversion set
+ *
+ * Enables MEAS1-4 with a single FDC_CONF write (CONF_MEAS1..4 are
+ * programmed by fdc_init()). The FDC1004 converts them back-to-back.
+ *
+ * @return true if trigger successful
+ */
+bool fdc_trigger_all();
+
 /**
  * @brief Wait for measurement to complete
  *
- * Polls DONE flag until measurement ready
- * Expected time: ~10 ms @ 100 S/s
+ * Sleeps (STANDBY, RTC compare wake) for the expected conversion time of the
+ * configured rate, then checks the DONE flags of all triggered measurements.
+ * Falls back to polling FDC_CONF every 100 us if the RTC wake timer is not
+ * running or the conversion overruns.
+ * Expected time: FDC_CONVERSION_US per channel (10 ms @ 100 S/s)
  *
  * @param timeout_ms Maximum time to wait
  * @return true if measurement completed within timeout
  */
 bool fdc_wait_ready(uint16_t timeout_ms);
 
+/**
+ * @brief Check once whether the triggered measurements are complete
+ *
+ * Non-blocking alternative to fdc_wait_ready() for callers that sleep
+ * through the conversion themselves (one FDC_CONF read).
+ *
+ * @param done Set to true once every triggered DONE bit is set
+ * @return false on I2C failure
+ */
+bool fdc_poll_ready(bool* done);
+
 /**
  * @brief Read measurement result
  *
- * Reads the result register and converts to femtofarads
+ * Reads the 24-bit result code (use fdc_raw_to_ff() for femtofarads)
  *
  * @param ch Channel to read
- * @return FdcReading structure with capacitance and validity
+ * @return FdcReading structure with result code and validity
  */
 FdcReading fdc_read_result(FdcChannel ch);
 
+/**
+ * @brief Read the results of a conversion set (level channels and CIN4)
+ *
+ * A channel whose read fails is marked invalid; the others are still read.
+ *
+ * @param readings Array filled with results, indexed by FdcChannel
+ * @return true if all four readings are valid
+ */
+bool fdc_read_all(FdcReading readings[FDC_NUM_READINGS]);
+
 /**
  * @brief Perform complete measurement sequence
  *
@@ -86,10 +191,30 @@ FdcReading fdc_read_result(FdcChannel ch);
  */
 FdcReading fdc_measure(FdcChannel ch, uint16_t timeout_ms = 20);
 
+/**
+ * @brief Measure a full conversion set in one trigger/wait/read cycle
+ *
+ * With FDC_BURST_SETS > 1 the FDC1004 runs in repeat mode and each
+ * channel's result is the mean of the sets read (a set whose read fails
+ * for a channel is left out; the channel is invalid only if every read
+ * failed). Repeat mode is stopped before returning.
+ *
+ * A conversion set that fails (trigger, DONE timeout) is re-triggered
+ * once, then once more after fdc_soft_reset(). Register transactions are
+ * retried once after twi_recover() throughout the driver.
+ *
+ * @param readings Array filled with results, indexed by FdcChannel
+ * @param timeout_ms Timeout for wait
+ * @return true if all four readings are valid
+ */
+bool fdc_measure_all(FdcReading readings[FDC_NUM_READINGS],
+                     uint16_t timeout_ms = FDC_MEASURE_ALL_TIMEOUT_MS);
+
 /**
  * @brief Software reset FDC1004
  *
- * Useful for recovery from I2C errors
+ * Recovery from repeated conversion failures (fdc_measure_all()):
+ * resets the device and repeats fdc_init() with the full ID check
  *
  * @return true if reset successful
  */
@@ -104,3 +229,13 @@ bool fdc_soft_reset();
  * @return true if read successful
  */
 bool fdc_read_device_id(uint16_t* device_id);
+
+/**
+ * @brief Forget the cached device register pointer
+ *
+ * The driver skips pointer writes when re-reading the last addressed
+ * register. Called on power-down (VDD_SW off), by fdc_init() and
+ * fdc_soft_reset(), and after I2C errors so the next access re-addresses
+ * the device.
+ */
+void fdc_invalidate_pointer();
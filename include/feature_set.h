@@ -0,0 +1,103 @@
+/**
+ * @file feature_set.h
+ * @brief Compile-time feature policy (one firmware for ATtiny202 and ATtiny402)
+ *
+ * main.cpp and level_logic.cpp test these constants with `if constexpr`,
+ * so a disabled feature's code is never compiled into the image and its
+ * module (eeprom_config.cpp, button.cpp, alert_manager.cpp, governor.cpp,
+ * warm_state.cpp) need not be linked. The sleep / power-gated measurement cycle is common to all
+ * profiles.
+ *
+ * | Feature         | Full | attiny402 env | attiny202 env | Disabled behaviour                  |
+ * |-----------------|------|---------------|---------------|-------------------------------------|
+ * | CONFIG          | yes  | yes           | no            | FACTORY_DEFAULTS, no event journal  |
+ * | BUTTON          | yes  | yes           | no            | PA0 stays UPDI only                 |
+ * | CALIBRATION     | yes  | yes           | no            | (needs CONFIG and BUTTON)           |
+ * | ALERT_WINDOWS   | yes  | yes           | no            | Pattern per measurement for 5 min   |
+ * | LEVEL_FILTER    | yes  | yes           | no            | Each sample sets the level (no IIR) |
+ * | ADAPTIVE_WAKE   | yes  | yes           | yes           | Fixed 10 s measurement interval     |
+ * | PREDICTIVE_WAKE | yes  | no            | no            | Ladder interval only (no trend)     |
+ * | ENERGY_GOVERNOR | yes  | no            | no            | No VDD checks or low-battery chirp  |
+ * | WARM_START      | yes  | no            | no            | Every reset starts cold (NORMAL)    |
+ * | BASELINE_TRACK  | yes  | no            | no            | Baseline fixed until re-calibrated  |
+ * | BOOT_CAPTURE    | no   | no            | yes           | FACTORY_DEFAULTS thresholds         |
+ * | STATS_ENABLE    | yes  | no            | no            | No counter block (stats.h)          |
+ *
+ * Select the profile with FEATURES_MINIMAL=1, or override single features
+ * (e.g. -DFEATURE_PREDICTIVE_WAKE=0). The full profile is what the FIL
+ * harness and test bench build; no AVR env ships it. PREDICTIVE_WAKE,
+ * ENERGY_GOVERNOR, WARM_START, BASELINE_TRACK and the stats block do not
+ * fit the 402's 4 KB next to the rest, so the attiny402 env turns them off
+ * and they run on the host harnesses only.
+ */
+
+#pragma once
+
+// 1 = ATtiny202 profile (2 KB flash), 0 = full profile (trimmed by the attiny402 env)
+#ifndef FEATURES_MINIMAL
+#define FEATURES_MINIMAL 0
+#endif
+
+// EEPROM journal: thresholds, calibration baseline, event log
+#ifndef FEATURE_CONFIG
+#define FEATURE_CONFIG (!FEATURES_MINIMAL)
+#endif
+
+// Button: short press silences, long press calibrates, boot hold resets
+#ifndef FEATURE_BUTTON
+#define FEATURE_BUTTON (!FEATURES_MINIMAL)
+#endif
+
+// 5-minute alert windows with per-level cadence and escalation
+#ifndef FEATURE_ALERT_WINDOWS
+#define FEATURE_ALERT_WINDOWS (!FEATURES_MINIMAL)
+#endif
+
+// Hysteresis, multi-sample debouncing (with fast confirm), stability tracking
+#ifndef FEATURE_LEVEL_FILTER
+#define FEATURE_LEVEL_FILTER (!FEATURES_MINIMAL)
+#endif
+
+// Wake interval ladder: 10 s up to 120 s while NORMAL and stable
+#ifndef FEATURE_ADAPTIVE_WAKE
+#define FEATURE_ADAPTIVE_WAKE 1
+#endif
+
+// Drain-rate prediction on top of the ladder (level trend history)
+#ifndef FEATURE_PREDICTIVE_WAKE
+#define FEATURE_PREDICTIVE_WAKE (!FEATURES_MINIMAL)
+#endif
+
+// VDD checks scaling sampling and alerts down as the cell sags (governor.h)
+#ifndef FEATURE_ENERGY_GOVERNOR
+#define FEATURE_ENERGY_GOVERNOR (!FEATURES_MINIMAL)
+#endif
+
+// Level and alert state survive brown-out / watchdog resets (warm_state.h)
+#ifndef FEATURE_WARM_START
+#define FEATURE_WARM_START (!FEATURES_MINIMAL)
+#endif
+
+// Calibration baseline follows slow drift while NORMAL (level_logic.h)
+#ifndef FEATURE_BASELINE_TRACK
+#define FEATURE_BASELINE_TRACK (!FEATURES_MINIMAL)
+#endif
+
+// Without CONFIG: dry / wet capture at power-up sets the trip points (RAM)
+#ifndef FEATURE_BOOT_CAPTURE
+#define FEATURE_BOOT_CAPTURE (FEATURES_MINIMAL)
+#endif
+
+namespace features {
+    constexpr bool CONFIG          = FEATURE_CONFIG;
+    constexpr bool BUTTON          = FEATURE_BUTTON;
+    constexpr bool CALIBRATION     = FEATURE_CONFIG && FEATURE_BUTTON;
+    constexpr bool ALERT_WINDOWS   = FEATURE_ALERT_WINDOWS;
+    constexpr bool LEVEL_FILTER    = FEATURE_LEVEL_FILTER;
+    constexpr bool ADAPTIVE_WAKE   = FEATURE_ADAPTIVE_WAKE;
+    constexpr bool PREDICTIVE_WAKE = FEATURE_PREDICTIVE_WAKE && ADAPTIVE_WAKE;
+    constexpr bool ENERGY_GOVERNOR = FEATURE_ENERGY_GOVERNOR;
+    constexpr bool WARM_START      = FEATURE_WARM_START;
+    constexpr bool BASELINE_TRACK  = FEATURE_BASELINE_TRACK && CALIBRATION && ADAPTIVE_WAKE;
+    constexpr bool BOOT_CAPTURE    = FEATURE_BOOT_CAPTURE && !CONFIG;
+}
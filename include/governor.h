@@ -0,0 +1,89 @@
+/**
+ * @file governor.h
+ * @brief Battery-voltage-aware energy governor
+ *
+ * VDD is measured rarely (GOVERNOR_CHECK_SEC), right after VDD_SW comes
+ * up for a measurement, when the cell is only lightly loaded. As the cell
+ * sags the governor steps down through energy tiers; each tier stretches
+ * the measurement interval and the alert cadence, caps the burst length
+ * (the 50 mA piezo pulses are what pull a tired CR2032 into brown-out)
+ * and shortens the debounce. Below NORMAL a single low-battery chirp
+ * sounds every LOW_BATTERY_CHIRP_SEC.
+ *
+ * | Tier     | Enter below | Leave above | Interval | Cadence | Burst  | Debounce |
+ * |----------|-------------|-------------|----------|---------|--------|----------|
+ * | NORMAL   |             |             | x1       | x1      | 5      | 3        |
+ * | SAVING   | 2.70 V      | 2.75 V      | x2       | x2      | 3      | 3        |
+ * | CRITICAL | 2.50 V      | 2.55 V      | x4       | x2      | 2      | 2        |
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "buzzer.h"
+
+// VDD check interval (seconds); the first check is at the first measurement
+constexpr uint32_t GOVERNOR_CHECK_SEC = 3600;
+
+// Low-battery chirp interval while below NORMAL (seconds)
+constexpr uint32_t LOW_BATTERY_CHIRP_SEC = 6UL * 3600;
+
+/**
+ * Energy tiers (worse = higher)
+ */
+enum class EnergyTier : uint8_t {
+    NORMAL = 0,
+    SAVING = 1,
+    CRITICAL = 2,
+};
+
+/**
+ * What a tier allows
+ */
+struct EnergyPolicy {
+    uint8_t interval_shift;    // Measurement interval x 2^n
+    uint8_t cadence_shift;     // Alert burst cadence x 2^n
+    BeepPattern max_pattern;   // Longest alert burst
+    uint8_t debounce_samples;  // Consistent samples to change level
+};
+
+/**
+ * @brief Start in NORMAL with a VDD check due
+ *
+ * @param tick Current tick (rtc_get_ticks())
+ */
+void governor_init(uint32_t tick);
+
+/**
+ * @brief Check whether a VDD measurement is due
+ */
+bool governor_check_due(uint32_t tick);
+
+/**
+ * @brief Feed a VDD measurement
+ *
+ * Moves between tiers with hysteresis and schedules the next check.
+ *
+ * @param vdd_mv power_measure_vdd() right after VDD_SW came up
+ * @param tick Current tick
+ * @return true if the tier changed
+ */
+bool governor_update(uint16_t vdd_mv, uint32_t tick);
+
+/**
+ * @brief Current energy tier
+ */
+EnergyTier governor_tier();
+
+/**
+ * @brief Limits of the current tier
+ */
+const EnergyPolicy& governor_policy();
+
+/**
+ * @brief Check (and consume) a due low-battery chirp
+ *
+ * @return true if below NORMAL and LOW_BATTERY_CHIRP_SEC has passed since
+ *         the last chirp (or the tier was just entered)
+ */
+bool governor_chirp_due(uint32_t tick);
@@ -4,12 +4,20 @@
  *
  * Computes ΔC = (CINx - CIN4) and compares against thresholds
  * Applies hysteresis and multi-sample debouncing to prevent chatter
+ * Checks the CIN4 reference (MEAS4) in every sample: an open or saturated
+ * reference electrode is a sensor error
+ *
+ * Calibrated units trip a channel once it has dropped its threshold below
+ * the full-tank baseline. While the level is solidly NORMAL the baseline
+ * estimate slowly follows the readings (temperature, fouling); the caller
+ * saves it in small steps (level_baseline_drift()).
  */
 
 #pragma once
 
 #include <stdint.h>
 #include "fdc1004.h"
+#include "eeprom_config.h"
 
 /**
  * Water level states
@@ -22,57 +30,145 @@ enum class WaterLevel : uint8_t {
     ERROR = 0xFF   // Sensor error (CIN4 invalid, I2C failure, etc.)
 };
 
+// Lowest plausible CIN4 reading (fF, before the CAPDAC offset): below it
+// the reference electrode is open or not installed
+constexpr int16_t LEVEL_REF_MIN_FF = 500;
+
 /**
- * Level thresholds structure (in femtofarads)
+ * @brief Initialize level logic module
+ *
+ * Thresholds, hysteresis and calibration baseline are read straight from
+ * the config view (eeprom_config()) into the trip table; nothing else is
+ * kept.
+ *
+ * @param config Configuration
  */
-struct LevelThresholds {
-    int16_t low_ff;       // Low water threshold
-    int16_t vlow_ff;      // Very-Low water threshold
-    int16_t crit_ff;      // Critical water threshold
-    uint8_t hysteresis_pct;  // Hysteresis percentage (0-100)
-};
+void level_init(const NvmConfig& config);
 
 /**
- * Calibration baseline values (per-channel offsets in fF)
+ * @brief Apply changed thresholds or calibration baseline
+ *
+ * @param config Configuration
+ */
+void level_set_config(const NvmConfig& config);
+
+/**
+ * @brief Set how many consistent samples confirm a level change
+ *
+ * Lets the energy governor trade noise rejection for conversions on a
+ * sagging cell; the fast-confirm budget scales with it.
+ *
+ * @param samples 1..LEVEL_DEBOUNCE_SAMPLES (out of range: the default)
  */
-struct CalibrationData {
-    int16_t base_c1_ff;
-    int16_t base_c2_ff;
-    int16_t base_c3_ff;
-    bool valid;
+void level_set_debounce(uint8_t samples);
+
+/**
+ * Level state kept across a warm reset (warm_state.h)
+ */
+struct LevelWarmState {
+    int32_t last_raw[FDC_NUM_READINGS];  // Last result codes (held channels, stability)
+    WaterLevel current_level;
+    WaterLevel pending_level;
+    uint8_t debounce_counter;
+    bool readings_valid;
 };
 
 /**
- * @brief Initialize level logic module
+ * @brief Copy out the confirmed level and pending debounce
+ */
+void level_save_warm(LevelWarmState& out);
+
+/**
+ * @brief Resume from a saved state (after level_init())
+ *
+ * The trip table stays as level_init() built it from the config; trend
+ * history starts empty.
+ */
+void level_restore_warm(const LevelWarmState& in);
+
+// Returned by level_predict_seconds_to_threshold() when no crossing is predicted
+constexpr uint32_t LEVEL_PREDICT_NONE = 0xFFFFFFFF;
+
+/**
+ * @brief Perform single level measurement and update state
+ *
+ * Measures all three channels (CIN1-3 vs CIN4) and the CIN4 reference,
+ * applies calibration, compares against thresholds with hysteresis, and
+ * updates level state.
+ * Calibrated readings are also kept in a short history for trend estimation.
  *
- * @param thresholds Threshold configuration
- * @param calibration Baseline calibration data
+ * While debouncing, extra back-to-back conversions are taken in the same
+ * call until the pending level is confirmed or rejected, so a change
+ * settles within one wake instead of three.
+ *
+ * @param now_sec Current time in seconds (rtc_get_ticks())
+ * @return Current water level after update
  */
-void level_init(const LevelThresholds& thresholds, const CalibrationData& calibration);
+WaterLevel level_update(uint32_t now_sec);
 
 /**
- * @brief Update thresholds
+ * @brief Update level state from a measurement taken by the caller
+ *
+ * Same processing as one level_update() sample, for conversions the
+ * caller triggered and collected itself (e.g. in alert beep gaps). No
+ * fast confirm: call again with first = false while level_is_settling(),
+ * or finish with level_settle().
  *
- * @param thresholds New threshold configuration
+ * @param now_sec Current time in seconds (rtc_get_ticks())
+ * @param r Readings indexed by FdcChannel, reference included (unused if
+ *          !valid); a channel marked invalid holds its last reading for
+ *          one sample
+ * @param valid false if the measurement failed (level becomes ERROR)
+ * @param first true for the first sample of a wake (stability and trend)
+ * @return Current water level after update
  */
-void level_set_thresholds(const LevelThresholds& thresholds);
+WaterLevel level_add_sample(uint32_t now_sec, const FdcReading r[FDC_NUM_READINGS], bool valid,
+                            bool first);
 
 /**
- * @brief Update calibration baseline
+ * @brief Check whether a level change (or its rejection) awaits more samples
  *
- * @param calibration New calibration data
+ * @return true while debouncing after a valid sample
  */
-void level_set_calibration(const CalibrationData& calibration);
+bool level_is_settling();
 
 /**
- * @brief Perform single level measurement and update state
+ * @brief Settle a pending level change with back-to-back conversions
  *
- * Measures all three channels (CIN1-3 vs CIN4), applies calibration,
- * compares against thresholds with hysteresis, and updates level state
+ * The fast-confirm part of level_update(): measures until the pending
+ * level is confirmed or rejected (bounded).
  *
+ * @param now_sec Current time in seconds (rtc_get_ticks())
  * @return Current water level after update
  */
-WaterLevel level_update();
+WaterLevel level_settle(uint32_t now_sec);
+
+/**
+ * @brief Predict time until the next threshold below the current level
+ *
+ * Extrapolates the drain rate over the last few calibrated samples of the
+ * channel that crosses next (CIN1 when NORMAL, CIN2 when LOW, CIN3 when
+ * VERY_LOW).
+ *
+ * @return Seconds until the predicted crossing, 0 if already below it,
+ *         LEVEL_PREDICT_NONE if not draining, no history, or nothing below
+ */
+uint32_t level_predict_seconds_to_threshold();
+
+/**
+ * @brief Check for a baseline drift step ready to be saved
+ *
+ * A channel whose estimate has moved a full step (25 fF) from the saved
+ * baseline moves by that step, at most 15 steps either way from its
+ * calibration. Nothing changes until the caller saves the result and
+ * calls level_set_config() (which restarts the estimate from it).
+ *
+ * @param base_ff Filled with the proposed baseline (fF, per level channel)
+ * @param drift_steps Filled with the matching NvmConfig::drift_steps
+ * @return true if some channel moved (always false when not calibrated or
+ *         without BASELINE_TRACK)
+ */
+bool level_baseline_drift(int16_t base_ff[FDC_NUM_CHANNELS], uint16_t* drift_steps);
 
 /**
  * @brief Get current water level (without new measurement)
@@ -81,6 +177,18 @@ WaterLevel level_update();
  */
 WaterLevel level_get_current();
 
+/**
+ * @brief Check if the level is settled and readings are steady
+ *
+ * True when debouncing is complete, no level change is pending, and the
+ * last two readings differ by less than a small delta on every channel.
+ * Without LEVEL_FILTER: the readings are steady and the last sample did not
+ * change the level. Used to stretch the wake interval (ADAPTIVE_WAKE).
+ *
+ * @return true if stable
+ */
+bool level_is_stable();
+
 /**
  * @brief Get raw capacitance readings (for diagnostics/calibration)
  *
@@ -94,10 +202,12 @@ bool level_get_raw_readings(int16_t* c1_ff, int16_t* c2_ff, int16_t* c3_ff);
 /**
  * @brief Check if CIN4 reference is valid
  *
- * Validates that the "always-wet" reference electrode is functioning
- * Used for installation validation
+ * Validates that the "always-wet" reference electrode is functioning from
+ * the last MEAS4 reading (CIN4 single-ended, taken with every conversion
+ * set). Used for installation validation
  *
- * @param min_ref_ff Minimum expected reference capacitance (fF)
- * @return true if CIN4 is valid
+ * @param min_ref_ff Minimum expected reference capacitance (fF, before the
+ *                   CAPDAC offset)
+ * @return true if CIN4 was measured (not held) and is within range
  */
 bool level_validate_cin4(int16_t min_ref_ff);
@@ -7,6 +7,7 @@
  * - Sleep modes
  * - TWI pin configuration (critical for leakage prevention)
  * - Wake source detection
+ * - Supply measurement (ADC0 against the internal reference)
  */
 
 #pragma once
@@ -18,7 +19,7 @@
  */
 enum WakeSource : uint8_t {
     WAKE_NONE    = 0,
-    WAKE_RTC     = (1 << 0),  // RTC PIT timer
+    WAKE_RTC     = (1 << 0),  // Scheduled RTC wakeup
     WAKE_BUTTON  = (1 << 1),  // Button press on PA0
 };
 
@@ -34,11 +35,19 @@ void power_init();
 /**
  * @brief Enable switched power rail (VDD_SW)
  *
- * Sets PWR_EN HIGH, waits for VDD_SW to stabilize (~3ms)
+ * Sets PWR_EN HIGH and returns immediately
+ * Readiness is established by fdc_init() polling for the first ACK
  * Must be called before using FDC1004, DRV8210, or I2C
  */
 void power_enable_peripherals();
 
+/**
+ * @brief Check if switched power rail (VDD_SW) is enabled
+ *
+ * @return true if PWR_EN is HIGH
+ */
+bool power_peripherals_enabled();
+
 /**
  * @brief Disable switched power rail (VDD_SW)
  *
@@ -48,15 +57,56 @@ void power_enable_peripherals();
  */
 void power_disable_peripherals();
 
+// Accumulated conversions per power_measure_supply() result
+constexpr uint8_t POWER_SUPPLY_SAMPLES = 64;
+
+/**
+ * @brief Measure the supply with ADC0
+ *
+ * Converts the internal 1.1 V reference with VDD as the ADC reference,
+ * accumulating POWER_SUPPLY_SAMPLES conversions:
+ *   result = POWER_SUPPLY_SAMPLES * 1023 * 1.1 V / VDD
+ * so a higher result means a lower VDD. Busy-waits (~1.3 ms at 10 MHz);
+ * ADC0 and the reference are switched off again before returning.
+ *
+ * @return Accumulated 10-bit result
+ */
+uint16_t power_measure_supply();
+
+/**
+ * @brief Measure VDD
+ *
+ * power_measure_supply() converted to millivolts (internal reference at
+ * its 1.1 V nominal, ±4 % over temperature). Measure with the cell lightly
+ * loaded (right after VDD_SW comes up, not during a beep).
+ *
+ * @return VDD in mV
+ */
+uint16_t power_measure_vdd();
+
 /**
  * @brief Enter sleep mode
  *
  * Enters STANDBY sleep (RTC continues running)
- * Wakes on RTC PIT interrupt or PA0 pin change
- * Returns after wake interrupt occurs
+ * Returns once a wake source is flagged: the scheduled RTC wakeup
+ * (rtc_set_wakeup_tick) is due or PA0 changed. Returns immediately if a flag is still set;
+ * call power_clear_wake_source() after handling the wake.
  */
 void power_sleep();
 
+/**
+ * @brief Sleep for a fixed time
+ *
+ * Enters STANDBY sleep until the RTC one-shot compare wakeup fires.
+ * Other interrupts (RTC overflow, button) are serviced and sleep resumes.
+ * VDD_SW and pin states are left unchanged.
+ *
+ * @param ms Time to sleep in milliseconds
+ * @return true if slept, false if the RTC wake timer is unavailable
+ *         (caller should busy-wait instead)
+ */
+bool power_sleep_ms(uint16_t ms);
+
 /**
  * @brief Get wake source(s)
  *
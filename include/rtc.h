@@ -1,28 +1,84 @@
 /**
  * @file rtc.h
- * @brief RTC/PIT for 10-second periodic wake timer
+ * @brief RTC counter for the tickless wake timer
  *
- * Uses the internal 32.768 kHz Ultra-Low-Power (ULP) oscillator
- * and Periodic Interrupt Timer (PIT) to wake from sleep every 10 seconds
+ * Uses the internal 32.768 kHz Ultra-Low-Power (ULP) oscillator.
+ * The RTC counter runs at 1024 Hz (32.768 kHz / 32) and overflows every
+ * 64 s; the overflow interrupt extends it to a 32-bit seconds time base.
+ * The compare channel wakes the MCU exactly at the next scheduled second
+ * (rtc_set_wakeup_tick) or after a short one-shot delay (rtc_start_wakeup).
  */
 
 #pragma once
 
 #include <stdint.h>
 
+// Default wake interval (seconds)
+constexpr uint16_t RTC_DEFAULT_WAKE_SEC = 10;
+
+// RTC counter rate (counts per second)
+constexpr uint16_t RTC_COUNTS_PER_SEC = 1024;
+
 /**
- * @brief Initialize RTC and PIT for 10-second periodic interrupts
+ * @brief Initialize RTC counter
  *
  * Configures:
  * - 32.768 kHz internal ULP oscillator
- * - PIT for 10-second period
- * - Enables PIT interrupt
+ * - Free-running counter @ 1024 Hz, runs in STANDBY
+ * - Overflow interrupt for the seconds time base (PIT disabled)
  */
 void rtc_init();
 
 /**
  * @brief Get elapsed ticks since boot
  *
- * @return Number of 10-second ticks elapsed
+ * @return Number of 1-second ticks elapsed (seconds since boot)
  */
 uint32_t rtc_get_ticks();
+
+/**
+ * @brief Get elapsed RTC counts since boot
+ *
+ * 1024 counts per second, wraps every ~48 days; compute intervals as
+ * unsigned differences. For timestamping edges and measuring durations
+ * below a second.
+ *
+ * @return Counter value extended to 32 bits
+ */
+uint32_t rtc_get_counts();
+
+/**
+ * @brief rtc_get_counts() for ISR context (interrupts already disabled)
+ *
+ * @return Counter value extended to 32 bits
+ */
+uint32_t rtc_get_counts_locked();
+
+/**
+ * @brief Schedule the next wake
+ *
+ * Flags WAKE_RTC (see power.h) once rtc_get_ticks() reaches tick.
+ * Replaces any previously scheduled wake; fires immediately if tick
+ * has already passed.
+ *
+ * @param tick Wake time in seconds since boot
+ */
+void rtc_set_wakeup_tick(uint32_t tick);
+/**
+ * @brief Arm a one-shot compare wakeup
+ *
+ * The RTC compare interrupt fires after approximately ms milliseconds
+ * (rounded up to whole ~1 ms counter ticks, never early). A scheduled
+ * wake (rtc_set_wakeup_tick) is held off until the one-shot has fired.
+ *
+ * @param ms Delay in milliseconds (max ~60000)
+ * @return true if armed, false if the RTC counter is not running
+ */
+bool rtc_start_wakeup(uint16_t ms);
+
+/**
+ * @brief Check whether the armed one-shot wakeup has fired
+ *
+ * @return true once the compare interrupt has occurred
+ */
+bool rtc_wakeup_expired();
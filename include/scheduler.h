@@ -0,0 +1,71 @@
+/**
+ * @file scheduler.h
+ * @brief Deadline-based event scheduler on the RTC seconds time base
+ *
+ * Each event has at most one pending deadline (in rtc_get_ticks() seconds).
+ * sched_arm() programs the RTC wakeup for the earliest pending deadline,
+ * so the MCU wakes exactly when the next thing is due instead of on a
+ * fixed grid.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Scheduled work
+ */
+enum class SchedEvent : uint8_t {
+    MEASURE = 0,   // Measurement cycle
+    ALERT_BURST,   // Next alert beep burst / window expiry
+    CALIBRATION,   // Calibration requested by long press
+    COUNT
+};
+
+/**
+ * @brief Clear all pending events
+ */
+void sched_init();
+
+/**
+ * @brief Schedule (or reschedule) an event
+ *
+ * @param ev Event
+ * @param tick Due time in seconds since boot
+ */
+void sched_at(SchedEvent ev, uint32_t tick);
+
+/**
+ * @brief Cancel a pending event
+ *
+ * @param ev Event
+ */
+void sched_cancel(SchedEvent ev);
+
+/**
+ * @brief Check for and consume a due event
+ *
+ * @param ev Event
+ * @param now Current time in seconds
+ * @return true if the event was pending and due (it is cleared)
+ */
+bool sched_take(SchedEvent ev, uint32_t now);
+
+/**
+ * @brief Arm the RTC wakeup for the earliest pending event
+ *
+ * Call right before power_sleep(). With nothing pending, no wakeup is
+ * armed (only a button press wakes the MCU).
+ */
+void sched_arm();
+
+/**
+ * @brief Check whether a tick has been reached (wrap-safe)
+ *
+ * @param tick Deadline in seconds
+ * @param now Current time in seconds
+ * @return true if now >= tick
+ */
+static inline bool sched_tick_reached(uint32_t tick, uint32_t now) {
+    return (int32_t)(now - tick) >= 0;
+}
@@ -0,0 +1,206 @@
+/**
+ * @file stats.h
+ * @brief Field instrumentation counters (readable over UPDI)
+ *
+ * A small counter block in SRAM tracks what each wake costs: awake and
+ * VDD_SW-on time, I2C traffic and failures, FDC1004 conversion waits and
+ * beep time. The lifetime totals are journaled to EEPROM once a week and
+ * restored at boot.
+ *
+ * Memory layout (StatsBlock, little-endian, read over UPDI from SRAM at
+ * the `stats_block` symbol, or by searching SRAM for the 'S','T' magic):
+ *
+ * | Offset | Size | Field              | Scope      |
+ * |--------|------|--------------------|------------|
+ * | 0      | 2    | magic 'S','T'      |            |
+ * | 2      | 1    | version (1)        |            |
+ * | 3      | 1    | size (44)          |            |
+ * | 4      | 4    | wakes              | lifetime   |
+ * | 8      | 4    | awake_counts       | lifetime   |
+ * | 12     | 4    | rail_counts        | lifetime   |
+ * | 16     | 4    | beep_ms            | lifetime   |
+ * | 20     | 2    | i2c_errors         | lifetime   |
+ * | 22     | 2    | fdc_timeouts       | lifetime   |
+ * | 24     | 4    | i2c_transactions   | since boot |
+ * | 28     | 4    | i2c_bytes          | since boot |
+ * | 32     | 2    | i2c_nacks          | since boot |
+ * | 34     | 2    | fdc_waits          | since boot |
+ * | 36     | 2    | fdc_repolls        | since boot |
+ * | 38     | 2    | last_awake_counts  | since boot |
+ * | 40     | 2    | max_awake_counts   | since boot |
+ * | 42     | 2    | commits            | since boot |
+ *
+ * Times in counts are RTC counts (1024 per second).
+ *
+ * i2c_errors counts unexpected failures only: the NACKs twi_probe() sees
+ * while the FDC1004 comes out of reset go to i2c_nacks alone, and a probe
+ * that never gets an ACK counts as one error.
+ *
+ * Compile with STATS_ENABLE=0 to remove the block and every hook
+ * (the platformio.ini envs, to save flash).
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "twi.h"
+
+// 1 = counters compiled in, 0 = hooks compile to nothing
+#ifndef STATS_ENABLE
+#define STATS_ENABLE 1
+#endif
+
+// Journal the lifetime totals this often (seconds)
+constexpr uint32_t STATS_COMMIT_SEC = 7UL * 24 * 3600;
+
+constexpr uint8_t STATS_VERSION = 1;
+
+/**
+ * Lifetime totals: journaled word by word, restored by stats_init()
+ */
+struct StatsTotals {
+    uint32_t wakes;          // Wakes from STANDBY (boot included)
+    uint32_t awake_counts;   // Time out of STANDBY
+    uint32_t rail_counts;    // Time with VDD_SW on
+    uint32_t beep_ms;        // Piezo driven
+    uint16_t i2c_errors;     // Transactions ending in NACK, TIMEOUT or BUS_ERROR (not probe NACKs)
+    uint16_t fdc_timeouts;   // Conversions whose DONE bits never came
+};
+
+/**
+ * Counter block (layout above)
+ */
+struct StatsBlock {
+    uint8_t magic[2];
+    uint8_t version;
+    uint8_t size;
+
+    StatsTotals totals;
+
+    uint32_t i2c_transactions;   // twi_write()/twi_read() calls and probe attempts
+    uint32_t i2c_bytes;          // Bytes on the bus, address bytes included
+    uint16_t i2c_nacks;          // NACKed transactions and probe attempts
+    uint16_t fdc_waits;          // fdc_wait_ready() calls
+    uint16_t fdc_repolls;        // FDC_CONF reads after the first (DONE late)
+    uint16_t last_awake_counts;  // Previous wake
+    uint16_t max_awake_counts;   // Longest wake
+    uint16_t commits;            // Journal commits
+};
+
+static_assert(sizeof(StatsTotals) % 4 == 0, "Totals are journaled in 4-byte words");
+static_assert(sizeof(StatsBlock) == 44, "Update the documented layout");
+
+#if STATS_ENABLE
+
+extern StatsBlock stats_block;
+
+/**
+ * @brief Initialize the block and restore the lifetime totals
+ *
+ * Call after eeprom_init() and rtc_init(); counts the boot as a wake.
+ */
+void stats_init();
+
+/**
+ * @brief Mark the return from STANDBY
+ */
+void stats_wake_begin();
+
+/**
+ * @brief Mark the return to STANDBY
+ *
+ * Accumulates the wake's duration and journals the totals every
+ * STATS_COMMIT_SEC.
+ *
+ * @param tick Current tick (rtc_get_ticks())
+ */
+void stats_wake_end(uint32_t tick);
+
+/**
+ * @brief VDD_SW switched on
+ */
+void stats_rail_on();
+
+/**
+ * @brief VDD_SW switched off
+ */
+void stats_rail_off();
+
+/**
+ * @brief Count a finished I2C transaction
+ *
+ * @param bytes Bytes on the bus, address byte included
+ * @param status Transaction result
+ */
+static inline void stats_i2c(uint8_t bytes, TwiStatus status) {
+    stats_block.i2c_transactions++;
+    stats_block.i2c_bytes += bytes;
+    if (status == TwiStatus::NACK) {
+        stats_block.i2c_nacks++;
+    }
+    if (status != TwiStatus::OK) {
+        stats_block.totals.i2c_errors++;
+    }
+}
+
+/**
+ * @brief Count one twi_probe() attempt
+ *
+ * A NACK is the device still in power-on reset: counted in i2c_nacks
+ * only. A stretch timeout still counts as an error.
+ *
+ * @param bytes Bytes on the bus (address byte)
+ * @param status Attempt result
+ */
+static inline void stats_i2c_probe(uint8_t bytes, TwiStatus status) {
+    stats_block.i2c_transactions++;
+    stats_block.i2c_bytes += bytes;
+    if (status == TwiStatus::NACK) {
+        stats_block.i2c_nacks++;
+    } else if (status != TwiStatus::OK) {
+        stats_block.totals.i2c_errors++;
+    }
+}
+
+/**
+ * @brief Count a twi_probe() that timed out without an ACK
+ */
+static inline void stats_i2c_probe_failed() {
+    stats_block.totals.i2c_errors++;
+}
+
+/**
+ * @brief Count a wait for conversion results
+ *
+ * @param polls FDC_CONF reads made (at least one)
+ * @param timed_out true if DONE was never seen
+ */
+static inline void stats_fdc_wait(uint16_t polls, bool timed_out) {
+    stats_block.fdc_waits++;
+    stats_block.fdc_repolls += polls - 1;
+    if (timed_out) {
+        stats_block.totals.fdc_timeouts++;
+    }
+}
+
+/**
+ * @brief Count piezo drive time (ISR context)
+ */
+static inline void stats_beep_ms(uint16_t ms) {
+    stats_block.totals.beep_ms += ms;
+}
+
+#else
+
+static inline void stats_init() {}
+static inline void stats_wake_begin() {}
+static inline void stats_wake_end(uint32_t) {}
+static inline void stats_rail_on() {}
+static inline void stats_rail_off() {}
+static inline void stats_i2c(uint8_t, TwiStatus) {}
+static inline void stats_i2c_probe(uint8_t, TwiStatus) {}
+static inline void stats_i2c_probe_failed() {}
+static inline void stats_fdc_wait(uint16_t, bool) {}
+static inline void stats_beep_ms(uint16_t) {}
+
+#endif
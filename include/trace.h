@@ -0,0 +1,78 @@
+/**
+ * @file trace.h
+ * @brief Phase markers on PA2 for logic-analyzer energy profiling
+ *
+ * With TRACE_PHASES=1 each phase boundary emits a burst of short pulses
+ * on the LED pin (PA2): the pulse count is the phase ID below. Capture
+ * PA2 next to a current probe and attribute the charge between bursts
+ * to the phase that started it.
+ *
+ * | ID | Phase       | Emitted by                                  |
+ * |----|-------------|---------------------------------------------|
+ * | 1  | RAIL_UP     | power_enable_peripherals()                  |
+ * | 2  | TWI_INIT    | twi_init()                                  |
+ * | 3  | FDC_INIT    | fdc_init()                                  |
+ * | 4  | CONV_WAIT   | fdc_wait_ready()                            |
+ * | 5  | RESULT_READ | fdc_measure() / fdc_read_all() after DONE   |
+ * | 6  | ALERT_EVAL  | main.cpp alert_cycle()                      |
+ * | 7  | BEEP        | buzzer_start()                              |
+ * | 8  | RAIL_DOWN   | power_disable_peripherals()                 |
+ * | 9  | SLEEP       | power_sleep()                               |
+ *
+ * Pulses are TRACE_PULSE_US high and low (a 9-pulse burst takes ~18 us);
+ * a gap longer than a few pulse widths ends a burst. An interrupt inside
+ * a burst can stretch one gap. The LED is driven for microseconds only.
+ *
+ * Disabled (default), the markers compile to nothing and the firmware
+ * is identical to a build without them.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// 1 = emit phase markers on PA2, 0 = no code (production)
+#ifndef TRACE_PHASES
+#define TRACE_PHASES 0
+#endif
+
+/**
+ * Traced phases (value = pulses per marker)
+ */
+enum class TracePhase : uint8_t {
+    RAIL_UP = 1,
+    TWI_INIT = 2,
+    FDC_INIT = 3,
+    CONV_WAIT = 4,
+    RESULT_READ = 5,
+    ALERT_EVAL = 6,
+    BEEP = 7,
+    RAIL_DOWN = 8,
+    SLEEP = 9,
+};
+
+#if TRACE_PHASES
+
+#include "pins.hpp"
+#include <avr/io.h>
+#include <util/delay.h>
+
+constexpr uint8_t TRACE_PULSE_US = 1;
+
+/**
+ * @brief Mark the start of a phase on PA2
+ */
+static inline void trace_phase(TracePhase phase) {
+    for (uint8_t i = static_cast<uint8_t>(phase); i > 0; i--) {
+        PORTA.OUTSET = pins::LED;
+        _delay_us(TRACE_PULSE_US);
+        PORTA.OUTCLR = pins::LED;
+        _delay_us(TRACE_PULSE_US);
+    }
+}
+
+#else
+
+static inline void trace_phase(TracePhase) {}
+
+#endif
@@ -2,7 +2,7 @@
  * @file twi.h
  * @brief Minimal blocking I2C (TWI) master driver for ATtiny202
  *
- * 100 kHz operation, master mode only
+ * Software (bit-bang) master on PA6/PA7, 400 kHz or 100 kHz
  * Blocking implementation (suitable for low-power periodic operation)
  */
 
@@ -10,30 +10,35 @@
 
 #include <stdint.h>
 
+// Bus speed: 1 = 400 kHz Fast-mode (default), 0 = 100 kHz Standard-mode
+// Edge timing is derived from F_CPU at compile time
+#ifndef TWI_FAST_MODE
+#define TWI_FAST_MODE 1
+#endif
+
 /**
  * TWI operation status codes
  */
 enum class TwiStatus : uint8_t {
     OK         = 0,  // Operation successful
     NACK       = 1,  // Received NACK (device not responding or register invalid)
-    TIMEOUT    = 2,  // Bus timeout (device hung or not present)
+    TIMEOUT    = 2,  // Bus timeout (SCL held low by device beyond timeout_ms)
     BUS_ERROR  = 3,  // Bus error (arbitration lost, bus fault)
 };
 
 /**
- * @brief Initialize TWI peripheral for 100 kHz master mode
+ * @brief Initialize software I2C master
  *
  * Configures:
- * - Master mode
- * - 100 kHz SCL frequency (assuming 20 MHz F_CPU)
- * - PA6 (SDA), PA7 (SCL)
+ * - PA6 (SDA), PA7 (SCL) as open-drain (released = input, low = output 0)
+ * - SCL timing per TWI_FAST_MODE, computed from F_CPU
  *
  * NOTE: VDD_SW must be enabled before calling (for I2C pull-ups)
  */
 void twi_init();
 
 /**
- * @brief Disable TWI peripheral
+ * @brief Release I2C pins
  *
  * Must be called before disabling VDD_SW to prevent leakage
  */
@@ -45,7 +50,7 @@ void twi_disable();
  * @param addr 7-bit I2C address
  * @param data Pointer to data buffer
  * @param len Number of bytes to write
- * @param timeout_ms Timeout in milliseconds (0 = no timeout)
+ * @param timeout_ms Maximum clock-stretch time in milliseconds (0 = no timeout)
  * @return TwiStatus
  */
 TwiStatus twi_write(uint8_t addr, const uint8_t* data, uint8_t len, uint16_t timeout_ms);
@@ -56,7 +61,7 @@ TwiStatus twi_write(uint8_t addr, const uint8_t* data, uint8_t len, uint16_t tim
  * @param addr 7-bit I2C address
  * @param data Pointer to receive buffer
  * @param len Number of bytes to read
- * @param timeout_ms Timeout in milliseconds (0 = no timeout)
+ * @param timeout_ms Maximum clock-stretch time in milliseconds (0 = no timeout)
  * @return TwiStatus
  */
 TwiStatus twi_read(uint8_t addr, uint8_t* data, uint8_t len, uint16_t timeout_ms);
@@ -94,3 +99,28 @@ TwiStatus twi_read_reg(uint8_t addr, uint8_t reg, uint8_t* value, uint16_t timeo
  * @return TwiStatus
  */
 TwiStatus twi_read_regs(uint8_t addr, uint8_t reg, uint8_t* data, uint8_t len, uint16_t timeout_ms);
+
+/**
+ * @brief Poll until a device ACKs its address
+ *
+ * Used after enabling VDD_SW instead of a fixed power-up delay.
+ * Attempts are only made once both bus lines have been pulled high.
+ *
+ * @param addr 7-bit I2C address
+ * @param timeout_ms Maximum time to wait for the first ACK (capped at about
+ *                   6.5 s; 0 makes a single attempt)
+ * @return TwiStatus::OK on ACK, TwiStatus::TIMEOUT otherwise
+ */
+TwiStatus twi_probe(uint8_t addr, uint16_t timeout_ms);
+
+/**
+ * @brief Free a bus left stuck by an interrupted transfer
+ *
+ * A slave cut off mid-byte may hold SDA low waiting for the rest of its
+ * clocks. Clocks SCL (up to 9 pulses) until SDA is released, then sends
+ * a STOP to reset the slave's bus logic.
+ *
+ * @return TwiStatus::OK if both lines are high afterwards,
+ *         TwiStatus::BUS_ERROR otherwise
+ */
+TwiStatus twi_recover();
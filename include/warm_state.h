@@ -0,0 +1,50 @@
+/**
+ * @file warm_state.h
+ * @brief Level and alert state kept across a warm reset
+ *
+ * A brown-out from a beep on a tired cell, a watchdog or an external reset
+ * keeps SRAM; only the C runtime clears it. A CRC-guarded block in
+ * .noinit (not touched at startup) holds the confirmed level, pending
+ * debounce and the alert window, saved before each alert burst and at the
+ * end of every wake. After a reset that left RAM intact (RSTCTRL.RSTFR
+ * without PORF or UPDIRF) the firmware resumes from it: an alert in
+ * progress keeps its window and a confirmed level needs no new debounce.
+ * Power-on and UPDI resets (new firmware) start cold.
+ *
+ * The RTC restarts at 0: the window's ticks are rebased from the saved
+ * tick, so time spent in reset is not counted. A block resumed
+ * WARM_MAX_RESUMES times without a wake completing is dropped (reset loop).
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// Resumes in a row (no wake completed) before starting cold
+constexpr uint8_t WARM_MAX_RESUMES = 3;
+
+/**
+ * @brief Check the reset cause and the saved block
+ *
+ * Call first in system_init(); reads and clears RSTCTRL.RSTFR.
+ *
+ * @return true if the reset kept RAM and the block is intact
+ */
+bool warm_check();
+
+/**
+ * @brief Hand the saved state to level_logic and alert_manager
+ *
+ * Call after level_init() and alert_init() when warm_check() returned true.
+ *
+ * @param tick Current tick (rtc_get_ticks(), restarted at 0)
+ */
+void warm_restore(uint32_t tick);
+
+/**
+ * @brief Save level and alert state
+ *
+ * @param tick Current tick
+ * @param wake_complete true at the end of a wake (clears the resume count)
+ */
+void warm_save(uint32_t tick, bool wake_complete);
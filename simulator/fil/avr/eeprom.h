@@ -0,0 +1,24 @@
+/**
+ * @file eeprom.h
+ * @brief Host shim for <avr/eeprom.h>
+ *
+ * EEMEM objects are host memory in the sim_eeprom section (erased to
+ * 0xFF at reset). Writes are counted and cost simulated write time.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define EEMEM __attribute__((section("sim_eeprom")))
+
+void eeprom_read_block(void* dst, const void* src, size_t n);
+void eeprom_update_block(const void* src, void* dst, size_t n);
+void eeprom_write_block(const void* src, void* dst, size_t n);
+uint8_t eeprom_read_byte(const uint8_t* addr);
+void eeprom_update_byte(uint8_t* addr, uint8_t value);
+void eeprom_write_byte(uint8_t* addr, uint8_t value);
+
+inline bool eeprom_is_ready() { return true; }  // Writes complete synchronously
+inline void eeprom_busy_wait() {}
@@ -0,0 +1,17 @@
+/**
+ * @file interrupt.h
+ * @brief Host shim for <avr/interrupt.h>
+ *
+ * sei()/cli() drive the simulated global interrupt flag; pending
+ * interrupts are delivered at the next delay, bus transfer or sleep.
+ */
+
+#pragma once
+
+void sim_sei();
+void sim_cli();
+
+inline void sei() { sim_sei(); }
+inline void cli() { sim_cli(); }
+
+#define ISR(vector) extern "C" void vector(void)
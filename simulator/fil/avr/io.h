@@ -0,0 +1,265 @@
+/**
+ * @file io.h
+ * @brief Host shim for <avr/io.h> (firmware-in-the-loop build)
+ *
+ * Declares the peripherals the firmware touches with the same register
+ * names. Strobe (OUTSET/OUTCLR/...) and flag (INTFLAGS) registers keep
+ * their write-1-to-set / write-1-to-clear semantics and command registers
+ * (ADC0.COMMAND) run the simulation on write; everything else is plain
+ * memory that sim_hal.cpp reads and updates as simulated time runs.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifndef F_CPU
+#define F_CPU 20000000UL  // ATtiny402 build
+#endif
+
+/**
+ * Write-only strobe acting on a backing register (DIRSET, OUTCLR, ...)
+ */
+struct SimStrobe8 {
+    enum Op : uint8_t { SET, CLR, TGL };
+
+    volatile uint8_t* reg;
+    Op op;
+
+    SimStrobe8& operator=(uint8_t v) {
+        switch (op) {
+            case SET: *reg |= v; break;
+            case CLR: *reg &= (uint8_t)~v; break;
+            case TGL: *reg ^= v; break;
+        }
+        return *this;
+    }
+
+    operator uint8_t() const { return *reg; }
+};
+
+/**
+ * Interrupt flag register: hardware raises bits, writing 1 clears them
+ */
+struct SimFlags8 {
+    volatile uint8_t bits = 0;
+
+    SimFlags8& operator=(uint8_t v) {
+        bits &= (uint8_t)~v;
+        return *this;
+    }
+
+    operator uint8_t() const { return bits; }
+
+    void raise(uint8_t v) { bits |= v; }
+};
+
+/**
+ * Command register: a write is handed to the peripheral model (ADC0.COMMAND)
+ */
+struct SimCommand8 {
+    void (*on_write)(uint8_t) = nullptr;
+
+    SimCommand8& operator=(uint8_t v) {
+        if (on_write) {
+            on_write(v);
+        }
+        return *this;
+    }
+
+    operator uint8_t() const { return 0; }  // Commands complete on write
+};
+
+// Pin masks
+#define PIN0_bm 0x01
+#define PIN1_bm 0x02
+#define PIN2_bm 0x04
+#define PIN3_bm 0x08
+#define PIN4_bm 0x10
+#define PIN5_bm 0x20
+#define PIN6_bm 0x40
+#define PIN7_bm 0x80
+
+// PORT
+struct PORT_t {
+    volatile uint8_t DIR = 0;
+    SimStrobe8 DIRSET{&DIR, SimStrobe8::SET};
+    SimStrobe8 DIRCLR{&DIR, SimStrobe8::CLR};
+    SimStrobe8 DIRTGL{&DIR, SimStrobe8::TGL};
+    volatile uint8_t OUT = 0;
+    SimStrobe8 OUTSET{&OUT, SimStrobe8::SET};
+    SimStrobe8 OUTCLR{&OUT, SimStrobe8::CLR};
+    SimStrobe8 OUTTGL{&OUT, SimStrobe8::TGL};
+    volatile uint8_t IN = 0xFF;
+    SimFlags8 INTFLAGS;
+    volatile uint8_t PORTCTRL = 0;
+    volatile uint8_t PIN0CTRL = 0, PIN1CTRL = 0, PIN2CTRL = 0, PIN3CTRL = 0;
+    volatile uint8_t PIN4CTRL = 0, PIN5CTRL = 0, PIN6CTRL = 0, PIN7CTRL = 0;
+};
+
+extern PORT_t PORTA;
+
+#define PORT_PULLUPEN_bm 0x08
+#define PORT_ISC_gm 0x07
+#define PORT_ISC_INTDISABLE_gc 0x00
+#define PORT_ISC_BOTHEDGES_gc 0x01
+#define PORT_ISC_RISING_gc 0x02
+#define PORT_ISC_FALLING_gc 0x03
+#define PORT_ISC_INPUT_DISABLE_gc 0x04
+#define PORT_ISC_LEVEL_gc 0x05
+
+// TCA0 (single-slope PWM for the piezo)
+struct TCA_SINGLE_t {
+    volatile uint8_t CTRLA = 0, CTRLB = 0, CTRLC = 0, CTRLD = 0;
+    volatile uint8_t CTRLECLR = 0, CTRLESET = 0, CTRLFCLR = 0, CTRLFSET = 0;
+    volatile uint8_t EVCTRL = 0, INTCTRL = 0;
+    SimFlags8 INTFLAGS;
+    volatile uint16_t CNT = 0, PER = 0xFFFF, CMP0 = 0, CMP1 = 0, CMP2 = 0;
+};
+
+struct TCA_t {
+    TCA_SINGLE_t SINGLE;
+};
+
+extern TCA_t TCA0;
+
+#define TCA_SINGLE_ENABLE_bm 0x01
+#define TCA_SINGLE_CLKSEL_gm 0x0E
+#define TCA_SINGLE_CLKSEL_DIV1_gc (0x00 << 1)
+#define TCA_SINGLE_CLKSEL_DIV2_gc (0x01 << 1)
+#define TCA_SINGLE_CLKSEL_DIV4_gc (0x02 << 1)
+#define TCA_SINGLE_CLKSEL_DIV8_gc (0x03 << 1)
+#define TCA_SINGLE_CLKSEL_DIV16_gc (0x04 << 1)
+#define TCA_SINGLE_CLKSEL_DIV64_gc (0x05 << 1)
+#define TCA_SINGLE_CLKSEL_DIV256_gc (0x06 << 1)
+#define TCA_SINGLE_CLKSEL_DIV1024_gc (0x07 << 1)
+#define TCA_SINGLE_WGMODE_SINGLESLOPE_gc 0x03
+#define TCA_SINGLE_CMP0EN_bm 0x10
+#define TCA_SINGLE_OVF_bm 0x01
+
+// TCB0 (buzzer phase timer)
+struct TCB_t {
+    volatile uint8_t CTRLA = 0, CTRLB = 0, EVCTRL = 0, INTCTRL = 0;
+    SimFlags8 INTFLAGS;
+    volatile uint8_t STATUS = 0, DBGCTRL = 0, TEMP = 0;
+    volatile uint16_t CNT = 0, CCMP = 0;
+};
+
+extern TCB_t TCB0;
+
+#define TCB_ENABLE_bm 0x01
+#define TCB_CLKSEL_gm 0x06
+#define TCB_CLKSEL_CLKDIV1_gc (0x00 << 1)
+#define TCB_CLKSEL_CLKDIV2_gc (0x01 << 1)
+#define TCB_CLKSEL_CLKTCA_gc (0x02 << 1)
+#define TCB_RUNSTDBY_bm 0x40
+#define TCB_CNTMODE_INT_gc 0x00
+#define TCB_CNTMODE_SINGLE_gc 0x06
+#define TCB_CAPT_bm 0x01
+
+// TWI0 (unused: the I2C bus is bit-banged and replaced by sim_twi.cpp)
+struct TWI_t {
+    volatile uint8_t MCTRLA = 0;
+};
+
+extern TWI_t TWI0;
+
+// RTC
+struct RTC_t {
+    volatile uint8_t CTRLA = 0, STATUS = 0, INTCTRL = 0;
+    SimFlags8 INTFLAGS;
+    volatile uint8_t TEMP = 0, DBGCTRL = 0, CALIB = 0, CLKSEL = 0;
+    volatile uint16_t CNT = 0, PER = 0xFFFF, CMP = 0;
+    volatile uint8_t PITCTRLA = 0, PITSTATUS = 0, PITINTCTRL = 0;
+    SimFlags8 PITINTFLAGS;
+    volatile uint8_t PITDBGCTRL = 0;
+};
+
+extern RTC_t RTC;
+
+#define RTC_RTCEN_bm 0x01
+#define RTC_PRESCALER_gm 0x78
+#define RTC_PRESCALER_DIV1_gc (0x00 << 3)
+#define RTC_PRESCALER_DIV32_gc (0x05 << 3)
+#define RTC_PRESCALER_DIV1024_gc (0x0A << 3)
+#define RTC_RUNSTDBY_bm 0x80
+#define RTC_CLKSEL_INT32K_gc 0x00
+#define RTC_CLKSEL_INT1K_gc 0x01
+#define RTC_OVF_bm 0x01
+#define RTC_CMP_bm 0x02
+#define RTC_CTRLABUSY_bm 0x01
+#define RTC_CNTBUSY_bm 0x02
+#define RTC_PERBUSY_bm 0x04
+#define RTC_CMPBUSY_bm 0x08
+#define RTC_PITEN_bm 0x01
+#define RTC_PI_bm 0x01
+#define RTC_PERIOD_CYC16384_gc (0x0D << 3)
+#define RTC_PERIOD_CYC32768_gc (0x0E << 3)
+
+// ADC0 / VREF (supply measurement)
+struct ADC_t {
+    volatile uint8_t CTRLA = 0, CTRLB = 0, CTRLC = 0, CTRLD = 0, CTRLE = 0;
+    volatile uint8_t SAMPCTRL = 0, MUXPOS = 0;
+    SimCommand8 COMMAND;
+    volatile uint8_t EVCTRL = 0, INTCTRL = 0;
+    SimFlags8 INTFLAGS;
+    volatile uint8_t DBGCTRL = 0, TEMP = 0;
+    volatile uint16_t RES = 0, WINLT = 0, WINHT = 0;
+    volatile uint8_t CALIB = 0;
+};
+
+extern ADC_t ADC0;
+
+#define ADC_ENABLE_bm 0x01
+#define ADC_RESSEL_10BIT_gc 0x00
+#define ADC_SAMPNUM_gm 0x07
+#define ADC_SAMPNUM_ACC4_gc 0x02
+#define ADC_SAMPNUM_ACC64_gc 0x06
+#define ADC_SAMPCAP_bm 0x40
+#define ADC_REFSEL_gm 0x30
+#define ADC_REFSEL_INTREF_gc 0x00
+#define ADC_REFSEL_VDDREF_gc 0x10
+#define ADC_PRESC_gm 0x07
+#define ADC_PRESC_DIV16_gc 0x03
+#define ADC_PRESC_DIV64_gc 0x05
+#define ADC_INITDLY_DLY16_gc 0x20
+#define ADC_MUXPOS_INTREF_gc 0x1D
+#define ADC_STCONV_bm 0x01
+#define ADC_RESRDY_bm 0x01
+
+struct VREF_t {
+    volatile uint8_t CTRLA = 0, CTRLB = 0;
+};
+
+extern VREF_t VREF;
+
+#define VREF_ADC0REFSEL_gm 0x70
+#define VREF_ADC0REFSEL_1V1_gc 0x10
+#define VREF_ADC0REFEN_bm 0x02
+
+// RSTCTRL
+struct RSTCTRL_t {
+    SimFlags8 RSTFR;
+    volatile uint8_t SWRR = 0;
+};
+
+extern RSTCTRL_t RSTCTRL;
+
+#define RSTCTRL_PORF_bm 0x01
+#define RSTCTRL_BORF_bm 0x02
+#define RSTCTRL_EXTRF_bm 0x04
+#define RSTCTRL_WDRF_bm 0x08
+#define RSTCTRL_SWRF_bm 0x10
+#define RSTCTRL_UPDIRF_bm 0x20
+
+// SLPCTRL (driven through <avr/sleep.h>)
+struct SLPCTRL_t {
+    volatile uint8_t CTRLA = 0;
+};
+
+extern SLPCTRL_t SLPCTRL;
+
+// EEPROM: EEMEM objects live in host memory, mapped at their own address
+#define EEPROM_SIZE 128
+#define EEPROM_PAGE_SIZE 32
+#define MAPPED_EEPROM_START 0
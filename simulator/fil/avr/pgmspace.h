@@ -0,0 +1,13 @@
+/**
+ * @file pgmspace.h
+ * @brief Host shim for <avr/pgmspace.h> (flash is ordinary memory)
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t*)(addr))
@@ -0,0 +1,23 @@
+/**
+ * @file sleep.h
+ * @brief Host shim for <avr/sleep.h>
+ *
+ * sleep_cpu() advances simulated time to the next event that raises an
+ * enabled interrupt.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define SLEEP_MODE_IDLE 0
+#define SLEEP_MODE_STANDBY 2
+#define SLEEP_MODE_PWR_DOWN 4
+
+void sim_set_sleep_mode(uint8_t mode);
+void sim_sleep_cpu();
+
+inline void set_sleep_mode(uint8_t mode) { sim_set_sleep_mode(mode); }
+inline void sleep_enable() {}
+inline void sleep_disable() {}
+inline void sleep_cpu() { sim_sleep_cpu(); }
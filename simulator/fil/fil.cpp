@@ -0,0 +1,191 @@
+/**
+ * @file fil.cpp
+ * @brief Firmware-in-the-loop harness: real src/ modules on a simulated HAL
+ *
+ * Drains a simulated tank past the three electrodes and reports, per wake
+ * cycle, awake time, CPU-active time, time in busy-waits, I2C bytes,
+ * EEPROM bytes written and charge. See README.md for the build command.
+ *
+ * Usage: fil [sim_hours [drain_hours]] [-q] [-r resonance_hz] [-v battery_v]
+ *            [-e i2c_error_rate] [-p press_sec[:hold_ms]]...
+ */
+
+#include "sim_hal.h"
+#include "level_logic.h"
+#include "stats.h"
+#include "rtc.h"
+#include "governor.h"
+#include "feature_set.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int firmware_main(void);
+
+// Tank model
+constexpr double FILL_HOLD_SEC = 600;   // Full for the first 10 minutes
+constexpr double ELECTRODE_HEIGHT[4] = {0.60, 0.35, 0.15, -0.05};  // CIN1..CIN4, fraction of tank (CIN4 in the sump)
+constexpr double WET_FF = 1300;         // CINx - CIN4 with the reference wet
+constexpr double DRY_FF = 100;
+constexpr double PARASITIC_FF = 2000;   // Trace and cable, common to every CINx
+constexpr double REF_WET_FF = 400;      // CIN4 electrode alone (CIN1-3 include it)
+constexpr double MENISCUS_BAND = 0.03;  // Transition width (fraction of tank)
+constexpr int32_t NOISE_FF = 8;         // Peak conversion noise
+
+constexpr double CR2032_MAH = 220;
+
+static double drain_sec = 6 * 3600.0;
+static bool quiet = false;
+
+static double tank_fill(uint64_t t_us) {
+    double t = t_us / 1e6 - FILL_HOLD_SEC;
+    if (t <= 0) {
+        return 1.0;
+    }
+    double fill = 1.0 - t / drain_sec;
+    return fill > 0 ? fill : 0;
+}
+
+// Deterministic per-sample noise (same result for the same conversion)
+static int32_t noise_ff(uint8_t cin, uint64_t t_us) {
+    uint64_t x = (t_us / 100) * 0x9E3779B97F4A7C15ull + cin;
+    x ^= x >> 31;
+    x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 29;
+    return (int32_t)(x % (2 * NOISE_FF + 1)) - NOISE_FF;
+}
+
+// Single-ended CINx: the FDC model subtracts CIN4 for MEAS1-3. Conversion
+// noise is lumped onto CIN1-3 so a differential reading carries it once
+static int32_t electrode_ff(uint8_t cin, uint64_t t_us) {
+    double s = (tank_fill(t_us) - ELECTRODE_HEIGHT[cin]) / MENISCUS_BAND + 0.5;
+    s = s < 0 ? 0 : (s > 1 ? 1 : s);
+    s = s * s * (3 - 2 * s);
+    if (cin == 3) {
+        return (int32_t)lround(PARASITIC_FF + REF_WET_FF * s);
+    }
+    double ff = PARASITIC_FF + REF_WET_FF + DRY_FF + (WET_FF - DRY_FF) * s;
+    return (int32_t)lround(ff) + noise_ff(cin, t_us);
+}
+
+static const char* level_name(WaterLevel level) {
+    switch (level) {
+        case WaterLevel::NORMAL: return "NORMAL";
+        case WaterLevel::LOW: return "LOW";
+        case WaterLevel::VERY_LOW: return "VERY_LOW";
+        case WaterLevel::CRITICAL: return "CRITICAL";
+        default: return "ERROR";
+    }
+}
+
+// Run totals over reported cycles
+struct Totals {
+    uint32_t cycles;
+    uint64_t awake_us;
+    uint64_t active_us;
+    uint64_t delay_us;
+    uint64_t i2c_bytes;
+    uint64_t eeprom_bytes;
+    double charge_uc;
+};
+
+static Totals totals;
+
+static void on_cycle(const SimCycleStats& s) {
+    totals.cycles++;
+    totals.awake_us += s.awake_us;
+    totals.active_us += s.active_us;
+    totals.delay_us += s.delay_us;
+    totals.i2c_bytes += s.i2c_bytes;
+    totals.eeprom_bytes += s.eeprom_bytes;
+    totals.charge_uc += s.charge_uc;
+
+    if (!quiet) {
+        printf("%9.1f %9.2f %9.2f %9.2f %6u %5u %10.2f %5.1f  %s\n",
+               s.start_us / 1e6, s.awake_us / 1e3, s.active_us / 1e3, s.delay_us / 1e3,
+               (unsigned)s.i2c_bytes, (unsigned)s.eeprom_bytes, s.charge_uc,
+               tank_fill(s.start_us) * 100, level_name(level_get_current()));
+    }
+}
+
+int main(int argc, char** argv) {
+    double sim_hours = 8;
+    uint8_t positional = 0;
+
+    sim_set_cycle_callback(on_cycle);
+    sim_set_cap_source(electrode_ff);
+    sim_reset();
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-q") == 0) {
+            quiet = true;
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            sim_set_piezo_resonance(atof(argv[++i]));
+        } else if (strcmp(argv[i], "-v") == 0 && i + 1 < argc) {
+            sim_set_battery_voltage(atof(argv[++i]));
+        } else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+            sim_set_i2c_error_rate(atof(argv[++i]));
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            double at = atof(argv[++i]);
+            const char* hold = strchr(argv[i], ':');
+            double hold_ms = hold ? atof(hold + 1) : 200;
+            sim_schedule_button((uint64_t)(at * 1e6), true);
+            sim_schedule_button((uint64_t)(at * 1e6 + hold_ms * 1e3), false);
+        } else if (positional == 0) {
+            sim_hours = atof(argv[i]);
+            positional++;
+        } else {
+            drain_sec = atof(argv[i]) * 3600;
+            positional++;
+        }
+    }
+
+    sim_set_end_time((uint64_t)(sim_hours * 3600e6));
+
+    if (!quiet) {
+        printf("%9s %9s %9s %9s %6s %5s %10s %5s  %s\n",
+               "t[s]", "awake[ms]", "active", "delay", "i2c[B]", "ee[B]", "charge[uC]", "fill%", "level");
+    }
+
+    try {
+        firmware_main();
+    } catch (const SimStop&) {
+    }
+
+    double sim_sec = sim_now_us() / 1e6;
+    double total_uc = sim_total_charge_uc();
+    double avg_ua = sim_sec > 0 ? total_uc / sim_sec : 0;
+
+    printf("\nSimulated %.2f h, %u wake cycles\n", sim_sec / 3600, (unsigned)totals.cycles);
+    if (totals.cycles) {
+        printf("Per wake (mean): awake %.2f ms, active %.2f ms, delay %.2f ms, "
+               "I2C %.1f B, EEPROM %.2f B, %.2f uC\n",
+               totals.awake_us / 1e3 / totals.cycles, totals.active_us / 1e3 / totals.cycles,
+               totals.delay_us / 1e3 / totals.cycles, (double)totals.i2c_bytes / totals.cycles,
+               (double)totals.eeprom_bytes / totals.cycles, totals.charge_uc / totals.cycles);
+    }
+    printf("Charge: %.1f uC awake + %.1f uC asleep = %.1f uC\n",
+           totals.charge_uc, total_uc - totals.charge_uc, total_uc);
+    printf("Average current: %.3f uA (CR2032: %.1f years)\n",
+           avg_ua, avg_ua > 0 ? CR2032_MAH * 1000 / avg_ua / 24 / 365 : 0);
+    printf("Piezo drive: %.0f Hz\n", sim_tone_hz());
+    if constexpr (features::ENERGY_GOVERNOR) {
+        static const char* const TIERS[] = {"NORMAL", "SAVING", "CRITICAL"};
+        printf("Energy tier: %s\n", TIERS[static_cast<uint8_t>(governor_tier())]);
+    }
+
+#if STATS_ENABLE
+    // Firmware's own counter block (src/stats.cpp), as read over UPDI
+    const StatsBlock& st = stats_block;
+    printf("stats_block: %u wakes, awake %.1f s, rail %.1f s, beep %u ms, max wake %.1f ms\n",
+           (unsigned)st.totals.wakes, st.totals.awake_counts / (double)RTC_COUNTS_PER_SEC,
+           st.totals.rail_counts / (double)RTC_COUNTS_PER_SEC, (unsigned)st.totals.beep_ms,
+           st.max_awake_counts * 1e3 / RTC_COUNTS_PER_SEC);
+    printf("             I2C %u transactions, %u B, %u NACKs, %u errors; "
+           "FDC %u waits, %u re-polls, %u timeouts; %u commits\n",
+           (unsigned)st.i2c_transactions, (unsigned)st.i2c_bytes, st.i2c_nacks,
+           st.totals.i2c_errors, st.fdc_waits, st.fdc_repolls, st.totals.fdc_timeouts, st.commits);
+#endif
+    return 0;
+}
@@ -0,0 +1,8 @@
+/**
+ * @file fil_firmware.cpp
+ * @brief The unmodified firmware main loop, renamed so the harness owns main()
+ */
+
+#define main firmware_main
+#include "../../src/main.cpp"
+#undef main
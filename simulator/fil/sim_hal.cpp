@@ -0,0 +1,661 @@
+/**
+ * @file sim_hal.cpp
+ * @brief Simulated clock, interrupts, sleep and EEPROM for the FIL harness
+ *
+ * Time is kept in nanoseconds and only advances through run_until() and
+ * sim_sleep_cpu(). Hardware events (RTC overflow/compare, TCB0 period,
+ * button edges) raise their INTFLAGS at the exact simulated time; enabled
+ * vectors are then called in priority order while the global interrupt
+ * flag is set.
+ */
+
+#include "sim_hal.h"
+#include "pins.hpp"
+#include <avr/io.h>
+#include <avr/eeprom.h>
+#include <avr/sleep.h>
+#include <math.h>
+#include <new>
+#include <stdio.h>
+#include <string.h>
+
+// Register instances used by the firmware
+PORT_t PORTA;
+TCA_t TCA0;
+TCB_t TCB0;
+TWI_t TWI0;
+RTC_t RTC;
+ADC_t ADC0;
+VREF_t VREF;
+RSTCTRL_t RSTCTRL;
+SLPCTRL_t SLPCTRL;
+
+// Interrupt vectors (weak: builds without a module simply never see it)
+extern "C" void RTC_CNT_vect(void) __attribute__((weak));
+extern "C" void PORTA_PORT_vect(void) __attribute__((weak));
+extern "C" void TCB0_INT_vect(void) __attribute__((weak));
+
+// EEMEM section bounds (GNU linker; null if no EEMEM object is linked,
+// e.g. the FEATURES_MINIMAL build without eeprom_config.cpp)
+extern uint8_t __start_sim_eeprom[] __attribute__((weak));
+extern uint8_t __stop_sim_eeprom[] __attribute__((weak));
+
+constexpr uint64_t NS_PER_US = 1000;
+constexpr uint64_t NEVER = UINT64_MAX;
+
+// Byte program time (tinyAVR 0-series EEPROM erase/write)
+constexpr uint64_t EEPROM_WRITE_NS = 4000 * NS_PER_US;
+
+enum class Event : uint8_t { NONE, RTC_OVF, RTC_CMP, TCB, BUTTON };
+
+struct ButtonEdge {
+    uint64_t t_ns;
+    bool pressed;
+};
+
+constexpr uint8_t MAX_BUTTON_EDGES = 64;
+
+struct SimState {
+    uint64_t now_ns;
+    uint64_t end_ns;
+    bool irq_enabled;
+    uint8_t sleep_mode;
+
+    // Peripherals
+    bool rtc_running;
+    uint64_t rtc_epoch_ns;
+    bool tcb_running;
+    uint64_t tcb_next_ns;
+    bool rail_on;
+    uint64_t rail_since_ns;
+    uint64_t fdc_busy_start_ns;
+    uint64_t fdc_busy_end_ns;
+    bool button_pressed;
+
+    ButtonEdge edges[MAX_BUTTON_EDGES];
+    uint8_t edge_count;
+    uint8_t edge_next;
+
+    // Accounting
+    bool in_cycle;
+    SimCycleStats cycle;
+    uint64_t cycle_active_ns;
+    uint64_t cycle_delay_ns;
+    double total_charge_pc;
+    double cycle_charge_pc;
+
+    SimCycleCallback on_cycle;
+    SimCapSource cap_source;
+};
+
+static SimState state;
+
+// Board model, kept across sim_reset()
+static double piezo_resonance_hz = sim_piezo::RESONANCE_HZ;
+static double battery_v = sim_piezo::VBAT_V;
+
+// --- Peripheral models ---
+
+static uint32_t rtc_hz() {
+    uint8_t presc = (RTC.CTRLA & RTC_PRESCALER_gm) >> 3;
+    return 32768u >> presc;
+}
+
+static uint64_t rtc_count_at(uint64_t t_ns) {
+    return (t_ns - state.rtc_epoch_ns) * rtc_hz() / 1000000000ull;
+}
+
+static uint64_t rtc_time_of(uint64_t count) {
+    uint32_t hz = rtc_hz();
+    return state.rtc_epoch_ns + (count * 1000000000ull + hz - 1) / hz;
+}
+
+static uint64_t tca_div() {
+    static const uint16_t divs[] = {1, 2, 4, 8, 16, 64, 256, 1024};
+    return divs[(TCA0.SINGLE.CTRLA & TCA_SINGLE_CLKSEL_gm) >> 1];
+}
+
+static bool tcb_enabled() {
+    if (!(TCB0.CTRLA & TCB_ENABLE_bm)) {
+        return false;
+    }
+    if ((TCB0.CTRLA & TCB_CLKSEL_gm) == TCB_CLKSEL_CLKTCA_gc) {
+        return (TCA0.SINGLE.CTRLA & TCA_SINGLE_ENABLE_bm) != 0;
+    }
+    return true;
+}
+
+// TCB0 keeps counting in this sleep mode
+static bool tcb_clocked(uint8_t mode) {
+    if (mode != SLEEP_MODE_STANDBY) {
+        return true;
+    }
+    // CLK_TCA stops in STANDBY; CLK_PER only with RUNSTDBY
+    return (TCB0.CTRLA & TCB_RUNSTDBY_bm) &&
+           (TCB0.CTRLA & TCB_CLKSEL_gm) != TCB_CLKSEL_CLKTCA_gc;
+}
+
+static uint64_t tcb_period_ns() {
+    uint64_t div = 1;
+    if ((TCB0.CTRLA & TCB_CLKSEL_gm) == TCB_CLKSEL_CLKTCA_gc) {
+        div = tca_div();
+    } else if ((TCB0.CTRLA & TCB_CLKSEL_gm) == TCB_CLKSEL_CLKDIV2_gc) {
+        div = 2;
+    }
+    return ((uint64_t)TCB0.CCMP + 1) * div * 1000000000ull / F_CPU;
+}
+
+static bool tone_on() {
+    return state.rail_on &&
+           (TCA0.SINGLE.CTRLA & TCA_SINGLE_ENABLE_bm) &&
+           (TCA0.SINGLE.CTRLB & TCA_SINGLE_CMP0EN_bm);
+}
+
+static double tone_hz() {
+    return (double)F_CPU / (tca_div() * (TCA0.SINGLE.PER + 1.0));
+}
+
+// Piezo current at the selected tone frequency
+static double beep_current() {
+    double r = tone_hz() / piezo_resonance_hz;
+    double x = sim_piezo::Q * (r - 1 / r);
+    return sim_current::BEEP_UA *
+           (sim_piezo::CAP_FRACTION * r + (1 - sim_piezo::CAP_FRACTION) / (1 + x * x));
+}
+
+// Pick up register writes made by the firmware since the last call
+static void sync() {
+    bool rtc_en = (RTC.CTRLA & RTC_RTCEN_bm) != 0;
+    if (rtc_en && !state.rtc_running) {
+        state.rtc_epoch_ns = state.now_ns;
+    }
+    state.rtc_running = rtc_en;
+    if (rtc_en) {
+        RTC.CNT = (uint16_t)(rtc_count_at(state.now_ns) % ((uint32_t)RTC.PER + 1));
+    }
+
+    bool tcb_en = tcb_enabled();
+    if (tcb_en && !state.tcb_running) {
+        state.tcb_next_ns = state.now_ns + tcb_period_ns();
+    }
+    state.tcb_running = tcb_en;
+
+    bool rail = (PORTA.OUT & PORTA.DIR & pins::PWR_EN) != 0;
+    if (rail && !state.rail_on) {
+        state.rail_since_ns = state.now_ns;
+    }
+    state.rail_on = rail;
+}
+
+static Event next_event(uint8_t mode, uint64_t* t_ns) {
+    Event ev = Event::NONE;
+    *t_ns = NEVER;
+
+    if (state.rtc_running) {
+        uint64_t period = (uint64_t)RTC.PER + 1;
+        uint64_t count = rtc_count_at(state.now_ns);
+        uint64_t base = count - count % period;
+
+        uint64_t ovf = rtc_time_of(base + period);
+        if (ovf < *t_ns) {
+            *t_ns = ovf;
+            ev = Event::RTC_OVF;
+        }
+
+        uint64_t cmp_count = base + RTC.CMP;
+        if (cmp_count <= count) {
+            cmp_count += period;
+        }
+        uint64_t cmp = rtc_time_of(cmp_count);
+        if (cmp < *t_ns) {
+            *t_ns = cmp;
+            ev = Event::RTC_CMP;
+        }
+    }
+
+    if (state.tcb_running && tcb_clocked(mode) && state.tcb_next_ns < *t_ns) {
+        *t_ns = state.tcb_next_ns;
+        ev = Event::TCB;
+    }
+
+    if (state.edge_next < state.edge_count &&
+        state.edges[state.edge_next].t_ns < *t_ns) {
+        *t_ns = state.edges[state.edge_next].t_ns;
+        ev = Event::BUTTON;
+    }
+
+    if (*t_ns < state.now_ns) {
+        *t_ns = state.now_ns;  // Edge scheduled in the past: deliver now
+    }
+    return ev;
+}
+
+static void fire(Event ev) {
+    switch (ev) {
+        case Event::RTC_OVF:
+            RTC.INTFLAGS.raise(RTC_OVF_bm);
+            break;
+        case Event::RTC_CMP:
+            RTC.INTFLAGS.raise(RTC_CMP_bm);
+            break;
+        case Event::TCB:
+            TCB0.INTFLAGS.raise(TCB_CAPT_bm);
+            state.tcb_next_ns += tcb_period_ns();
+            break;
+        case Event::BUTTON: {
+            bool pressed = state.edges[state.edge_next++].pressed;
+            if (pressed == state.button_pressed) {
+                break;
+            }
+            state.button_pressed = pressed;
+            if (pressed) {
+                PORTA.IN &= (uint8_t)~pins::BUTTON;
+            } else {
+                PORTA.IN |= pins::BUTTON;
+            }
+
+            uint8_t isc = PORTA.PIN0CTRL & PORT_ISC_gm;
+            bool sense = (isc == PORT_ISC_BOTHEDGES_gc) ||
+                         (isc == PORT_ISC_RISING_gc && !pressed) ||
+                         ((isc == PORT_ISC_FALLING_gc || isc == PORT_ISC_LEVEL_gc) && pressed);
+            if (sense) {
+                PORTA.INTFLAGS.raise(pins::BUTTON);
+            }
+            break;
+        }
+        case Event::NONE:
+            break;
+    }
+    sync();
+}
+
+static void call_isr(void (*vector)()) {
+    state.irq_enabled = false;  // Hardware clears I on entry
+    vector();
+    state.irq_enabled = true;   // RETI
+    sync();
+}
+
+// Run pending enabled vectors in priority order; true if any ran
+static bool dispatch_pending() {
+    bool ran = false;
+
+    // Bounded so a vector that never clears its flag can't hang the run
+    for (uint8_t guard = 0; guard < 32 && state.irq_enabled; guard++) {
+        uint8_t port_enabled = (PORTA.PIN0CTRL & PORT_ISC_gm) &&
+                               (PORTA.PIN0CTRL & PORT_ISC_gm) != PORT_ISC_INPUT_DISABLE_gc
+                               ? pins::BUTTON : 0;
+
+        if ((PORTA.INTFLAGS & port_enabled) && PORTA_PORT_vect) {
+            call_isr(PORTA_PORT_vect);
+        } else if ((RTC.INTFLAGS & RTC.INTCTRL & (RTC_OVF_bm | RTC_CMP_bm)) && RTC_CNT_vect) {
+            call_isr(RTC_CNT_vect);
+        } else if ((TCB0.INTFLAGS & TCB0.INTCTRL & TCB_CAPT_bm) && TCB0_INT_vect) {
+            call_isr(TCB0_INT_vect);
+        } else {
+            break;
+        }
+        ran = true;
+    }
+
+    return ran;
+}
+
+// --- Accounting ---
+
+static double mcu_current(uint8_t mode) {
+    switch (mode) {
+        case SLEEP_MODE_IDLE: return sim_current::MCU_IDLE_UA;
+        case SLEEP_MODE_STANDBY:
+        case SLEEP_MODE_PWR_DOWN: return sim_current::MCU_STANDBY_UA;
+        default: return sim_current::MCU_ACTIVE_UA;
+    }
+}
+
+constexpr uint8_t MODE_ACTIVE = 0xFF;
+
+// Supply current in the given CPU mode, FDC1004 conversions excluded
+static double supply_current(uint8_t mode, double extra_ua) {
+    double ua = mcu_current(mode) + extra_ua;
+    if (state.rail_on) {
+        ua += sim_current::RAIL_UA;
+    }
+    if (tone_on()) {
+        ua += beep_current();
+    }
+    return ua;
+}
+
+// Charge for [now, end) in the given CPU mode; advances time
+static void account_to(uint64_t end_ns, uint8_t mode, double extra_ua) {
+    if (end_ns <= state.now_ns) {
+        return;
+    }
+    uint64_t dt = end_ns - state.now_ns;
+
+    // uA * ns = fC; keep picocoulombs
+    double pc = supply_current(mode, extra_ua) * dt / 1000.0;
+
+    uint64_t busy_lo = state.fdc_busy_start_ns > state.now_ns ? state.fdc_busy_start_ns : state.now_ns;
+    uint64_t busy_hi = state.fdc_busy_end_ns < end_ns ? state.fdc_busy_end_ns : end_ns;
+    if (state.rail_on && state.fdc_busy_start_ns >= state.rail_since_ns && busy_hi > busy_lo) {
+        pc += sim_current::FDC_CONVERTING_UA * (busy_hi - busy_lo) / 1000.0;
+    }
+
+    state.total_charge_pc += pc;
+    if (state.in_cycle) {
+        state.cycle_charge_pc += pc;
+        if (mode == MODE_ACTIVE) {
+            state.cycle_active_ns += dt;
+        }
+    }
+
+    // A CLK_TCA-clocked TCB0 is frozen in STANDBY: push its next tick out
+    if (state.tcb_running && !tcb_clocked(mode)) {
+        state.tcb_next_ns += dt;
+    }
+
+    state.now_ns = end_ns;
+}
+
+// Advance with the CPU busy, delivering interrupts on the way
+static void run_until(uint64_t target_ns, double extra_ua) {
+    sync();
+    for (;;) {
+        uint64_t t;
+        Event ev = next_event(MODE_ACTIVE, &t);
+        if (ev == Event::NONE || t > target_ns) {
+            break;
+        }
+        account_to(t, MODE_ACTIVE, extra_ua);
+        fire(ev);
+        dispatch_pending();
+    }
+    account_to(target_ns, MODE_ACTIVE, extra_ua);
+    sync();
+}
+
+// ADC0: an (accumulated) conversion runs to completion on the STCONV write.
+// Only the internal reference against VDD is modelled; other inputs read 0.
+static void adc_command(uint8_t cmd) {
+    sync();
+    if (!(cmd & ADC_STCONV_bm) || !(ADC0.CTRLA & ADC_ENABLE_bm)) {
+        return;
+    }
+    uint16_t samples = 1u << (ADC0.CTRLB & ADC_SAMPNUM_gm);
+    uint32_t clk_div = 2u << (ADC0.CTRLC & ADC_PRESC_gm);
+
+    // VDD under the present load (tone included) sets the result
+    uint16_t code = 0;
+    bool vref_in = ADC0.MUXPOS == ADC_MUXPOS_INTREF_gc &&
+                   (VREF.CTRLA & VREF_ADC0REFSEL_gm) == VREF_ADC0REFSEL_1V1_gc;
+    if (vref_in && (ADC0.CTRLC & ADC_REFSEL_gm) == ADC_REFSEL_VDDREF_gc) {
+        double vdd = battery_v -
+                     supply_current(MODE_ACTIVE, sim_current::ADC_UA) * 1e-6 * sim_piezo::R_INTERNAL_OHM;
+        long c = lround(1.1 / vdd * 1023);
+        code = (uint16_t)(c > 1023 ? 1023 : c);
+    }
+
+    // 13 ADC clocks per 10-bit conversion, plus SAMPCTRL sample clocks
+    double us = samples * (13.0 + ADC0.SAMPCTRL) * clk_div * 1e6 / F_CPU;
+    run_until(state.now_ns + (uint64_t)(us * NS_PER_US), sim_current::ADC_UA);
+
+    ADC0.RES = samples * code;
+    ADC0.INTFLAGS.raise(ADC_RESRDY_bm);
+}
+
+static void begin_cycle() {
+    memset(&state.cycle, 0, sizeof(state.cycle));
+    state.cycle.start_us = state.now_ns / NS_PER_US;
+    state.cycle_active_ns = 0;
+    state.cycle_delay_ns = 0;
+    state.cycle_charge_pc = 0;
+    state.in_cycle = true;
+}
+
+static void end_cycle() {
+    if (!state.in_cycle) {
+        return;
+    }
+    state.in_cycle = false;
+
+    uint64_t awake_ns = state.now_ns - state.cycle.start_us * NS_PER_US;
+    if (awake_ns == 0) {
+        return;  // Overflow-only wake: ISR ran, nothing else
+    }
+
+    state.cycle.awake_us = awake_ns / NS_PER_US;
+    state.cycle.active_us = state.cycle_active_ns / NS_PER_US;
+    state.cycle.delay_us = state.cycle_delay_ns / NS_PER_US;
+    state.cycle.charge_uc = state.cycle_charge_pc / 1e6;
+    if (state.on_cycle) {
+        state.on_cycle(state.cycle);
+    }
+}
+
+// --- Harness API ---
+
+void sim_reset() {
+    new (&PORTA) PORT_t();
+    new (&TCA0) TCA_t();
+    new (&TCB0) TCB_t();
+    new (&TWI0) TWI_t();
+    new (&RTC) RTC_t();
+    new (&ADC0) ADC_t();
+    ADC0.COMMAND.on_write = adc_command;
+    new (&VREF) VREF_t();
+    new (&RSTCTRL) RSTCTRL_t();
+    new (&SLPCTRL) SLPCTRL_t();
+    RSTCTRL.RSTFR.raise(RSTCTRL_PORF_bm);
+
+    if (__start_sim_eeprom) {
+        memset(__start_sim_eeprom, 0xFF, __stop_sim_eeprom - __start_sim_eeprom);
+    }
+
+    SimCycleCallback cb = state.on_cycle;
+    SimCapSource source = state.cap_source;
+    memset(&state, 0, sizeof(state));
+    state.on_cycle = cb;
+    state.cap_source = source;
+    state.end_ns = NEVER;
+    state.sleep_mode = SLEEP_MODE_IDLE;
+    begin_cycle();  // Boot is the first wake
+}
+
+void sim_set_piezo_resonance(double hz) {
+    piezo_resonance_hz = hz;
+}
+
+void sim_set_battery_voltage(double volts) {
+    battery_v = volts;
+}
+
+double sim_tone_hz() {
+    return tone_hz();
+}
+
+uint64_t sim_now_us() {
+    return state.now_ns / NS_PER_US;
+}
+
+void sim_set_cycle_callback(SimCycleCallback cb) {
+    state.on_cycle = cb;
+}
+
+void sim_set_cap_source(SimCapSource source) {
+    state.cap_source = source;
+}
+
+void sim_schedule_button(uint64_t t_us, bool pressed) {
+    if (t_us == 0 && state.now_ns == 0) {
+        // Held at power-up: initial pin level, no edge
+        state.button_pressed = pressed;
+        if (pressed) {
+            PORTA.IN &= (uint8_t)~pins::BUTTON;
+        } else {
+            PORTA.IN |= pins::BUTTON;
+        }
+        return;
+    }
+
+    if (state.edge_count == MAX_BUTTON_EDGES) {
+        fprintf(stderr, "sim: too many button edges\n");
+        return;
+    }
+
+    // Keep sorted; edges are few
+    uint8_t i = state.edge_count++;
+    while (i > state.edge_next && state.edges[i - 1].t_ns > t_us * NS_PER_US) {
+        state.edges[i] = state.edges[i - 1];
+        i--;
+    }
+    state.edges[i] = {t_us * NS_PER_US, pressed};
+}
+
+void sim_set_end_time(uint64_t t_us) {
+    state.end_ns = t_us * NS_PER_US;
+}
+
+double sim_total_charge_uc() {
+    return state.total_charge_pc / 1e6;
+}
+
+void sim_busy_us(double us, double extra_ua) {
+    run_until(state.now_ns + (uint64_t)(us * NS_PER_US), extra_ua);
+}
+
+void sim_count_i2c(uint32_t bytes) {
+    if (state.in_cycle) {
+        state.cycle.i2c_bytes += bytes;
+    }
+}
+
+bool sim_rail_on() {
+    sync();
+    return state.rail_on;
+}
+
+uint64_t sim_rail_on_since_us() {
+    sync();
+    return state.rail_since_ns / NS_PER_US;
+}
+
+void sim_fdc_set_busy(uint64_t start_us, uint64_t end_us) {
+    state.fdc_busy_start_ns = start_us * NS_PER_US;
+    state.fdc_busy_end_ns = end_us * NS_PER_US;
+}
+
+int32_t sim_capacitance(uint8_t cin, uint64_t t_us) {
+    return state.cap_source ? state.cap_source(cin, t_us) : 0;
+}
+
+// --- Shim entry points (avr/interrupt.h, avr/sleep.h, util/delay.h) ---
+
+void sim_sei() {
+    state.irq_enabled = true;  // Pending vectors run at the next advance
+}
+
+void sim_cli() {
+    state.irq_enabled = false;
+}
+
+bool sim_irq_enabled() {
+    return state.irq_enabled;
+}
+
+void sim_set_sleep_mode(uint8_t mode) {
+    state.sleep_mode = mode;
+}
+
+void sim_delay_us(double us) {
+    uint64_t ns = (uint64_t)(us * NS_PER_US);
+    if (state.in_cycle) {
+        state.cycle_delay_ns += ns;
+    }
+    run_until(state.now_ns + ns, 0);
+}
+
+void sim_sleep_cpu() {
+    sync();
+
+    // A flag raised since sei() wakes the CPU straight away
+    if (dispatch_pending()) {
+        return;
+    }
+
+    uint8_t mode = state.sleep_mode;
+    bool deep = (mode == SLEEP_MODE_STANDBY || mode == SLEEP_MODE_PWR_DOWN) && !state.rail_on;
+    if (deep) {
+        end_cycle();
+    }
+
+    if (!state.irq_enabled) {
+        fprintf(stderr, "sim: sleep with interrupts disabled at %llu us\n",
+                (unsigned long long)sim_now_us());
+        throw SimStop();
+    }
+
+    for (;;) {
+        uint64_t t;
+        Event ev = next_event(mode, &t);
+        if (ev == Event::NONE || t >= state.end_ns) {
+            account_to(state.end_ns == NEVER ? state.now_ns : state.end_ns, mode, 0);
+            throw SimStop();  // Run over (or nothing left that could wake us)
+        }
+        account_to(t, mode, 0);
+        fire(ev);
+        if (dispatch_pending()) {
+            break;
+        }
+    }
+
+    if (deep) {
+        begin_cycle();
+    }
+}
+
+// --- avr/eeprom.h ---
+
+static void eeprom_program(uint8_t* dst, uint8_t value) {
+    *dst = value;
+    if (state.in_cycle) {
+        state.cycle.eeprom_bytes++;
+    }
+    run_until(state.now_ns + EEPROM_WRITE_NS, sim_current::EEPROM_WRITE_UA);
+}
+
+void eeprom_read_block(void* dst, const void* src, size_t n) {
+    memcpy(dst, src, n);
+}
+
+void eeprom_update_block(const void* src, void* dst, size_t n) {
+    const uint8_t* s = (const uint8_t*)src;
+    uint8_t* d = (uint8_t*)dst;
+    for (size_t i = 0; i < n; i++) {
+        if (d[i] != s[i]) {
+            eeprom_program(&d[i], s[i]);
+        }
+    }
+}
+
+void eeprom_write_block(const void* src, void* dst, size_t n) {
+    const uint8_t* s = (const uint8_t*)src;
+    uint8_t* d = (uint8_t*)dst;
+    for (size_t i = 0; i < n; i++) {
+        eeprom_program(&d[i], s[i]);
+    }
+}
+
+uint8_t eeprom_read_byte(const uint8_t* addr) {
+    return *addr;
+}
+
+void eeprom_update_byte(uint8_t* addr, uint8_t value) {
+    if (*addr != value) {
+        eeprom_program(addr, value);
+    }
+}
+
+void eeprom_write_byte(uint8_t* addr, uint8_t value) {
+    eeprom_program(addr, value);
+}
@@ -0,0 +1,173 @@
+/**
+ * @file sim_hal.h
+ * @brief Simulated ATtiny402 for the firmware-in-the-loop harness
+ *
+ * Runs the real src/ modules against host register shims. Time only
+ * moves inside busy-waits, bus transfers, EEPROM writes and sleep_cpu();
+ * interrupts are delivered at those points, so sei(); sleep_cpu(); behaves
+ * like the hardware (a wake flagged in between can't be lost).
+ *
+ * Each wake cycle (STANDBY with VDD_SW off to the next such sleep) is
+ * accounted separately: awake time, CPU-active time, busy-wait time,
+ * I2C bytes, EEPROM bytes written and charge drawn from the battery.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Supply currents used for charge accounting (microamps)
+ *
+ * Datasheet typicals at 3 V; adjust for the board under test.
+ */
+namespace sim_current {
+    constexpr double MCU_ACTIVE_UA = 3000.0;   // 20 MHz, active
+    constexpr double MCU_IDLE_UA = 1000.0;     // IDLE, peripherals clocked
+    constexpr double MCU_STANDBY_UA = 0.5;     // STANDBY, RTC on ULP oscillator
+    constexpr double RAIL_UA = 30.0;           // VDD_SW on: switch, pull-ups, DRV8210 idle
+    constexpr double FDC_CONVERTING_UA = 850.0;  // FDC1004 during a conversion
+    constexpr double BEEP_UA = 50000.0;        // Piezo driven at resonance through the DRV8210
+    constexpr double ADC_UA = 300.0;           // ADC0 converting, reference on
+    constexpr double EEPROM_WRITE_UA = 3000.0; // NVM erase/write in progress
+}
+
+/**
+ * Piezo and battery model
+ *
+ * The piezo draws BEEP_UA at its resonance: a capacitive part growing
+ * with frequency plus a motional part peaking at resonance with quality
+ * factor Q. VDD is the cell's open-circuit voltage less the drop across
+ * its internal resistance at the present supply current.
+ */
+namespace sim_piezo {
+    constexpr double RESONANCE_HZ = 3800.0;    // Default (datasheet nominal)
+    constexpr double Q = 12.0;
+    constexpr double CAP_FRACTION = 0.3;       // Capacitive share at resonance
+    constexpr double VBAT_V = 3.0;             // CR2032 open circuit (default)
+    constexpr double R_INTERNAL_OHM = 10.0;
+}
+
+/**
+ * Per-wake statistics
+ */
+struct SimCycleStats {
+    uint64_t start_us;      // Wake time
+    uint64_t awake_us;      // Wake to return to STANDBY with VDD_SW off
+    uint64_t active_us;     // CPU in ACTIVE mode
+    uint64_t delay_us;      // Spent in _delay_us/_delay_ms
+    uint32_t i2c_bytes;     // Bytes on the bus, address bytes included
+    uint32_t eeprom_bytes;  // EEPROM bytes programmed
+    double charge_uc;       // Charge drawn during the wake (microcoulombs)
+};
+
+/**
+ * Called when a wake cycle ends; may throw SimStop to end the run
+ */
+typedef void (*SimCycleCallback)(const SimCycleStats& stats);
+
+/**
+ * Absolute capacitance on CINn (0..3) at a given time, femtofarads
+ */
+typedef int32_t (*SimCapSource)(uint8_t cin, uint64_t t_us);
+
+/**
+ * Thrown from a callback to unwind out of the firmware main loop
+ */
+struct SimStop {};
+
+/**
+ * @brief Reset registers, EEPROM (erased) and simulated time
+ */
+void sim_reset();
+
+/**
+ * @brief Set the piezo resonance (default sim_piezo::RESONANCE_HZ)
+ */
+void sim_set_piezo_resonance(double hz);
+
+/**
+ * @brief Set the cell's open-circuit voltage (default sim_piezo::VBAT_V)
+ */
+void sim_set_battery_voltage(double volts);
+
+/**
+ * @brief NACK this fraction of FDC1004 transactions at random (sim_twi.cpp)
+ *
+ * Deterministic sequence; 0 (default) = clean bus.
+ */
+void sim_set_i2c_error_rate(double rate);
+
+/**
+ * @brief Tone frequency currently selected by TCA0 (Hz)
+ */
+double sim_tone_hz();
+
+/**
+ * @brief Simulated time since reset (microseconds)
+ */
+uint64_t sim_now_us();
+
+/**
+ * @brief Register the end-of-wake callback
+ */
+void sim_set_cycle_callback(SimCycleCallback cb);
+
+/**
+ * @brief Register the electrode model read by the FDC1004 simulation
+ */
+void sim_set_cap_source(SimCapSource source);
+
+/**
+ * @brief Schedule a button edge
+ *
+ * An edge at t_us = 0 before the run sets the pin level at power-up
+ * (button held through reset).
+ *
+ * @param t_us Simulated time of the edge
+ * @param pressed true = PA0 pulled low
+ */
+void sim_schedule_button(uint64_t t_us, bool pressed);
+
+/**
+ * @brief Stop once simulated time passes t_us (checked at each wake)
+ */
+void sim_set_end_time(uint64_t t_us);
+
+/**
+ * @brief Total charge drawn since reset (microcoulombs)
+ */
+double sim_total_charge_uc();
+
+/**
+ * @brief Advance time with the CPU busy (bus transfers, NVM writes)
+ *
+ * @param us Duration
+ * @param extra_ua Additional supply current for the duration
+ */
+void sim_busy_us(double us, double extra_ua);
+
+/**
+ * @brief Count bytes driven onto the I2C bus
+ */
+void sim_count_i2c(uint32_t bytes);
+
+/**
+ * @brief VDD_SW state as driven by PWR_EN
+ */
+bool sim_rail_on();
+
+/**
+ * @brief Time VDD_SW was last switched on
+ */
+uint64_t sim_rail_on_since_us();
+
+/**
+ * @brief Report the FDC1004 converting over [start_us, end_us)
+ */
+void sim_fdc_set_busy(uint64_t start_us, uint64_t end_us);
+
+/**
+ * @brief Electrode capacitance from the registered source (femtofarads)
+ */
+int32_t sim_capacitance(uint8_t cin, uint64_t t_us);
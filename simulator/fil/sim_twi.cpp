@@ -0,0 +1,316 @@
+/**
+ * @file sim_twi.cpp
+ * @brief twi.h API backed by a simulated FDC1004 (replaces src/twi.cpp)
+ *
+ * Models what fdc1004.cpp depends on:
+ * - Register pointer (1-byte write sets it, 3-byte write sets a register,
+ *   reads return the register at the pointer; no auto-increment)
+ * - Power-on reset with VDD_SW, NACK until FDC_READY_US after rail-up
+ * - FDC_CONF rate/REPEAT/MEASx_EN; enabled measurements convert back to
+ *   back and set DONE in turn (cleared by the next FDC_CONF write)
+ * - CONF_MEASx CHA/CHB/CAPDAC, OFFSET_CAL/GAIN_CAL per CHA input
+ *
+ * - Injected faults (sim_set_i2c_error_rate()): a transaction is NACKed
+ *   without reaching the model
+ *
+ * Results are encoded with the firmware's own fdc_ff_to_raw() scale so
+ * thresholds line up with the electrode model in femtofarads. Bus time is
+ * 9 bit-times per byte plus START/STOP at the nominal SCL rate.
+ */
+
+#include "twi.h"
+#include "fdc1004.h"
+#include "sim_hal.h"
+#include "stats.h"
+#include <util/delay.h>
+
+constexpr double SCL_BIT_US = TWI_FAST_MODE ? 2.5 : 10.0;
+
+// Rail-up to first ACK (switch rise time + FDC1004 power-on reset)
+constexpr uint64_t FDC_READY_US = 500;
+
+constexpr uint8_t REG_COUNT = 0x15;
+constexpr uint8_t REG_FDC_CONF = 0x0C;
+constexpr uint8_t REG_CONF_MEAS1 = 0x08;
+constexpr uint8_t REG_OFFSET_CAL1 = 0x0D;
+constexpr uint8_t REG_GAIN_CAL1 = 0x11;
+constexpr uint8_t REG_MANUFACTURER_ID = 0xFE;
+constexpr uint8_t REG_DEVICE_ID = 0xFF;
+
+constexpr uint16_t CONF_RESET = 1 << 15;
+constexpr uint16_t CONF_REPEAT = 1 << 8;
+constexpr uint16_t CONF_WRITABLE = 0x0DF0;  // RATE, REPEAT, MEASx_EN
+
+constexpr uint8_t CHB_CAPDAC = 4;
+constexpr uint8_t CHB_DISABLED = 7;
+constexpr int32_t CAPDAC_STEP_FF = 3125;
+constexpr int32_t FULL_SCALE_FF = 15000;
+
+struct FdcModel {
+    uint64_t powered_at_us;  // Rail-up this register image belongs to
+    uint8_t ptr;
+    uint16_t regs[REG_COUNT];
+    uint64_t trigger_us;     // Last FDC_CONF write
+};
+
+static FdcModel fdc = {UINT64_MAX, 0, {}, 0};
+
+static void fdc_reset_regs() {
+    for (uint8_t i = 0; i < REG_COUNT; i++) {
+        fdc.regs[i] = 0;
+    }
+    for (uint8_t i = 0; i < 4; i++) {
+        fdc.regs[REG_CONF_MEAS1 + i] = (uint16_t)(i << 13) | (CHB_DISABLED << 10);
+        fdc.regs[REG_GAIN_CAL1 + i] = 0x4000;  // 1.0 in 2.14
+    }
+    fdc.ptr = 0;
+    sim_fdc_set_busy(0, 0);
+}
+
+// Device present and out of reset; a new rail-up resets the registers
+static bool fdc_ready() {
+    if (!sim_rail_on()) {
+        return false;
+    }
+    uint64_t since = sim_rail_on_since_us();
+    if (since != fdc.powered_at_us) {
+        fdc.powered_at_us = since;
+        fdc_reset_regs();
+    }
+    return sim_now_us() >= since + FDC_READY_US;
+}
+
+static uint64_t conversion_us() {
+    switch ((fdc.regs[REG_FDC_CONF] >> 10) & 0x3) {
+        case 0b11: return 2500;
+        case 0b10: return 5000;
+        default: return 10000;
+    }
+}
+
+// Enabled measurements in conversion order
+static uint8_t enabled_list(uint8_t order[4]) {
+    uint8_t n = 0;
+    for (uint8_t m = 0; m < 4; m++) {
+        if (fdc.regs[REG_FDC_CONF] & (0x80 >> m)) {
+            order[n++] = m;
+        }
+    }
+    return n;
+}
+
+// Value of measurement m as sampled at t_us (femtofarads)
+static int32_t measure_ff(uint8_t m, uint64_t t_us) {
+    uint16_t conf = fdc.regs[REG_CONF_MEAS1 + m];
+    uint8_t cha = (conf >> 13) & 0x7;
+    uint8_t chb = (conf >> 10) & 0x7;
+    uint8_t capdac = (conf >> 5) & 0x1F;
+
+    if (cha > 3) {
+        return 0;
+    }
+
+    int32_t ff = sim_capacitance(cha, t_us);
+    if (chb < 4) {
+        ff -= sim_capacitance(chb, t_us);  // Differential CHA - CHB
+    } else if (chb == CHB_CAPDAC) {
+        ff -= capdac * CAPDAC_STEP_FF;
+    }
+
+    // GAIN_CAL is 2.14 fixed point, OFFSET_CAL 5.11 pF (signed)
+    ff = (int32_t)((int64_t)ff * fdc.regs[REG_GAIN_CAL1 + cha] / 0x4000);
+    ff += (int32_t)(int16_t)fdc.regs[REG_OFFSET_CAL1 + cha] * 1000 / 2048;
+
+    if (ff > FULL_SCALE_FF) ff = FULL_SCALE_FF;
+    if (ff < -FULL_SCALE_FF) ff = -FULL_SCALE_FF;
+    return ff;
+}
+
+// Bring DONE bits and result registers up to the current time
+static void fdc_update() {
+    uint8_t order[4];
+    uint8_t n = enabled_list(order);
+    if (n == 0) {
+        return;
+    }
+
+    uint64_t conv = conversion_us();
+    uint64_t elapsed = sim_now_us() - fdc.trigger_us;
+    uint64_t completed = elapsed / conv;
+    if (!(fdc.regs[REG_FDC_CONF] & CONF_REPEAT) && completed > n) {
+        completed = n;
+    }
+
+    for (uint8_t k = 0; k < n && k < completed; k++) {
+        // Latest completion of this slot in the sequence
+        uint64_t j = completed - 1 - ((completed - 1 - k) % n);
+        uint8_t m = order[j % n];
+        int32_t raw = fdc_ff_to_raw((int16_t)measure_ff(m, fdc.trigger_us + (j + 1) * conv));
+
+        fdc.regs[2 * m] = (uint16_t)(raw >> 8);
+        fdc.regs[2 * m + 1] = (uint16_t)((raw & 0xFF) << 8);
+        fdc.regs[REG_FDC_CONF] |= 0x08 >> m;
+    }
+}
+
+static uint16_t fdc_read_reg(uint8_t reg) {
+    if (reg == REG_MANUFACTURER_ID) return 0x5449;
+    if (reg == REG_DEVICE_ID) return 0x1004;
+    if (reg >= REG_COUNT) return 0;
+    fdc_update();
+    return fdc.regs[reg];
+}
+
+static void fdc_write_reg(uint8_t reg, uint16_t value) {
+    if (reg == REG_FDC_CONF) {
+        if (value & CONF_RESET) {
+            fdc_reset_regs();
+            return;
+        }
+        fdc.regs[REG_FDC_CONF] = value & CONF_WRITABLE;
+        fdc.trigger_us = sim_now_us();
+
+        uint8_t order[4];
+        uint8_t n = enabled_list(order);
+        uint64_t end = (value & CONF_REPEAT) ? UINT64_MAX / 1000 : fdc.trigger_us + n * conversion_us();
+        sim_fdc_set_busy(fdc.trigger_us, n ? end : fdc.trigger_us);
+    } else if (reg >= REG_CONF_MEAS1 && reg < REG_COUNT) {
+        fdc.regs[reg] = value;
+    }
+    // Result registers and IDs are read-only
+}
+
+// Fault injection: transactions to NACK, drawn from a fixed sequence
+static double error_rate = 0;
+static uint64_t error_seed = 0x2545F4914F6CDD1Dull;
+
+void sim_set_i2c_error_rate(double rate) {
+    error_rate = rate;
+}
+
+static bool inject_error() {
+    if (error_rate <= 0) {
+        return false;
+    }
+    error_seed ^= error_seed << 13;
+    error_seed ^= error_seed >> 7;
+    error_seed ^= error_seed << 17;
+    return (error_seed >> 11) * (1.0 / 9007199254740992.0) < error_rate;
+}
+
+// START + address/data bytes + STOP on the bus
+static void bus_time(uint8_t bytes) {
+    sim_busy_us(SCL_BIT_US * (9 * bytes + 2), 0);
+    sim_count_i2c(bytes);
+}
+
+// A transfer, counted as src/twi.cpp does
+static TwiStatus bus_transfer(uint8_t bytes, TwiStatus status) {
+    bus_time(bytes);
+    stats_i2c(bytes, status);
+    return status;
+}
+
+void twi_init() {
+}
+
+void twi_disable() {
+}
+
+TwiStatus twi_write(uint8_t addr, const uint8_t* data, uint8_t len, uint16_t timeout_ms) {
+    (void)timeout_ms;
+
+    if (!sim_rail_on()) {
+        stats_i2c(0, TwiStatus::BUS_ERROR);
+        return TwiStatus::BUS_ERROR;  // Pull-ups unpowered: lines stay low
+    }
+    if (addr != FDC1004_ADDR || !fdc_ready() || inject_error()) {
+        return bus_transfer(1, TwiStatus::NACK);
+    }
+    bus_transfer(1 + len, TwiStatus::OK);
+
+    if (len >= 1) {
+        fdc.ptr = data[0];
+    }
+    if (len >= 3) {
+        fdc_write_reg(data[0], ((uint16_t)data[1] << 8) | data[2]);
+    }
+    return TwiStatus::OK;
+}
+
+TwiStatus twi_read(uint8_t addr, uint8_t* data, uint8_t len, uint16_t timeout_ms) {
+    (void)timeout_ms;
+
+    if (!sim_rail_on()) {
+        stats_i2c(0, TwiStatus::BUS_ERROR);
+        return TwiStatus::BUS_ERROR;
+    }
+    if (addr != FDC1004_ADDR || !fdc_ready() || inject_error()) {
+        return bus_transfer(1, TwiStatus::NACK);
+    }
+    bus_transfer(1 + len, TwiStatus::OK);
+
+    // 16-bit registers, MSB first; further bytes repeat the register
+    uint16_t value = fdc_read_reg(fdc.ptr);
+    for (uint8_t i = 0; i < len; i++) {
+        data[i] = (i & 1) ? (uint8_t)value : (uint8_t)(value >> 8);
+    }
+    return TwiStatus::OK;
+}
+
+TwiStatus twi_write_reg(uint8_t addr, uint8_t reg, uint8_t value, uint16_t timeout_ms) {
+    uint8_t data[2] = {reg, value};
+    return twi_write(addr, data, 2, timeout_ms);
+}
+
+TwiStatus twi_read_reg(uint8_t addr, uint8_t reg, uint8_t* value, uint16_t timeout_ms) {
+    TwiStatus status = twi_write(addr, &reg, 1, timeout_ms);
+    if (status != TwiStatus::OK) {
+        return status;
+    }
+    return twi_read(addr, value, 1, timeout_ms);
+}
+
+TwiStatus twi_read_regs(uint8_t addr, uint8_t reg, uint8_t* data, uint8_t len, uint16_t timeout_ms) {
+    TwiStatus status = twi_write(addr, &reg, 1, timeout_ms);
+    if (status != TwiStatus::OK) {
+        return status;
+    }
+    return twi_read(addr, data, len, timeout_ms);
+}
+
+TwiStatus twi_probe(uint8_t addr, uint16_t timeout_ms) {
+    // 100 us per attempt, saturated and at least one, as src/twi.cpp
+    uint32_t wanted = (uint32_t)timeout_ms * 10;
+    uint16_t attempts;
+    if (wanted == 0) {
+        attempts = 1;
+    } else if (wanted > UINT16_MAX) {
+        attempts = UINT16_MAX;
+    } else {
+        attempts = (uint16_t)wanted;
+    }
+
+    do {
+        if (sim_rail_on()) {
+            // Address only; NACKs while the device powers up are no errors
+            bool ack = addr == FDC1004_ADDR && fdc_ready() && !inject_error();
+            TwiStatus status = ack ? TwiStatus::OK : TwiStatus::NACK;
+            bus_time(1);
+            stats_i2c_probe(1, status);
+            if (ack) {
+                return TwiStatus::OK;
+            }
+        }
+        _delay_us(100);
+    } while (--attempts);
+
+    stats_i2c_probe_failed();
+    return TwiStatus::TIMEOUT;
+}
+
+TwiStatus twi_recover() {
+    // The model never holds SDA: 9 clocks and a STOP, both lines up after
+    sim_busy_us(SCL_BIT_US * 10, 0);
+    return sim_rail_on() ? TwiStatus::OK : TwiStatus::BUS_ERROR;
+}
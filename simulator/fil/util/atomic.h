@@ -0,0 +1,21 @@
+/**
+ * @file atomic.h
+ * @brief Host shim for <util/atomic.h>
+ */
+
+#pragma once
+
+#include <avr/interrupt.h>
+
+bool sim_irq_enabled();
+
+struct SimAtomicBlock {
+    bool restore = sim_irq_enabled();
+    bool once = true;
+    SimAtomicBlock() { sim_cli(); }
+    ~SimAtomicBlock() { if (restore) sim_sei(); }
+};
+
+#define ATOMIC_RESTORESTATE
+#define ATOMIC_FORCEON
+#define ATOMIC_BLOCK(type) for (SimAtomicBlock sim_atomic_; sim_atomic_.once; sim_atomic_.once = false)
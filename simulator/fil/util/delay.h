@@ -0,0 +1,19 @@
+/**
+ * @file delay.h
+ * @brief Host shim for <util/delay.h>
+ *
+ * Busy-waits advance simulated time (CPU active) and are accounted
+ * separately so delay-bound code shows up in the per-wake report.
+ */
+
+#pragma once
+
+#include <avr/io.h>
+
+void sim_delay_us(double us);
+
+inline void _delay_us(double us) { sim_delay_us(us); }
+inline void _delay_ms(double ms) { sim_delay_us(ms * 1000.0); }
+inline void __builtin_avr_delay_cycles(unsigned long cycles) {
+    sim_delay_us(cycles * 1e6 / F_CPU);
+}
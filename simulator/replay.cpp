@@ -0,0 +1,493 @@
+/**
+ * @file replay.cpp
+ * @brief Replay logged FDC1004 traces through the firmware level/alert logic
+ *
+ * Links the real src/level_logic.cpp and src/alert_manager.cpp; the FDC
+ * driver and buzzer are replaced by the trace and a beep counter. Traces
+ * are memory-mapped (or streamed from stdin) and never loaded whole.
+ *
+ * Trace formats:
+ * - CSV: t_sec,c1,c2,c3 per line (raw result codes, or fF with --ff);
+ *   empty/"nan" fields mark a failed conversion, '#'/header lines skipped
+ * - Binary (.bin): little-endian records {uint32 t_sec; int32 raw[3]},
+ *   INT32_MIN in any channel marks a failed conversion
+ *
+ * Consecutive records with the same t_sec are one wake: the first feeds
+ * the wake's first sample, the rest feed fast-confirm samples (the last
+ * is repeated if the logic asks for more than were logged).
+ *
+ * Compile: g++ -std=gnu++17 -O2 -Iinclude simulator/replay.cpp src/level_logic.cpp src/alert_manager.cpp -o replay
+ *          (add -DLEVEL_DEBOUNCE_SAMPLES=n or -DLEVEL_IIR_SHIFT=n to re-score
+ *          another debounce or reading filter)
+ * Run: ./replay trace.csv [--th LOW,VLOW,CRIT] [--hyst PCT] [--base B1,B2,B3]
+ *          [--ff] [--energy wakes.csv] [--to-bin out.bin] [-q]
+ */
+
+#include "level_logic.h"
+#include "alert_manager.h"
+#include "buzzer.h"
+#include "fdc1004.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Charge per wake (microcoulombs), from the simulator/fil harness defaults
+constexpr double WAKE_BASE_UC = 6.0;        // Rail-up, FDC init, bus setup
+constexpr double CONVERSION_SET_UC = 37.0;  // 4 conversions at 100 S/s + readout
+constexpr double BEEP_UC = 5000.0;          // 100 ms tone at ~50 mA
+constexpr double BEEP_GAP_UC = 100.0;       // 100 ms gap, rail and CPU in IDLE
+constexpr double SLEEP_UA = 0.5;
+
+constexpr int32_t INVALID_RAW = INT32_MIN;
+constexpr int16_t REF_NOMINAL_FF = 2000;  // CIN4 served with every record
+
+struct TraceRecord {
+    uint32_t t_sec;
+    int32_t raw[FDC_NUM_CHANNELS];
+};
+
+static_assert(sizeof(TraceRecord) == 16, "Binary trace record layout");
+
+// --- Trace sources ---
+
+class TraceSource {
+public:
+    virtual ~TraceSource() {}
+    virtual bool next(TraceRecord& rec) = 0;
+};
+
+static bool values_in_ff = false;
+
+// Parse one CSV line; false for header/comment/blank lines
+static bool parse_csv_line(const char* p, const char* end, TraceRecord& rec) {
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    if (p == end || *p < '0' || *p > '9') {
+        return false;
+    }
+
+    char* q;
+    rec.t_sec = (uint32_t)strtoul(p, &q, 10);
+    p = q;
+
+    for (uint8_t ch = 0; ch < FDC_NUM_CHANNELS; ch++) {
+        rec.raw[ch] = INVALID_RAW;
+        if (p >= end || *p != ',') {
+            continue;
+        }
+        p++;
+        long v = strtol(p, &q, 10);
+        if (q != p) {
+            rec.raw[ch] = values_in_ff ? fdc_ff_to_raw((int16_t)v) : (int32_t)v;
+        }
+        // Skip the rest of the field (fraction, "nan", ...)
+        p = q;
+        while (p < end && *p != ',' && *p != '\n') p++;
+    }
+    return true;
+}
+
+class MappedFile {
+public:
+    const char* data = nullptr;
+    size_t size = 0;
+
+    bool open(const char* path) {
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            ::close(fd);
+            return false;
+        }
+        size = (size_t)st.st_size;
+        if (size > 0) {
+            void* m = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (m == MAP_FAILED) {
+                ::close(fd);
+                return false;
+            }
+            madvise(m, size, MADV_SEQUENTIAL);
+            data = (const char*)m;
+        }
+        ::close(fd);
+        return true;
+    }
+
+    ~MappedFile() {
+        if (data) {
+            munmap((void*)data, size);
+        }
+    }
+};
+
+class MappedCsv : public TraceSource {
+public:
+    explicit MappedCsv(const MappedFile& f) : p(f.data), end(f.data + f.size) {}
+
+    bool next(TraceRecord& rec) override {
+        while (p < end) {
+            const char* eol = (const char*)memchr(p, '\n', end - p);
+            if (!eol) eol = end;
+            bool ok = parse_csv_line(p, eol, rec);
+            p = eol + 1;
+            if (ok) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    const char* p;
+    const char* end;
+};
+
+class MappedBinary : public TraceSource {
+public:
+    explicit MappedBinary(const MappedFile& f)
+        : rec_ptr((const TraceRecord*)f.data), count(f.size / sizeof(TraceRecord)) {}
+
+    bool next(TraceRecord& rec) override {
+        if (index >= count) {
+            return false;
+        }
+        memcpy(&rec, &rec_ptr[index++], sizeof(rec));
+        return true;
+    }
+
+private:
+    const TraceRecord* rec_ptr;
+    size_t count;
+    size_t index = 0;
+};
+
+class StreamCsv : public TraceSource {
+public:
+    explicit StreamCsv(FILE* f) : file(f) {}
+
+    bool next(TraceRecord& rec) override {
+        char line[256];
+        while (fgets(line, sizeof(line), file)) {
+            if (parse_csv_line(line, line + strlen(line), rec)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    FILE* file;
+};
+
+// --- Replay state (shared with the driver stubs below) ---
+
+struct Replay {
+    TraceSource* source;
+    TraceRecord ahead;      // Lookahead record
+    bool ahead_valid;
+    TraceRecord last;       // Last record handed to the logic
+    uint32_t wake_t;
+    uint8_t wake_samples;   // fdc_measure_all() calls this wake
+    uint32_t wake_beeps;
+    uint32_t wake_bursts;
+};
+
+static Replay replay;
+
+static void advance() {
+    replay.ahead_valid = replay.source->next(replay.ahead);
+}
+
+// Firmware FDC driver: serve the wake's records in order
+bool fdc_measure_all(FdcReading readings[FDC_NUM_READINGS], uint16_t timeout_ms) {
+    (void)timeout_ms;
+
+    if (replay.wake_samples == 0 ||
+        (replay.ahead_valid && replay.ahead.t_sec == replay.wake_t)) {
+        replay.last = replay.ahead;
+        advance();
+    }
+    replay.wake_samples++;
+
+    bool all_valid = true;
+    for (uint8_t ch = 0; ch < FDC_NUM_CHANNELS; ch++) {
+        readings[ch].valid = replay.last.raw[ch] != INVALID_RAW;
+        readings[ch].raw = readings[ch].valid ? replay.last.raw[ch] : 0;
+        all_valid = all_valid && readings[ch].valid;
+    }
+
+    // Traces hold the level channels only: a healthy CIN4 reference
+    readings[FDC_REF].raw = fdc_ff_to_raw(REF_NOMINAL_FF);
+    readings[FDC_REF].valid = true;
+    return all_valid;
+}
+
+void fdc_set_ref_capdac(uint8_t steps) {
+    (void)steps;
+}
+
+// Firmware buzzer: bursts complete instantly, beeps are only counted
+void buzzer_start(BeepPattern pattern) {
+    if (pattern != BeepPattern::NONE) {
+        replay.wake_beeps += static_cast<uint8_t>(pattern);
+        replay.wake_bursts++;
+    }
+}
+
+void buzzer_stop() {
+}
+
+bool buzzer_is_active() {
+    return false;
+}
+
+// --- Output ---
+
+static const char* level_name(WaterLevel level) {
+    switch (level) {
+        case WaterLevel::NORMAL: return "NORMAL";
+        case WaterLevel::LOW: return "LOW";
+        case WaterLevel::VERY_LOW: return "VERY_LOW";
+        case WaterLevel::CRITICAL: return "CRITICAL";
+        default: return "ERROR";
+    }
+}
+
+static bool quiet = false;
+
+struct Totals {
+    uint64_t wakes;
+    uint64_t samples;
+    uint64_t beeps;
+    uint64_t bursts;
+    uint32_t transitions;
+    uint32_t alerts;
+    double wake_charge_uc;
+};
+
+static Totals totals;
+
+static double burst_charge_uc(uint32_t beeps, uint32_t bursts) {
+    return beeps * BEEP_UC + (beeps - bursts) * BEEP_GAP_UC;
+}
+
+// Alert window edges for the timeline
+static bool alert_was_active = false;
+static WaterLevel alert_level = WaterLevel::NORMAL;
+static uint32_t alert_bursts_at_start = 0;
+
+static void note_alert(uint32_t tick) {
+    bool active = alert_is_active();
+    uint32_t bursts = (uint32_t)totals.bursts + replay.wake_bursts;
+    if (active && (!alert_was_active || level_get_current() > alert_level)) {
+        totals.alerts++;
+        alert_level = level_get_current();
+        alert_bursts_at_start = bursts;
+        if (!quiet) {
+            printf("%10u ALERT start %s\n", tick, level_name(alert_level));
+        }
+    } else if (!active && alert_was_active && !quiet) {
+        printf("%10u ALERT end (%u bursts)\n", tick, bursts - alert_bursts_at_start);
+    }
+    alert_was_active = active;
+}
+
+// main.cpp alert_cycle(): burst if due
+static void alert_cycle(uint32_t tick) {
+    if (alert_is_active() && (int32_t)(tick - alert_next_event_tick()) >= 0) {
+        alert_update(tick);
+    }
+    note_alert(tick);
+}
+
+// Alert bursts scheduled between wakes (ALERT_BURST events in main.cpp)
+static void run_alerts_until(uint32_t before_tick) {
+    while (alert_is_active()) {
+        uint32_t due = alert_next_event_tick();
+        if ((int32_t)(due - before_tick) >= 0) {
+            break;
+        }
+        alert_cycle(due);
+    }
+}
+
+static void parse_triplet(const char* s, int v[3]) {
+    if (sscanf(s, "%d,%d,%d", &v[0], &v[1], &v[2]) != 3) {
+        fprintf(stderr, "Expected three comma-separated values: %s\n", s);
+        exit(1);
+    }
+}
+
+int main(int argc, char** argv) {
+    const char* trace_path = nullptr;
+    const char* energy_path = nullptr;
+    const char* bin_path = nullptr;
+    NvmConfig config = FACTORY_DEFAULTS;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        bool has_val = i + 1 < argc;
+        if (strcmp(arg, "--th") == 0 && has_val) {
+            int v[3];
+            parse_triplet(argv[++i], v);
+            config.th_low_ff = (uint16_t)v[0];
+            config.th_vlow_ff = (uint16_t)v[1];
+            config.th_crit_ff = (uint16_t)v[2];
+        } else if (strcmp(arg, "--hyst") == 0 && has_val) {
+            config.hysteresis_pct = (uint16_t)atoi(argv[++i]);
+        } else if (strcmp(arg, "--base") == 0 && has_val) {
+            int v[3];
+            parse_triplet(argv[++i], v);
+            config.base_c1_ff = (int16_t)v[0];
+            config.base_c2_ff = (int16_t)v[1];
+            config.base_c3_ff = (int16_t)v[2];
+            config.calibration_valid = 1;
+        } else if (strcmp(arg, "--energy") == 0 && has_val) {
+            energy_path = argv[++i];
+        } else if (strcmp(arg, "--to-bin") == 0 && has_val) {
+            bin_path = argv[++i];
+        } else if (strcmp(arg, "--ff") == 0) {
+            values_in_ff = true;
+        } else if (strcmp(arg, "-q") == 0) {
+            quiet = true;
+        } else if (!trace_path) {
+            trace_path = arg;
+        } else {
+            fprintf(stderr, "Unknown option %s\n", arg);
+            return 1;
+        }
+    }
+    if (!trace_path) {
+        fprintf(stderr, "Usage: %s trace.csv|trace.bin|- [options]\n", argv[0]);
+        return 1;
+    }
+
+    // Open the trace
+    MappedFile mapped;
+    TraceSource* source;
+    size_t len = strlen(trace_path);
+    if (strcmp(trace_path, "-") == 0) {
+        source = new StreamCsv(stdin);
+    } else if (!mapped.open(trace_path)) {
+        perror(trace_path);
+        return 1;
+    } else if (len > 4 && strcmp(trace_path + len - 4, ".bin") == 0) {
+        source = new MappedBinary(mapped);
+    } else {
+        source = new MappedCsv(mapped);
+    }
+    replay.source = source;
+
+    // Conversion only: write the binary form and stop
+    if (bin_path) {
+        FILE* out = fopen(bin_path, "wb");
+        if (!out) {
+            perror(bin_path);
+            return 1;
+        }
+        TraceRecord rec;
+        uint64_t n = 0;
+        while (source->next(rec)) {
+            fwrite(&rec, sizeof(rec), 1, out);
+            n++;
+        }
+        fclose(out);
+        printf("%llu records written to %s\n", (unsigned long long)n, bin_path);
+        return 0;
+    }
+
+    FILE* energy = nullptr;
+    if (energy_path) {
+        energy = fopen(energy_path, "w");
+        if (!energy) {
+            perror(energy_path);
+            return 1;
+        }
+        fprintf(energy, "t_sec,samples,beeps,charge_uc,level\n");
+    }
+
+    level_init(config);
+    alert_init();
+
+    advance();
+    uint32_t first_t = replay.ahead.t_sec;
+    uint32_t last_t = first_t;
+
+    while (replay.ahead_valid) {
+        uint32_t t = replay.ahead.t_sec;
+        run_alerts_until(t);
+
+        replay.wake_t = t;
+        replay.wake_samples = 0;
+
+        WaterLevel old_level = level_get_current();
+        WaterLevel new_level = level_update(t);
+
+        // Records logged for this wake beyond what the logic consumed
+        while (replay.ahead_valid && replay.ahead.t_sec == t) {
+            advance();
+        }
+
+        if (new_level != old_level) {
+            totals.transitions++;
+            if (!quiet) {
+                printf("%10u LEVEL %s -> %s\n", t, level_name(old_level), level_name(new_level));
+            }
+            if (new_level != WaterLevel::ERROR) {
+                alert_on_level_change(new_level);
+            }
+        }
+
+        alert_cycle(t);
+
+        double charge = WAKE_BASE_UC + replay.wake_samples * CONVERSION_SET_UC;
+        totals.wakes++;
+        totals.samples += replay.wake_samples;
+        totals.wake_charge_uc += charge;
+        if (energy) {
+            fprintf(energy, "%u,%u,%u,%.1f,%s\n", t, replay.wake_samples, replay.wake_beeps,
+                    charge + burst_charge_uc(replay.wake_beeps, replay.wake_bursts),
+                    level_name(level_get_current()));
+        }
+
+        // Bursts between wakes are billed to the wake that scheduled them
+        totals.beeps += replay.wake_beeps;
+        totals.bursts += replay.wake_bursts;
+        replay.wake_beeps = 0;
+        replay.wake_bursts = 0;
+        last_t = t;
+    }
+
+    // Let a window still open at the end of the trace run out
+    run_alerts_until(last_t + 3600);
+    totals.beeps += replay.wake_beeps;
+    totals.bursts += replay.wake_bursts;
+
+    if (energy) {
+        fclose(energy);
+    }
+
+    double span_sec = last_t - first_t;
+    double beep_uc = burst_charge_uc((uint32_t)totals.beeps, (uint32_t)totals.bursts);
+    double total_uc = totals.wake_charge_uc + beep_uc + SLEEP_UA * span_sec;
+
+    printf("\n%llu wakes over %.2f days, %llu conversion sets\n",
+           (unsigned long long)totals.wakes, span_sec / 86400,
+           (unsigned long long)totals.samples);
+    printf("%u level transitions, %u alerts, %llu beeps in %llu bursts\n",
+           totals.transitions, totals.alerts,
+           (unsigned long long)totals.beeps, (unsigned long long)totals.bursts);
+    printf("Charge: %.1f mC wakes + %.1f mC beeps + %.1f mC sleep",
+           totals.wake_charge_uc / 1000, beep_uc / 1000, SLEEP_UA * span_sec / 1000);
+    if (span_sec > 0) {
+        printf(" = %.3f uA average", total_uc / span_sec);
+    }
+    printf("\n");
+    return 0;
+}
@@ -9,8 +9,11 @@
  * - Power measurements
  * - Runs in real-time or accelerated
  *
- * Compile: g++ simulator.cpp -o simulator
+ * Compile: g++ -O2 -pthread simulator.cpp -o simulator
  * Run: ./simulator
+ * Batch (Monte-Carlo, headless): ./simulator --batch [--profiles N] [--years Y]
+ *     [--threads T] [--seed S] [--th LOW,VLOW,CRIT] [--hyst PCT] [--debounce N]
+ *     [--confirm N] [--capacity MAH]
  */
 
 #include <iostream>
@@ -18,6 +21,15 @@
 #include <string>
 #include <cstdint>
 #include <ctime>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
 
 #ifdef _WIN32
     #include <windows.h>
@@ -249,7 +261,496 @@ void print_battery_life_estimate() {
     cout << "  └─ Practical life: ~" << (int)(cr2477_years * 0.5) << " years (50% derating)\n\n";
 }
 
-int main() {
+// ============================================================================
+// Batch mode: Monte-Carlo estimator (--batch)
+// ============================================================================
+//
+// Simulates many randomized tank profiles headless, in parallel, each on its
+// own discrete-event clock (no pacing, no drawing). The per-profile model
+// follows the firmware decision path: hysteresis trip points, debounce with
+// in-wake fast confirm, wake-interval ladder plus drain prediction, and the
+// 5-minute alert window at the level's cadence.
+
+struct BatchConfig {
+    double th_ff[3] = {THRESHOLD_LOW_FF, THRESHOLD_VLOW_FF, THRESHOLD_CRIT_FF};
+    int hysteresis_pct = 10;
+    int debounce = 3;
+    int confirm_max = 6;          // Extra samples per wake while debouncing
+    int profiles = 1000;
+    double years = 1.0;
+    unsigned threads = 0;         // 0 = all cores
+    uint64_t seed = 1;
+    double capacity_mah = 220.0;  // CR2032
+};
+
+// Electrode model (fraction of tank height, femtofarads)
+constexpr double ELECTRODE_HEIGHT[3] = {0.60, 0.35, 0.15};
+constexpr double ELECTRODE_DRY_FF = 100.0;
+constexpr double ELECTRODE_WET_FF = 1300.0;
+constexpr double MENISCUS_BAND = 0.03;
+
+// Firmware timing (main.cpp / alert_manager.cpp)
+constexpr int BATCH_WAKE_LADDER_SEC[] = {10, 30, 60, 120};
+constexpr int BATCH_STABLE_WAKES_PER_STEP = 3;
+constexpr int BATCH_MIN_WAKE_SEC = 10;
+constexpr int BATCH_MAX_PREDICTED_WAKE_SEC = 1200;
+constexpr double BATCH_STABLE_DELTA_FF = 25.0;
+constexpr int BATCH_HISTORY_LEN = 4;
+constexpr int ALERT_WINDOW_SEC = 300;
+constexpr int ALERT_CADENCE_SEC[4] = {0, 10, 8, 5};
+constexpr int ALERT_BEEPS[4] = {0, 2, 3, 5};
+
+// A detection counts as false if the drain does not reach that level
+// within one alert window
+constexpr double FALSE_ALARM_GRACE_SEC = ALERT_WINDOW_SEC;
+
+constexpr double SEC_PER_YEAR = 365.0 * 24 * 3600;
+
+struct ProfileResult {
+    double avg_current_uA;
+    double false_alarms_per_year;
+    uint32_t crossings;
+    uint32_t missed;
+    vector<double> latencies_sec;
+};
+
+class ProfileSim {
+public:
+    ProfileSim(const BatchConfig& cfg, uint64_t seed) : cfg(cfg), rng(seed) {
+        uniform_real_distribution<double> u(0.0, 1.0);
+        noise_ff = 2.0 + 8.0 * u(rng);
+        temp_amp_c = 1.0 + 5.0 * u(rng);
+        temp_phase = 2 * M_PI * u(rng);
+        normal_distribution<double> tc(0.0, 1.5);
+        for (int ch = 0; ch < 3; ch++) {
+            tempco_ff_per_c[ch] = tc(rng);
+        }
+        // Drain times from half a day to two weeks (log-uniform)
+        mean_drain_sec = 43200.0 * pow(28.0, u(rng));
+        silence_prob = u(rng);
+
+        for (int ch = 0; ch < 3; ch++) {
+            double hyst = cfg.th_ff[ch] * cfg.hysteresis_pct / 100.0;
+            trip_ff[ch][0] = cfg.th_ff[ch];
+            trip_ff[ch][1] = cfg.th_ff[ch] + hyst;
+        }
+    }
+
+    ProfileResult run() {
+        double horizon = cfg.years * SEC_PER_YEAR;
+        start_drain(0.0);
+        next_measure = 0.0;
+
+        for (;;) {
+            double t = min(min(next_measure, next_alert), min(next_refill, next_button));
+            if (t >= horizon) {
+                break;
+            }
+            track_true_level(t);
+
+            if (t == next_refill) {
+                start_drain(t);
+            } else if (t == next_button) {
+                next_button = NEVER;
+                alert_active = false;  // Short press silences
+            } else if (t == next_measure) {
+                measurement_cycle(t);
+                next_measure = t + update_wake_interval();
+                alert_cycle(t);
+            } else {
+                alert_cycle(t);
+            }
+        }
+
+        ProfileResult r;
+        charge_uA_ms += CURRENT_SLEEP * horizon * 1000.0;
+        r.avg_current_uA = charge_uA_ms / (horizon * 1000.0);
+        r.false_alarms_per_year = false_alarms / cfg.years;
+        r.crossings = crossings;
+        r.missed = missed;
+        r.latencies_sec.swap(latencies);
+        return r;
+    }
+
+private:
+    static constexpr double NEVER = 1e300;
+
+    const BatchConfig& cfg;
+    mt19937_64 rng;
+
+    // Profile parameters
+    double noise_ff, temp_amp_c, temp_phase, tempco_ff_per_c[3];
+    double mean_drain_sec, silence_prob;
+
+    // Tank: fill = 1 - (t - drain_start) / drain_sec
+    double drain_start = 0, drain_sec = 1;
+    double refill_fill = 0;  // Fill at which the user tops up unprompted
+
+    // Ground truth
+    int true_level = 0;
+    double true_cross_time[4] = {};
+    bool awaiting_detection[4] = {};
+
+    // Firmware state
+    double trip_ff[3][2];
+    int current = 0, pending = 0, debounce_count = 0;
+    double last_ff[3] = {};
+    bool readings_valid = false, readings_stable = false;
+    double hist_ff[BATCH_HISTORY_LEN][3], hist_t[BATCH_HISTORY_LEN];
+    int hist_head = 0, hist_count = 0;
+    int ladder_step = 0, stable_wakes = 0;
+    bool alert_active = false;
+    int alert_level = 0;
+    double alert_start = -1, alert_last_beep = 0;
+
+    // Events
+    double next_measure = 0, next_alert = NEVER, next_refill = NEVER, next_button = NEVER;
+
+    // Results
+    double charge_uA_ms = 0;
+    uint32_t false_alarms = 0, crossings = 0, missed = 0;
+    vector<double> latencies;
+
+    double fill_at(double t) const {
+        double f = 1.0 - (t - drain_start) / drain_sec;
+        return f > 0 ? f : 0;
+    }
+
+    double true_ff(int ch, double fill) const {
+        double s = (fill - ELECTRODE_HEIGHT[ch]) / MENISCUS_BAND + 0.5;
+        s = s < 0 ? 0 : (s > 1 ? 1 : s);
+        s = s * s * (3 - 2 * s);
+        return ELECTRODE_DRY_FF + (ELECTRODE_WET_FF - ELECTRODE_DRY_FF) * s;
+    }
+
+    int level_of(double fill) const {
+        for (int ch = 2; ch >= 0; ch--) {
+            if (true_ff(ch, fill) < cfg.th_ff[ch]) {
+                return ch + 1;
+            }
+        }
+        return 0;
+    }
+
+    // Time the drain reaches the given fill (no earlier than now)
+    double time_of_fill(double fill) const {
+        return drain_start + (1.0 - fill) * drain_sec;
+    }
+
+    void start_drain(double t) {
+        uniform_real_distribution<double> u(0.0, 1.0);
+        for (int l = 1; l <= 3; l++) {
+            if (awaiting_detection[l]) {
+                missed++;  // Refilled before the firmware noticed
+                awaiting_detection[l] = false;
+            }
+        }
+        drain_start = t;
+        drain_sec = mean_drain_sec * (0.8 + 0.4 * u(rng));
+        refill_fill = 0.4 * u(rng) * u(rng);  // Most users wait for the alarm
+        next_refill = time_of_fill(refill_fill);
+        true_level = 0;
+    }
+
+    // Record true threshold crossings up to t
+    void track_true_level(double t) {
+        int level = level_of(fill_at(t));
+        while (true_level < level) {
+            true_level++;
+            // Locate the crossing between events (bisection on the drain)
+            double lo = drain_start, hi = t;
+            for (int i = 0; i < 40; i++) {
+                double mid = 0.5 * (lo + hi);
+                (level_of(fill_at(mid)) >= true_level ? hi : lo) = mid;
+            }
+            true_cross_time[true_level] = hi;
+            awaiting_detection[true_level] = true;
+            crossings++;
+        }
+        true_level = level;
+    }
+
+    double sample_ff(int ch, double t) {
+        normal_distribution<double> n(0.0, noise_ff);
+        double temp = temp_amp_c * sin(2 * M_PI * t / 86400.0 + temp_phase);
+        return true_ff(ch, fill_at(t)) + tempco_ff_per_c[ch] * temp + n(rng);
+    }
+
+    int determine_level(const double r[3]) const {
+        for (int ch = 2; ch >= 0; ch--) {
+            bool hyst = current > ch;
+            if (r[ch] < trip_ff[ch][hyst]) {
+                return ch + 1;
+            }
+        }
+        return 0;
+    }
+
+    void sample_and_debounce(double t, bool first) {
+        double r[3];
+        for (int ch = 0; ch < 3; ch++) {
+            r[ch] = sample_ff(ch, t);
+        }
+        charge_uA_ms += CURRENT_WAKE * WAKE_DURATION_MS;
+
+        if (first) {
+            readings_stable = readings_valid;
+            for (int ch = 0; ch < 3; ch++) {
+                if (fabs(r[ch] - last_ff[ch]) >= BATCH_STABLE_DELTA_FF) {
+                    readings_stable = false;
+                }
+                hist_ff[hist_head][ch] = r[ch];
+            }
+            hist_t[hist_head] = t;
+            hist_head = (hist_head + 1) % BATCH_HISTORY_LEN;
+            hist_count = min(hist_count + 1, BATCH_HISTORY_LEN);
+        }
+        for (int ch = 0; ch < 3; ch++) {
+            last_ff[ch] = r[ch];
+        }
+        readings_valid = true;
+
+        int level = determine_level(r);
+        if (level != pending) {
+            pending = level;
+            debounce_count = 1;
+        } else if (++debounce_count >= cfg.debounce) {
+            current = level;
+            debounce_count = cfg.debounce;
+        }
+    }
+
+    void on_level_changed(int old_level, double t) {
+        if (current > old_level) {
+            // Deeper level: false unless the drain really gets there
+            if (level_of(fill_at(t + FALSE_ALARM_GRACE_SEC)) < current) {
+                false_alarms++;
+            }
+            for (int l = old_level + 1; l <= current; l++) {
+                if (awaiting_detection[l]) {
+                    latencies.push_back(t - true_cross_time[l]);
+                    awaiting_detection[l] = false;
+                }
+            }
+            if (current == 3 && next_refill > t) {
+                // Alarmed user tops up within a few hours
+                exponential_distribution<double> response(1.0 / 7200.0);
+                next_refill = min(next_refill, t + response(rng));
+            }
+        }
+
+        // alert_on_level_change()
+        if (current == 0) {
+            alert_active = false;
+        } else if (alert_active) {
+            if (current > alert_level) {
+                alert_level = current;
+                alert_start = -1;
+            } else if (current < alert_level) {
+                alert_active = false;
+            }
+        } else {
+            alert_active = true;
+            alert_level = current;
+            alert_start = -1;
+            uniform_real_distribution<double> u(0.0, 1.0);
+            if (u(rng) < silence_prob) {
+                exponential_distribution<double> reach(1.0 / 30.0);
+                next_button = t + reach(rng);
+            }
+        }
+    }
+
+    void measurement_cycle(double t) {
+        int old_level = current;
+        sample_and_debounce(t, true);
+        for (int n = 0; debounce_count < cfg.debounce && n < cfg.confirm_max; n++) {
+            sample_and_debounce(t, false);
+        }
+        if (current != old_level) {
+            on_level_changed(old_level, t);
+        }
+    }
+
+    // alert_update() plus rescheduling at the next burst
+    void alert_cycle(double t) {
+        next_alert = NEVER;
+        if (!alert_active) {
+            return;
+        }
+        int cadence = ALERT_CADENCE_SEC[alert_level];
+        if (alert_start < 0) {
+            alert_start = t;
+            alert_last_beep = t - cadence;
+        }
+        if (t - alert_start >= ALERT_WINDOW_SEC) {
+            alert_active = false;
+            return;
+        }
+        if (t - alert_last_beep >= cadence) {
+            int beeps = ALERT_BEEPS[alert_level];
+            charge_uA_ms += CURRENT_BEEP * beeps * BEEP_ON_MS +
+                            CURRENT_WAKE * (beeps - 1) * BEEP_GAP_MS;
+            alert_last_beep = t;
+        }
+        next_alert = min(alert_last_beep + cadence, alert_start + ALERT_WINDOW_SEC);
+    }
+
+    double predict_seconds_to_threshold() const {
+        if (hist_count < 2 || current > 2) {
+            return -1;
+        }
+        int ch = current;
+        int newest = (hist_head + BATCH_HISTORY_LEN - 1) % BATCH_HISTORY_LEN;
+        int oldest = (hist_head + BATCH_HISTORY_LEN - hist_count) % BATCH_HISTORY_LEN;
+        double drop = hist_ff[oldest][ch] - hist_ff[newest][ch];
+        double dt = hist_t[newest] - hist_t[oldest];
+        if (drop <= 0 || dt <= 0) {
+            return -1;
+        }
+        double margin = hist_ff[newest][ch] - trip_ff[ch][0];
+        return margin <= 0 ? 0 : margin * dt / drop;
+    }
+
+    int update_wake_interval() {
+        bool stable = readings_stable && pending == current && debounce_count >= cfg.debounce;
+        if (current == 0 && stable && !alert_active) {
+            if (++stable_wakes >= BATCH_STABLE_WAKES_PER_STEP && ladder_step < 3) {
+                ladder_step++;
+                stable_wakes = 0;
+            }
+        } else {
+            ladder_step = 0;
+            stable_wakes = 0;
+        }
+        int wake_sec = BATCH_WAKE_LADDER_SEC[ladder_step];
+
+        double eta = predict_seconds_to_threshold();
+        if (eta >= 0 && stable && !alert_active) {
+            int half = (int)min(eta / 2, (double)BATCH_MAX_PREDICTED_WAKE_SEC);
+            half = max(BATCH_MIN_WAKE_SEC, half);
+            if (half < wake_sec || ladder_step == 3) {
+                wake_sec = half;
+            }
+        }
+        return wake_sec;
+    }
+};
+
+static double percentile(vector<double>& v, double p) {
+    if (v.empty()) {
+        return 0;
+    }
+    size_t k = (size_t)(p * (v.size() - 1) + 0.5);
+    nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+}
+
+static void print_distribution(const char* name, vector<double> v) {
+    double mean = 0;
+    for (double x : v) mean += x;
+    mean = v.empty() ? 0 : mean / v.size();
+    cout << "  " << left << setw(26) << name << right << fixed << setprecision(2)
+         << setw(10) << percentile(v, 0.05) << setw(10) << percentile(v, 0.50)
+         << setw(10) << percentile(v, 0.95) << setw(10) << mean << "\n";
+}
+
+static bool parse_thresholds(const char* s, double th[3]) {
+    return sscanf(s, "%lf,%lf,%lf", &th[0], &th[1], &th[2]) == 3;
+}
+
+static int run_batch(int argc, char** argv) {
+    BatchConfig cfg;
+    bool confirm_set = false;
+
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        const char* val = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (!val) {
+            cerr << "Missing value for " << arg << "\n";
+            return 1;
+        }
+        i++;
+        if (arg == "--profiles") cfg.profiles = atoi(val);
+        else if (arg == "--years") cfg.years = atof(val);
+        else if (arg == "--threads") cfg.threads = (unsigned)atoi(val);
+        else if (arg == "--seed") cfg.seed = strtoull(val, nullptr, 0);
+        else if (arg == "--hyst") cfg.hysteresis_pct = atoi(val);
+        else if (arg == "--debounce") cfg.debounce = max(1, atoi(val));
+        else if (arg == "--confirm") { cfg.confirm_max = atoi(val); confirm_set = true; }
+        else if (arg == "--capacity") cfg.capacity_mah = atof(val);
+        else if (arg == "--th" && parse_thresholds(val, cfg.th_ff)) {}
+        else {
+            cerr << "Unknown option " << arg << "\n";
+            return 1;
+        }
+    }
+    if (!confirm_set) {
+        cfg.confirm_max = 2 * cfg.debounce;
+    }
+    if (cfg.threads == 0) {
+        cfg.threads = max(1u, thread::hardware_concurrency());
+    }
+
+    vector<ProfileResult> results(cfg.profiles);
+    atomic<int> next_profile(0);
+    auto t_start = chrono::steady_clock::now();
+
+    // Profiles are independent; seeds depend only on the index, so results
+    // don't change with the thread count
+    auto worker = [&]() {
+        for (int i; (i = next_profile++) < cfg.profiles;) {
+            ProfileSim sim(cfg, cfg.seed * 0x9E3779B97F4A7C15ull + (uint64_t)i);
+            results[i] = sim.run();
+        }
+    };
+    vector<thread> pool;
+    for (unsigned t = 0; t < cfg.threads; t++) {
+        pool.emplace_back(worker);
+    }
+    for (thread& t : pool) {
+        t.join();
+    }
+
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - t_start).count();
+
+    vector<double> life_years, current_ua, latency, fa_rate;
+    uint64_t crossings = 0, missed = 0;
+    int with_false_alarm = 0;
+    for (ProfileResult& r : results) {
+        current_ua.push_back(r.avg_current_uA);
+        life_years.push_back(cfg.capacity_mah * 1000.0 / r.avg_current_uA / 8760.0);
+        fa_rate.push_back(r.false_alarms_per_year);
+        with_false_alarm += r.false_alarms_per_year > 0;
+        crossings += r.crossings;
+        missed += r.missed;
+        latency.insert(latency.end(), r.latencies_sec.begin(), r.latencies_sec.end());
+    }
+
+    cout << "Monte-Carlo batch: " << cfg.profiles << " profiles x " << cfg.years
+         << " years, " << cfg.threads << " threads, " << fixed << setprecision(1)
+         << elapsed << " s\n";
+    cout << "Config: thresholds " << setprecision(0) << cfg.th_ff[0] << "/" << cfg.th_ff[1]
+         << "/" << cfg.th_ff[2] << " fF, hysteresis " << cfg.hysteresis_pct
+         << "%, debounce " << cfg.debounce << ", fast confirm " << cfg.confirm_max << "\n\n";
+    cout << "  " << left << setw(26) << "" << right << setw(10) << "P5" << setw(10) << "P50"
+         << setw(10) << "P95" << setw(10) << "mean" << "\n";
+    print_distribution("Battery life [years]", life_years);
+    print_distribution("Average current [uA]", current_ua);
+    print_distribution("Detection latency [s]", latency);
+    print_distribution("False alarms [/year]", fa_rate);
+    cout << "\n  Threshold crossings: " << crossings << " (" << missed
+         << " refilled before detection)\n";
+    cout << "  Profiles with a false alarm: " << setprecision(1)
+         << 100.0 * with_false_alarm / max(1, cfg.profiles) << "%\n";
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && string(argv[1]) == "--batch") {
+        return run_batch(argc, argv);
+    }
+
     clear_screen();
     print_header();
 
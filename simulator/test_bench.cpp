@@ -4,14 +4,35 @@
  *
  * Runs automated test cases and displays PASS/FAIL results
  *
- * Compile: g++ test_bench.cpp -o test_bench
+ * Compile: g++ -std=gnu++17 -O2 -pthread -Iinclude simulator/test_bench.cpp -o test_bench
  * Run: ./test_bench
+ *      ./test_bench --explore [depth] [threads]   (deeper state-space search)
  */
 
 #include <iostream>
 #include <iomanip>
 #include <string>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+// Firmware modules driven by the state-space explorer
+#include "level_logic.h"
+#include "alert_manager.h"
+#include "buzzer.h"
+#include "fdc1004.h"
+#include "eeprom_config.h"
+#include "feature_set.h"
+#include "governor.h"
+#include "scheduler.h"
 
 using namespace std;
 
@@ -43,6 +64,7 @@ const char* level_name(uint8_t level) {
         case 1: return "LOW";
         case 2: return "VERY-LOW";
         case 3: return "CRITICAL";
+        case 0xFF: return "ERROR";
         default: return "UNKNOWN";
     }
 }
@@ -171,8 +193,9 @@ void test_threshold_boundaries() {
     check_level_detection("C2 exactly at VERY-LOW threshold", 700, 500, 900, 1);
     check_level_detection("C2 one below VERY-LOW threshold", 700, 499, 900, 2);
 
-    check_level_detection("C3 exactly at CRITICAL threshold", 700, 600, 300, 2);
-    check_level_detection("C3 one below CRITICAL threshold", 700, 600, 299, 3);
+    // C2 below VERY-LOW so C3 alone decides between VERY-LOW and CRITICAL
+    check_level_detection("C3 exactly at CRITICAL threshold", 700, 400, 300, 2);
+    check_level_detection("C3 one below CRITICAL threshold", 700, 400, 299, 3);
 }
 
 void test_beep_patterns() {
@@ -299,7 +322,659 @@ void test_edge_cases() {
     check_level_detection("C3 < C2 < C1 (normal gradient)", 500, 300, 100, 3);
 }
 
-int main() {
+// Energy governor (src/governor.cpp, private copy)
+namespace gov {
+#include "../src/governor.cpp"
+}
+
+void check_energy_tier(const char* test_name, uint16_t vdd_mv, uint32_t tick, EnergyTier expected) {
+    static const char* const TIERS[] = {"NORMAL", "SAVING", "CRITICAL"};
+    gov::governor_update(vdd_mv, tick);
+    EnergyTier tier = gov::governor_tier();
+    char details[128];
+    snprintf(details, sizeof(details), "%u mV => %s (expected %s)", vdd_mv,
+             TIERS[static_cast<uint8_t>(tier)], TIERS[static_cast<uint8_t>(expected)]);
+    check_test(test_name, tier == expected, details);
+}
+
+void test_energy_governor() {
+    print_test_header("ENERGY GOVERNOR");
+
+    gov::governor_init(0);
+    check_test("VDD check due at boot", gov::governor_check_due(0));
+    check_energy_tier("Fresh cell", 3000, 0, EnergyTier::NORMAL);
+    check_test("Next check after GOVERNOR_CHECK_SEC",
+               !gov::governor_check_due(GOVERNOR_CHECK_SEC - 1) &&
+               gov::governor_check_due(GOVERNOR_CHECK_SEC));
+    check_test("No chirp while NORMAL", !gov::governor_chirp_due(0));
+
+    // Sag into SAVING: chirp right away, then every LOW_BATTERY_CHIRP_SEC
+    check_energy_tier("Below 2.70 V", 2690, 100, EnergyTier::SAVING);
+    check_test("Chirp on entering SAVING", gov::governor_chirp_due(100));
+    check_test("No second chirp before interval",
+               !gov::governor_chirp_due(100 + LOW_BATTERY_CHIRP_SEC - 1));
+    check_test("Chirp after interval", gov::governor_chirp_due(100 + LOW_BATTERY_CHIRP_SEC));
+
+    // Hysteresis: leave a tier only above its threshold + margin
+    check_energy_tier("Recovered within hysteresis", 2730, 200, EnergyTier::SAVING);
+    check_energy_tier("Recovered past hysteresis", 2760, 300, EnergyTier::NORMAL);
+    check_energy_tier("Straight to CRITICAL", 2400, 400, EnergyTier::CRITICAL);
+    check_energy_tier("CRITICAL within hysteresis", 2540, 500, EnergyTier::CRITICAL);
+    check_energy_tier("CRITICAL to SAVING", 2560, 600, EnergyTier::SAVING);
+    check_energy_tier("Back to CRITICAL", 2450, 700, EnergyTier::CRITICAL);
+
+    const EnergyPolicy& policy = gov::governor_policy();
+    check_test("CRITICAL limits",
+               policy.interval_shift == 2 && policy.cadence_shift == 1 &&
+               policy.max_pattern == BeepPattern::DOUBLE && policy.debounce_samples == 2);
+}
+
+// ============================================================================
+// Exhaustive state-space exploration (--explore)
+// ============================================================================
+//
+// Drives the real alert_manager / level_logic state machines (private
+// copies per thread, see explore_modules.inc) breadth-first through every
+// sequence of samples, bursts, button presses and waits up to a depth,
+// the way main.cpp calls them. States are deduplicated on their content
+// with ticks made relative, and invariants are checked after every step.
+
+struct ExploreShadow {
+    uint32_t now;            // Current tick
+    uint32_t window_start;   // Tick of the window's first burst
+    uint32_t last_burst;     // Tick of the latest burst
+    uint16_t window_bursts;  // Bursts since the window (re)started
+    uint8_t alert_level;     // Level the open window is for
+    uint8_t silenced;        // Pressed while alerting: no beeps until a new window
+};
+
+struct Snapshot {
+    alignas(8) char alert[64];
+    alignas(8) char level[128];
+    alignas(8) char history[64];
+    ExploreShadow shadow;
+};
+
+struct Machine {
+    void (*save)(Snapshot&);
+    void (*load)(const Snapshot&);
+    void (*key)(const Snapshot&, std::string&);
+    void (*level_init)(const NvmConfig&);
+    WaterLevel (*level_update)(uint32_t);
+    WaterLevel (*level_get_current)();
+    bool (*level_is_stable)();
+    void (*alert_init)();
+    void (*alert_on_level_change)(WaterLevel);
+    bool (*alert_update)(uint32_t);
+    void (*alert_silence)();
+    bool (*alert_is_active)();
+    uint32_t (*alert_next_event_tick)();
+    const AlertConfig& (*alert_config)(uint8_t);
+};
+
+// Mock HAL for the explored modules (per explorer thread)
+static thread_local uint8_t explore_sample = 0;   // Level the electrodes show, 4 = I2C error
+static thread_local uint8_t explore_failed = 0;   // Channels failing the next read only (bit = channel)
+static thread_local int16_t explore_offset_ff = 0;  // Added to every electrode (reading filter tests)
+static thread_local int16_t explore_ref_ff = 2000;  // CIN4 single-ended (reference tests)
+static thread_local uint32_t explore_bursts = 0;  // buzzer_start() calls
+
+bool fdc_measure_all(FdcReading readings[FDC_NUM_READINGS], uint16_t timeout_ms) {
+    (void)timeout_ms;
+    for (uint8_t ch = 0; ch < FDC_NUM_READINGS; ch++) {
+        bool dry = explore_sample > ch;
+        int16_t ff = (ch == FDC_REF) ? explore_ref_ff : (dry ? 100 : 1300) + explore_offset_ff;
+        readings[ch].raw = fdc_ff_to_raw(ff);
+        readings[ch].valid = explore_sample <= FDC_NUM_CHANNELS && !(explore_failed & (1 << ch));
+    }
+    bool all_valid = explore_sample <= FDC_NUM_CHANNELS && !explore_failed;
+    explore_failed = 0;
+    return all_valid;
+}
+
+void fdc_set_ref_capdac(uint8_t steps) {
+    (void)steps;
+}
+
+void buzzer_start(BeepPattern pattern) {
+    if (pattern != BeepPattern::NONE) {
+        explore_bursts++;
+    }
+}
+
+void buzzer_stop() {
+}
+
+bool buzzer_is_active() {
+    return false;  // Bursts complete instantly
+}
+
+#define EXPLORE_NS explore_w0
+#include "explore_modules.inc"
+#undef EXPLORE_NS
+#define EXPLORE_NS explore_w1
+#include "explore_modules.inc"
+#undef EXPLORE_NS
+#define EXPLORE_NS explore_w2
+#include "explore_modules.inc"
+#undef EXPLORE_NS
+#define EXPLORE_NS explore_w3
+#include "explore_modules.inc"
+#undef EXPLORE_NS
+#define EXPLORE_NS explore_w4
+#include "explore_modules.inc"
+#undef EXPLORE_NS
+#define EXPLORE_NS explore_w5
+#include "explore_modules.inc"
+#undef EXPLORE_NS
+#define EXPLORE_NS explore_w6
+#include "explore_modules.inc"
+#undef EXPLORE_NS
+#define EXPLORE_NS explore_w7
+#include "explore_modules.inc"
+#undef EXPLORE_NS
+
+static const Machine* const EXPLORE_MACHINES[] = {
+    &explore_w0::machine, &explore_w1::machine, &explore_w2::machine, &explore_w3::machine,
+    &explore_w4::machine, &explore_w5::machine, &explore_w6::machine, &explore_w7::machine,
+};
+constexpr unsigned EXPLORE_MAX_THREADS = sizeof(EXPLORE_MACHINES) / sizeof(EXPLORE_MACHINES[0]);
+
+enum ExploreEvent : uint8_t {
+    EV_SAMPLE_NORMAL,
+    EV_SAMPLE_LOW,
+    EV_SAMPLE_VLOW,
+    EV_SAMPLE_CRIT,
+    EV_SAMPLE_ERROR,
+    EV_BURST,      // Next ALERT_BURST wake
+    EV_PRESS,      // Short press
+    EV_WAIT_1,
+    EV_WAIT_10,
+    EV_WAIT_300,
+    EV_COUNT
+};
+
+static const char* const EVENT_NAMES[EV_COUNT] = {
+    "sample NORMAL", "sample LOW", "sample VERY-LOW", "sample CRITICAL", "sample I2C error",
+    "alert burst", "button press", "wait 1 s", "wait 10 s", "wait 300 s",
+};
+
+enum ExploreViolation : uint8_t {
+    VIOL_BEEP_AFTER_SILENCE,
+    VIOL_STUCK_ACTIVE,
+    VIOL_BURST_TOO_SOON,
+    VIOL_ALERT_WHILE_NORMAL,
+    VIOL_NO_WAKE_SCHEDULED,
+    VIOL_BAD_LEVEL,
+    VIOL_COUNT,
+    VIOL_NONE = VIOL_COUNT
+};
+
+static const char* const VIOLATION_NAMES[VIOL_COUNT] = {
+    "No beep after silence",
+    "Alert window always expires",
+    "Bursts respect the level cadence",
+    "No alert while NORMAL",
+    "Active alert has its next wake scheduled",
+    "Level only moves to the sampled level",
+};
+
+// Initial ticks: boot, mid-range and just before the 32-bit wrap
+static const uint32_t EXPLORE_START_TICKS[] = {0, 100000, 0xFFFFFF00};
+
+struct ExploreNode {
+    Snapshot snap;
+    int32_t parent;   // Index in the previous layer, -1 for roots
+    uint8_t event;
+};
+
+// main.cpp alert_cycle(): burst if due, tracked against the shadow
+static ExploreViolation explore_alert_cycle(const Machine& m, ExploreShadow& sh) {
+    if (!m.alert_is_active()) {
+        return VIOL_NONE;
+    }
+    uint32_t due = m.alert_next_event_tick();
+    if ((int32_t)(sh.now - due) < 0 && due != 0) {
+        return VIOL_NONE;  // Not due yet
+    }
+
+    uint32_t before = explore_bursts;
+    m.alert_update(sh.now);
+    if (explore_bursts == before) {
+        return VIOL_NONE;
+    }
+
+    if (sh.silenced) {
+        return VIOL_BEEP_AFTER_SILENCE;
+    }
+    if (sh.window_bursts > 0 &&
+        sh.now - sh.last_burst < m.alert_config(sh.alert_level).cadence_sec) {
+        return VIOL_BURST_TOO_SOON;
+    }
+    if (sh.window_bursts == 0) {
+        sh.window_start = sh.now;
+    }
+    sh.window_bursts++;
+    sh.last_burst = sh.now;
+    return VIOL_NONE;
+}
+
+// Apply one event; false if it doesn't apply in this state
+static bool explore_step(const Machine& m, ExploreShadow& sh, uint8_t ev, ExploreViolation& viol) {
+    viol = VIOL_NONE;
+
+    switch (ev) {
+        case EV_SAMPLE_NORMAL:
+        case EV_SAMPLE_LOW:
+        case EV_SAMPLE_VLOW:
+        case EV_SAMPLE_CRIT:
+        case EV_SAMPLE_ERROR: {
+            explore_sample = ev - EV_SAMPLE_NORMAL;
+            WaterLevel old_level = m.level_get_current();
+            bool was_active = m.alert_is_active();
+            WaterLevel new_level = m.level_update(sh.now);
+
+            WaterLevel sampled = (ev == EV_SAMPLE_ERROR) ? WaterLevel::ERROR
+                                                         : static_cast<WaterLevel>(explore_sample);
+            if (new_level != old_level && new_level != sampled) {
+                viol = VIOL_BAD_LEVEL;
+            }
+
+            if (new_level != old_level && new_level != WaterLevel::ERROR) {
+                m.alert_on_level_change(new_level);
+                uint8_t lvl = static_cast<uint8_t>(new_level);
+                if (m.alert_is_active() && (!was_active || lvl > sh.alert_level)) {
+                    // New or escalated window
+                    sh.alert_level = lvl;
+                    sh.window_bursts = 0;
+                    sh.silenced = 0;
+                }
+            }
+            ExploreViolation v = explore_alert_cycle(m, sh);
+            if (viol == VIOL_NONE) {
+                viol = v;
+            }
+            break;
+        }
+        case EV_BURST: {
+            if (!m.alert_is_active()) {
+                return false;
+            }
+            uint32_t due = m.alert_next_event_tick();
+            if (due != 0 && (int32_t)(due - sh.now) > 0) {
+                sh.now = due;
+            }
+            viol = explore_alert_cycle(m, sh);
+            break;
+        }
+        case EV_PRESS:
+            if (m.alert_is_active()) {
+                sh.silenced = 1;
+            }
+            m.alert_silence();
+            break;
+        case EV_WAIT_1:
+            sh.now += 1;
+            break;
+        case EV_WAIT_10:
+            sh.now += 10;
+            break;
+        case EV_WAIT_300:
+            sh.now += 300;
+            break;
+    }
+
+    if (viol != VIOL_NONE) {
+        return true;
+    }
+
+    if (!m.alert_is_active()) {
+        sh.window_bursts = 0;
+        return true;
+    }
+
+    if (m.level_get_current() == WaterLevel::NORMAL) {
+        viol = VIOL_ALERT_WHILE_NORMAL;
+    } else if (ev <= EV_BURST) {
+        // Just went through alert_cycle(): the window has started, is
+        // within its duration and has a burst or expiry coming up
+        const AlertConfig& cfg = m.alert_config(sh.alert_level);
+        uint32_t ahead = m.alert_next_event_tick() - sh.now;
+        if (sh.window_bursts == 0 || ahead == 0 || ahead > cfg.duration_sec) {
+            viol = VIOL_NO_WAKE_SCHEDULED;
+        } else if (sh.now - sh.window_start >= cfg.duration_sec ||
+                   sh.window_bursts > cfg.duration_sec / cfg.cadence_sec + 1) {
+            viol = VIOL_STUCK_ACTIVE;
+        }
+    }
+    return true;
+}
+
+struct ExploreReport {
+    uint64_t states = 0;
+    uint64_t transitions = 0;
+    uint32_t depth = 0;
+    uint32_t count[VIOL_COUNT] = {};
+    vector<string> example[VIOL_COUNT];  // Shortest counterexample per invariant
+    double seconds = 0;
+};
+
+// Visited set, sharded to keep lock contention low
+struct VisitedSet {
+    static constexpr unsigned SHARDS = 64;
+    unordered_set<string> shard[SHARDS];
+    mutex lock[SHARDS];
+
+    bool insert(const string& key) {
+        size_t h = hash<string>()(key);
+        unsigned i = h % SHARDS;
+        lock_guard<mutex> guard(lock[i]);
+        return shard[i].insert(key).second;
+    }
+};
+
+static vector<string> explore_trace(const vector<vector<ExploreNode>>& layers,
+                                    size_t layer, int32_t index, uint8_t last_event) {
+    vector<string> trace;
+    trace.push_back(EVENT_NAMES[last_event]);
+    while (index >= 0) {
+        const ExploreNode& n = layers[layer][index];
+        if (n.parent < 0) {
+            char root[48];
+            snprintf(root, sizeof(root), "boot at tick %u", (unsigned)n.snap.shadow.now);
+            trace.push_back(root);
+            break;
+        }
+        trace.push_back(EVENT_NAMES[n.event]);
+        index = n.parent;
+        layer--;
+    }
+    reverse(trace.begin(), trace.end());
+    return trace;
+}
+
+static ExploreReport explore(uint32_t max_depth, unsigned threads) {
+    ExploreReport report;
+    auto t_start = chrono::steady_clock::now();
+    threads = max(1u, min(threads, EXPLORE_MAX_THREADS));
+
+    VisitedSet visited;
+    vector<vector<ExploreNode>> layers(1);
+    const Machine& m0 = *EXPLORE_MACHINES[0];
+    string key;
+
+    for (uint32_t tick : EXPLORE_START_TICKS) {
+        ExploreNode root = {};
+        m0.level_init(FACTORY_DEFAULTS);
+        m0.alert_init();
+        m0.save(root.snap);
+        root.snap.shadow.now = tick;
+        root.parent = -1;
+        // Roots stay distinct: absolute tick (0, wrap) is what they probe
+        m0.key(root.snap, key);
+        key.append((const char*)&tick, sizeof(tick));
+        visited.insert(key);
+        layers[0].push_back(root);
+    }
+    report.states = layers[0].size();
+
+    mutex report_lock;
+    for (uint32_t depth = 0; depth < max_depth && !layers.back().empty(); depth++) {
+        const vector<ExploreNode>& frontier = layers.back();
+        vector<vector<ExploreNode>> produced(threads);
+        atomic<size_t> next(0);
+        atomic<uint64_t> transitions(0);
+
+        auto worker = [&](unsigned w) {
+            const Machine& m = *EXPLORE_MACHINES[w];
+            string k;
+            for (size_t i; (i = next++) < frontier.size();) {
+                for (uint8_t ev = 0; ev < EV_COUNT; ev++) {
+                    ExploreNode child;
+                    child.snap = frontier[i].snap;
+                    m.load(child.snap);
+
+                    ExploreViolation viol;
+                    if (!explore_step(m, child.snap.shadow, ev, viol)) {
+                        continue;
+                    }
+                    transitions++;
+
+                    if (viol != VIOL_NONE) {
+                        lock_guard<mutex> guard(report_lock);
+                        if (report.count[viol]++ == 0) {
+                            report.example[viol] = explore_trace(layers, layers.size() - 1,
+                                                                 (int32_t)i, ev);
+                        }
+                        continue;  // Don't expand a broken state
+                    }
+
+                    m.save(child.snap);
+                    m.key(child.snap, k);
+                    if (visited.insert(k)) {
+                        child.parent = (int32_t)i;
+                        child.event = ev;
+                        produced[w].push_back(child);
+                    }
+                }
+            }
+        };
+
+        vector<thread> pool;
+        for (unsigned w = 0; w < threads; w++) {
+            pool.emplace_back(worker, w);
+        }
+        for (thread& t : pool) {
+            t.join();
+        }
+
+        vector<ExploreNode> layer;
+        for (vector<ExploreNode>& p : produced) {
+            layer.insert(layer.end(), p.begin(), p.end());
+        }
+        report.states += layer.size();
+        report.transitions += transitions;
+        report.depth = depth + 1;
+        layers.push_back(std::move(layer));
+    }
+
+    report.seconds = chrono::duration<double>(chrono::steady_clock::now() - t_start).count();
+    return report;
+}
+
+void test_state_space(uint32_t depth, unsigned threads) {
+    print_test_header("EXHAUSTIVE STATE SPACE (alert_manager + level_logic)");
+
+    ExploreReport r = explore(depth, threads);
+    cout << "  " << r.states << " distinct states, " << r.transitions << " transitions, depth "
+         << r.depth << ", " << fixed << setprecision(2) << r.seconds << " s\n";
+
+    for (uint8_t v = 0; v < VIOL_COUNT; v++) {
+        char details[64];
+        snprintf(details, sizeof(details), "%u violating transitions", r.count[v]);
+        check_test(VIOLATION_NAMES[v], r.count[v] == 0, r.count[v] ? details : "");
+        if (r.count[v]) {
+            cout << "      Counterexample:";
+            for (const string& step : r.example[v]) {
+                cout << "\n        " << step;
+            }
+            cout << "\n";
+        }
+    }
+}
+
+// Partial results: a channel failing one read is held (explorer copy of level_logic.cpp)
+void check_fault_level(const char* test_name, uint8_t sample, uint8_t failed, WaterLevel expected) {
+    explore_sample = sample;
+    explore_failed = failed;
+    WaterLevel level = explore_w0::ll::level_update(0);
+    char details[128];
+    snprintf(details, sizeof(details), "sample %u, failed mask 0x%X => %s (expected %s)", sample,
+             failed, level_name(static_cast<uint8_t>(level)), level_name(static_cast<uint8_t>(expected)));
+    check_test(test_name, level == expected, details);
+}
+
+void test_sensor_faults() {
+    print_test_header("SENSOR FAULTS");
+
+    explore_w0::ll::level_init(FACTORY_DEFAULTS);
+    check_fault_level("Clean reading", 0, 0x0, WaterLevel::NORMAL);
+    check_fault_level("CIN2 read fails once (held)", 0, 0x2, WaterLevel::NORMAL);
+    check_fault_level("CIN2 fails again", 0, 0x2, WaterLevel::ERROR);
+    check_fault_level("Recovered", 0, 0x0, WaterLevel::NORMAL);
+    check_fault_level("All channels fail", 0, 0x7, WaterLevel::ERROR);
+    check_fault_level("Recovered after full failure", 0, 0x0, WaterLevel::NORMAL);
+    check_fault_level("CIN1 held, CIN3 shows CRITICAL", 3, 0x1, WaterLevel::CRITICAL);
+
+    explore_w0::ll::level_init(FACTORY_DEFAULTS);
+    check_fault_level("No reading to hold after boot", 0, 0x1, WaterLevel::ERROR);
+
+    // CIN4 reference (MEAS4): checked in every sample
+    check_fault_level("Clean reading after boot", 0, 0x0, WaterLevel::NORMAL);
+    check_fault_level("CIN4 read fails once (held)", 0, 0x8, WaterLevel::NORMAL);
+    explore_ref_ff = 0;
+    check_fault_level("CIN4 open", 0, 0x0, WaterLevel::ERROR);
+    check_test("CIN4 open fails validation", !explore_w0::ll::level_validate_cin4(LEVEL_REF_MIN_FF));
+    explore_ref_ff = 15000;
+    check_fault_level("CIN4 at full scale", 0, 0x0, WaterLevel::ERROR);
+    explore_ref_ff = 2000;
+    check_fault_level("CIN4 reconnected", 0, 0x0, WaterLevel::NORMAL);
+    check_test("CIN4 passes validation", explore_w0::ll::level_validate_cin4(LEVEL_REF_MIN_FF));
+    explore_sample = 0;
+}
+
+// Reading IIR: small deviations are smoothed, steps pass straight through
+void check_filtered_c1(const char* test_name, int16_t offset_ff, int16_t expected_ff) {
+    explore_offset_ff = offset_ff;
+    explore_w0::ll::level_update(0);
+    int16_t c1_ff = 0;
+    explore_w0::ll::level_get_raw_readings(&c1_ff, nullptr, nullptr);
+    char details[128];
+    snprintf(details, sizeof(details), "electrode %d fF => C1 %d fF (expected %d)", 1300 + offset_ff,
+             c1_ff, expected_ff);
+    check_test(test_name, c1_ff >= expected_ff - 1 && c1_ff <= expected_ff + 1, details);
+}
+
+void test_reading_filter() {
+    print_test_header("READING FILTER");
+
+    constexpr uint8_t shift = explore_w0::ll::IIR_SHIFT;
+    explore_sample = 0;
+    explore_w0::ll::level_init(FACTORY_DEFAULTS);
+    check_filtered_c1("First reading taken as is", 0, 1300);
+    check_filtered_c1("Small deviation smoothed", 20, 1300 + (shift ? 20 / (1 << shift) : 20));
+    check_filtered_c1("Step passes straight through", 400, 1700);
+    check_filtered_c1("Step back down", 0, 1300);
+    explore_offset_ff = 0;
+}
+
+// Calibrated trip points: a channel trips once it has dropped its threshold
+// below its full-tank baseline
+void check_calibrated_c1(const char* test_name, int16_t c1_ff, WaterLevel expected) {
+    static uint32_t tick = 0;
+    explore_offset_ff = c1_ff - 1300;
+    WaterLevel level = WaterLevel::NORMAL;
+    for (uint8_t i = 0; i < 8; i++) {
+        level = explore_w0::ll::level_update(tick += 10);
+    }
+    char details[128];
+    snprintf(details, sizeof(details), "C1 %d fF => %s (expected %s)", c1_ff,
+             level_name(static_cast<uint8_t>(level)), level_name(static_cast<uint8_t>(expected)));
+    check_test(test_name, level == expected, details);
+}
+
+void test_calibrated_trip() {
+    print_test_header("CALIBRATED TRIP POINTS");
+
+    // C1: baseline 1300 fF, threshold 800 fF => trips below 500 fF, back
+    // above 580 fF; C2 / C3 trip points (100 fF) stay out of the way
+    NvmConfig config = FACTORY_DEFAULTS;
+    config.base_c1_ff = 1300;
+    config.base_c2_ff = 600;
+    config.base_c3_ff = 400;
+    config.calibration_valid = 1;
+    explore_sample = 0;
+    explore_w0::ll::level_init(config);
+    check_calibrated_c1("Full tank is NORMAL", 1300, WaterLevel::NORMAL);
+    check_calibrated_c1("Just above baseline - threshold", 510, WaterLevel::NORMAL);
+    check_calibrated_c1("Below baseline - threshold is LOW", 490, WaterLevel::LOW);
+    check_calibrated_c1("Within hysteresis stays LOW", 570, WaterLevel::LOW);
+    check_calibrated_c1("Past hysteresis is NORMAL again", 590, WaterLevel::NORMAL);
+    explore_offset_ff = 0;
+}
+
+// Baseline drift: a calibrated unit follows slow drift while solidly NORMAL
+bool drift_after(NvmConfig& config, int16_t offset_ff, uint16_t wakes, int16_t* base_c1) {
+    explore_offset_ff = offset_ff;
+    for (uint16_t i = 0; i < wakes; i++) {
+        explore_w0::ll::level_update(i * 120);
+    }
+    int16_t base_ff[FDC_NUM_CHANNELS];
+    uint16_t drift_steps;
+    bool moved = explore_w0::ll::level_baseline_drift(base_ff, &drift_steps);
+    if (moved) {
+        // Saved and applied, as main.cpp does
+        config.base_c1_ff = base_ff[0];
+        config.base_c2_ff = base_ff[1];
+        config.base_c3_ff = base_ff[2];
+        config.drift_steps = drift_steps;
+        explore_w0::ll::level_set_config(config);
+    }
+    *base_c1 = config.base_c1_ff;
+    return moved;
+}
+
+void test_baseline_drift() {
+    print_test_header("BASELINE DRIFT");
+
+    NvmConfig config = FACTORY_DEFAULTS;
+    config.base_c1_ff = config.base_c2_ff = config.base_c3_ff = 1300;
+    config.calibration_valid = 1;
+    explore_sample = 0;
+    explore_offset_ff = 0;
+    explore_w0::ll::level_init(config);
+    check_test("Calibrated full tank is NORMAL",
+               explore_w0::ll::level_update(0) == WaterLevel::NORMAL);
+
+    int16_t base = 0;
+    char details[128];
+    bool moved = drift_after(config, 60, 400, &base);
+    snprintf(details, sizeof(details), "baseline %d fF, steps 0x%04X", base, config.drift_steps);
+    check_test("Drift of +60 fF saved as one step", moved && base == 1325 && config.drift_steps == 0x0421,
+               details);
+    moved = drift_after(config, 60, 400, &base);
+    snprintf(details, sizeof(details), "baseline %d fF", base);
+    check_test("Second step follows", moved && base == 1350, details);
+    moved = drift_after(config, 60, 400, &base);
+    snprintf(details, sizeof(details), "baseline %d fF", base);
+    check_test("Settled within a step", !moved && base == 1350, details);
+    moved = drift_after(config, -200, 800, &base);
+    snprintf(details, sizeof(details), "baseline %d fF", base);
+    check_test("Partly dry electrode not learned", !moved && base == 1350, details);
+
+    config.drift_steps = 15 | (15 << 5) | (15 << 10);
+    explore_w0::ll::level_set_config(config);
+    check_test("Drift budget used up", !drift_after(config, 90, 800, &base));
+
+    config.calibration_valid = 0;
+    explore_w0::ll::level_init(config);
+    check_test("Uncalibrated: nothing to track", !drift_after(config, 60, 400, &base));
+    explore_offset_ff = 0;
+}
+
+// Default search depth for a plain run (a few seconds)
+constexpr uint32_t EXPLORE_DEFAULT_DEPTH = 7;
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "--explore") == 0) {
+        uint32_t depth = (argc > 2) ? (uint32_t)atoi(argv[2]) : 10;
+        unsigned threads = (argc > 3) ? (unsigned)atoi(argv[3]) : thread::hardware_concurrency();
+        print_header();
+        test_state_space(depth, threads);
+        print_summary();
+        return (results.failed == 0) ? 0 : 1;
+    }
+
     print_header();
 
     // Run all test suites
@@ -311,6 +986,12 @@ int main() {
     test_battery_life();
     test_sensor_range();
     test_edge_cases();
+    test_energy_governor();
+    test_sensor_faults();
+    test_reading_filter();
+    test_calibrated_trip();
+    test_baseline_drift();
+    test_state_space(EXPLORE_DEFAULT_DEPTH, thread::hardware_concurrency());
 
     // Print summary
     print_summary();
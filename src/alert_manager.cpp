@@ -10,6 +10,7 @@
 struct AlertState {
     WaterLevel current_alert_level;  // Level being alerted for
     bool active;                      // True if in alert window
+    bool started;                     // alert_start_tick latched by first update
     uint32_t alert_start_tick;        // Tick when alert started
     uint32_t last_beep_tick;          // Tick of last beep
     AlertConfig config;               // Current alert configuration
@@ -18,6 +19,7 @@ struct AlertState {
 static AlertState state = {
     .current_alert_level = WaterLevel::NORMAL,
     .active = false,
+    .started = false,
     .alert_start_tick = 0,
     .last_beep_tick = 0,
     .config = {BeepPattern::NONE, 0, 0}
@@ -31,14 +33,63 @@ static const AlertConfig ALERT_CONFIGS[] = {
     {BeepPattern::FIVE, 5, 300},           // CRITICAL - 5 beeps every 5s for 5min
 };
 
+// Energy limits (alert_set_limits)
+struct AlertLimits {
+    uint8_t cadence_shift;
+    BeepPattern max_pattern;
+};
+
+static AlertLimits limits = {0, BeepPattern::FIVE};
+
+/**
+ * Level's configuration within the energy limits
+ */
+static AlertConfig config_for(WaterLevel level) {
+    AlertConfig config = ALERT_CONFIGS[static_cast<uint8_t>(level)];
+    config.cadence_sec <<= limits.cadence_shift;
+    if (config.pattern > limits.max_pattern) {
+        config.pattern = limits.max_pattern;
+    }
+    return config;
+}
+
 void alert_init() {
     state.current_alert_level = WaterLevel::NORMAL;
     state.active = false;
+    state.started = false;
     state.alert_start_tick = 0;
     state.last_beep_tick = 0;
     state.config = ALERT_CONFIGS[0];
 }
 
+void alert_set_limits(uint8_t cadence_shift, BeepPattern max_pattern) {
+    limits.cadence_shift = cadence_shift;
+    limits.max_pattern = max_pattern;
+    if (state.active) {
+        state.config = config_for(state.current_alert_level);
+    }
+}
+
+void alert_save_warm(AlertWarmState& out) {
+    out.alert_start_tick = state.alert_start_tick;
+    out.last_beep_tick = state.last_beep_tick;
+    out.level = state.current_alert_level;
+    out.active = state.active;
+    out.started = state.started;
+}
+
+void alert_restore_warm(const AlertWarmState& in, uint32_t tick_shift) {
+    if (in.level > WaterLevel::CRITICAL) {
+        return;
+    }
+    state.current_alert_level = in.level;
+    state.active = in.active;
+    state.started = in.started;
+    state.alert_start_tick = in.alert_start_tick + tick_shift;
+    state.last_beep_tick = in.last_beep_tick + tick_shift;
+    state.config = config_for(in.level);
+}
+
 void alert_on_level_change(WaterLevel level) {
     // Ignore ERROR state
     if (level == WaterLevel::ERROR) {
@@ -61,8 +112,8 @@ void alert_on_level_change(WaterLevel level) {
             // Escalation: worse level detected
             // Restart alert window at new level
             state.current_alert_level = level;
-            state.config = ALERT_CONFIGS[static_cast<uint8_t>(level)];
-            state.alert_start_tick = 0;  // Will be set on next update
+            state.config = config_for(level);
+            state.started = false;  // Start tick set on next update
             state.last_beep_tick = 0;
         } else if (level < state.current_alert_level) {
             // De-escalation: better level (but not NORMAL)
@@ -77,9 +128,9 @@ void alert_on_level_change(WaterLevel level) {
     // Not currently alerting, and level is not NORMAL
     // Start new alert window
     state.current_alert_level = level;
-    state.config = ALERT_CONFIGS[static_cast<uint8_t>(level)];
+    state.config = config_for(level);
     state.active = true;
-    state.alert_start_tick = 0;  // Will be set on next update
+    state.started = false;  // Start tick set on next update
     state.last_beep_tick = 0;
 }
 
@@ -88,15 +139,15 @@ bool alert_update(uint32_t tick) {
         return false;  // No alert active
     }
 
-    // Initialize start tick on first update
-    if (state.alert_start_tick == 0) {
+    // Initialize start tick on first update (tick 0 is a valid start)
+    if (!state.started) {
+        state.started = true;
         state.alert_start_tick = tick;
-        state.last_beep_tick = tick - (state.config.cadence_sec / 10);  // Force immediate beep
+        state.last_beep_tick = tick - state.config.cadence_sec;  // Force immediate beep
     }
 
-    // Check if alert window expired
-    uint32_t elapsed_ticks = tick - state.alert_start_tick;
-    uint32_t elapsed_sec = elapsed_ticks * 10;  // Each tick is 10 seconds
+    // Check if alert window expired (ticks are seconds)
+    uint32_t elapsed_sec = tick - state.alert_start_tick;
 
     if (elapsed_sec >= state.config.duration_sec) {
         // Alert window expired
@@ -106,8 +157,7 @@ bool alert_update(uint32_t tick) {
     }
 
     // Check if it's time for next beep
-    uint32_t ticks_since_beep = tick - state.last_beep_tick;
-    uint32_t sec_since_beep = ticks_since_beep * 10;
+    uint32_t sec_since_beep = tick - state.last_beep_tick;
 
     if (sec_since_beep >= state.config.cadence_sec) {
         // Time to beep
@@ -130,13 +180,26 @@ bool alert_is_active() {
     return state.active;
 }
 
-uint16_t alert_get_remaining_sec() {
-    if (!state.active || state.alert_start_tick == 0) {
+uint32_t alert_next_event_tick() {
+    if (!state.started) {
+        return 0;  // Window not started yet: due on next update
+    }
+
+    // Next burst or window expiry, whichever comes first
+    uint32_t next_beep = state.last_beep_tick + state.config.cadence_sec;
+    uint32_t window_end = state.alert_start_tick + state.config.duration_sec;
+    return ((int32_t)(window_end - next_beep) < 0) ? window_end : next_beep;
+}
+
+uint16_t alert_get_remaining_sec(uint32_t tick) {
+    if (!state.active || !state.started) {
         return 0;
     }
 
     // Calculate remaining time
-    uint32_t elapsed_ticks = 0;  // Would need current tick passed in
-    // For now, return config duration (this is a simplified implementation)
-    return state.config.duration_sec;
+    uint32_t elapsed_sec = tick - state.alert_start_tick;
+    if (elapsed_sec >= state.config.duration_sec) {
+        return 0;
+    }
+    return state.config.duration_sec - elapsed_sec;
 }
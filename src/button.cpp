@@ -1,44 +1,48 @@
 /**
  * @file button.cpp
  * @brief Button handler implementation
+ *
+ * The pin-change ISR timestamps press and release edges with the RTC
+ * counter, so press durations are real time regardless of how often the
+ * main loop runs. Events are classified on release and the main loop is
+ * woken to handle them.
  */
 
 #include "button.h"
 #include "pins.hpp"
 #include "power.h"
+#include "rtc.h"
 #include <avr/io.h>
 #include <avr/interrupt.h>
-#include <util/delay.h>
 
 // Forward declaration for power module wake source notification
 extern void PORTA_PORT_vect_impl();
 
-// Button state
+// Button state (written by the PORTA ISR)
 struct ButtonState {
-    bool pressed;
-    bool was_pressed;
-    uint8_t press_duration;  // In ~100ms units (deciseconds)
-    bool event_pending;
-    ButtonEvent pending_event;
+    bool pressed;               // PA0 low as of the last edge
+    bool boot_press;            // Current press was already down at button_init()
+    uint32_t press_counts;      // RTC counts at the press edge
+    ButtonEvent pending_event;  // Classified on release, taken by button_check()
 };
 
-static ButtonState state = {false, false, 0, false, ButtonEvent::NONE};
+static volatile ButtonState state = {false, false, 0, ButtonEvent::NONE};
 
-// Timing constants
-constexpr uint8_t SHORT_PRESS_THRESHOLD = 30;  // 3 seconds = 30 deciseconds
-constexpr uint8_t BOOT_HOLD_THRESHOLD = 50;    // 5 seconds = 50 deciseconds
+// Timing constants (RTC counts)
+constexpr uint32_t SHORT_PRESS_THRESHOLD = 3UL * RTC_COUNTS_PER_SEC;  // 3 seconds
+constexpr uint32_t BOOT_HOLD_THRESHOLD = 5UL * RTC_COUNTS_PER_SEC;    // 5 seconds
+constexpr uint32_t BOUNCE_COUNTS = 20;  // ~20 ms: shorter presses are contact bounce
+
+void button_init(bool boot_hold) {
+    // Interrupts are still disabled here (system_init), and the RTC is running
+    state.pressed = button_is_pressed();
+    state.boot_press = boot_hold && state.pressed;
+    state.press_counts = rtc_get_counts_locked();
+    state.pending_event = ButtonEvent::NONE;
 
-void button_init() {
     // Configure PA0 as input with pull-up (already done in power_init, but ensure)
     PORTA.DIRCLR = pins::BUTTON;
     PORTA.PIN0CTRL = PORT_PULLUPEN_bm | PORT_ISC_BOTHEDGES_gc;  // Pull-up + both edges interrupt
-
-    // Clear state
-    state.pressed = false;
-    state.was_pressed = false;
-    state.press_duration = 0;
-    state.event_pending = false;
-    state.pending_event = ButtonEvent::NONE;
 }
 
 bool button_is_pressed() {
@@ -47,72 +51,58 @@ bool button_is_pressed() {
 }
 
 ButtonEvent button_check() {
-    bool currently_pressed = button_is_pressed();
-
-    // Detect press/release edges
-    if (currently_pressed && !state.was_pressed) {
-        // Button just pressed
-        state.pressed = true;
-        state.press_duration = 0;
-    } else if (!currently_pressed && state.was_pressed) {
-        // Button just released
-        state.pressed = false;
-
-        // Determine event based on duration
-        if (state.press_duration < SHORT_PRESS_THRESHOLD) {
-            state.pending_event = ButtonEvent::SHORT_PRESS;
-            state.event_pending = true;
-        } else {
-            state.pending_event = ButtonEvent::LONG_PRESS;
-            state.event_pending = true;
-        }
-
-        state.press_duration = 0;
-    } else if (currently_pressed) {
-        // Button still pressed, increment duration
-        // Note: This assumes button_check() is called at regular intervals
-        // For 10s wakes, we won't get good resolution. Better to sample more frequently
-        // during active periods or use a timer
-        state.press_duration++;
-    }
-
-    state.was_pressed = currently_pressed;
-
-    // Return pending event if any
-    if (state.event_pending) {
-        ButtonEvent event = state.pending_event;
-        state.event_pending = false;
-        state.pending_event = ButtonEvent::NONE;
-        return event;
-    }
-
-    return ButtonEvent::NONE;
+    cli();
+    ButtonEvent event = state.pending_event;
+    state.pending_event = ButtonEvent::NONE;
+    sei();
+    return event;
 }
 
 uint8_t button_get_press_duration() {
-    return state.press_duration;
-}
-
-bool button_wait_pressed(uint16_t timeout_ms) {
-    // Blocking wait for button press
-    uint32_t timeout_count = timeout_ms;
+    cli();
+    bool pressed = state.pressed;
+    uint32_t held = rtc_get_counts_locked() - state.press_counts;
+    sei();
 
-    while (timeout_count > 0) {
-        if (button_is_pressed()) {
-            return true;
-        }
-        _delay_ms(1);
-        timeout_count--;
+    if (!pressed) {
+        return 0;
     }
-
-    return false;
+    held /= RTC_COUNTS_PER_SEC / 10;
+    return (held > 0xFF) ? 0xFF : (uint8_t)held;
 }
 
-// Pin change interrupt for PA0 (button wake)
+// Pin change interrupt for PA0: timestamp edges, classify on release
 ISR(PORTA_PORT_vect) {
     // Clear interrupt flag for PA0
     PORTA.INTFLAGS = pins::BUTTON;
 
-    // Notify power module
-    PORTA_PORT_vect_impl();
+    uint32_t now = rtc_get_counts_locked();
+    bool down = button_is_pressed();
+
+    if (down && !state.pressed) {
+        state.pressed = true;
+        state.press_counts = now;
+    } else if (!down && state.pressed) {
+        state.pressed = false;
+
+        uint32_t held = now - state.press_counts;
+        bool boot_press = state.boot_press;
+        state.boot_press = false;
+
+        if (boot_press) {
+            if (held < BOOT_HOLD_THRESHOLD) {
+                return;  // Released early: factory reset abandoned
+            }
+            state.pending_event = ButtonEvent::BOOT_HOLD;
+        } else if (held < BOUNCE_COUNTS) {
+            return;  // Bounce: no event, no wake
+        } else if (held >= SHORT_PRESS_THRESHOLD) {
+            state.pending_event = ButtonEvent::LONG_PRESS;
+        } else {
+            state.pending_event = ButtonEvent::SHORT_PRESS;
+        }
+
+        // Notify power module: the main loop handles the event now
+        PORTA_PORT_vect_impl();
+    }
 }
@@ -2,140 +2,371 @@
  * @file buzzer.cpp
  * @brief PWM tone generation for piezo buzzer via DRV8210
  *
- * Generates ~2.7 kHz tone using TCA0 WO0 on PA3
+ * Generates the piezo tone using TCA0 WO0 on PA3
  * DRV8210 is configured in MODE=HIGH (complementary single-input mode)
+ * Patterns are byte code in flash, stepped by the TCB0 interrupt so
+ * callers can IDLE-sleep
  */
 
 #include "buzzer.h"
 #include "pins.hpp"
+#include "power.h"
+#include "stats.h"
+#include "trace.h"
 #include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <util/delay.h>
 
-// Buzzer state machine
+// Phase timer: TCB0 clocked from CLK_TCA (F_CPU / 16 while TCA0 runs)
+// 50 ms per interrupt fits the 16-bit TCB0 counter at 10 and 20 MHz
+constexpr uint16_t BUZZER_TICK_MS = 50;
+constexpr uint32_t BUZZER_TICK_COUNTS = (F_CPU / 16) / 1000 * BUZZER_TICK_MS;
+
+static_assert(BUZZER_TICK_COUNTS <= 0x10000, "Buzzer tick too long for TCB0 at this F_CPU");
+
+/*
+ * Pattern byte code: 2-bit op, 6-bit argument
+ *
+ * | Op    | Bits     | Effect                                            |
+ * |-------|----------|---------------------------------------------------|
+ * | REST  | 00nnnnnn | Silence for n ticks; n = 0 ends the pattern       |
+ * | TONE  | 01nnnnnn | Tone for n ticks (1..63)                          |
+ * | LOOP  | 10nnnnnn | Jump back to the pattern start n more times       |
+ * | PITCH | 11pppppp | Tone period = tuned period * (8 + p) / 8          |
+ *
+ * A tick is BUZZER_TICK_MS. One LOOP per pattern; PITCH holds until the
+ * next PITCH or the end of the pattern. The alert bursts end on a tone,
+ * so the last beep is not followed by a gap.
+ */
+constexpr uint8_t OP_REST = 0x00;
+constexpr uint8_t OP_TONE = 0x40;
+constexpr uint8_t OP_LOOP = 0x80;
+constexpr uint8_t OP_PITCH = 0xC0;
+constexpr uint8_t OP_MASK = 0xC0;
+constexpr uint8_t ARG_MASK = 0x3F;
+constexpr uint8_t END = OP_REST;
+
+constexpr uint8_t tone(uint16_t ms) {
+    return OP_TONE | (ms / BUZZER_TICK_MS);
+}
+
+constexpr uint8_t rest(uint16_t ms) {
+    return OP_REST | (ms / BUZZER_TICK_MS);
+}
+
+constexpr uint8_t loop(uint8_t times) {
+    return OP_LOOP | times;
+}
+
+constexpr uint8_t pitch(uint8_t eighths) {
+    return OP_PITCH | eighths;
+}
+
+// Pattern table (const data is mapped from flash on the 0/1-series)
+static const uint8_t PAT_LOW_BATTERY[] = {tone(100), END};
+static const uint8_t PAT_DOUBLE[] = {tone(100), rest(100), tone(100), END};
+static const uint8_t PAT_TRIPLE[] = {tone(100), rest(100), loop(1), tone(100), END};
+static const uint8_t PAT_FIVE[] = {tone(100), rest(100), loop(3), tone(100), END};
+static const uint8_t PAT_CAL_OK[] = {pitch(4), tone(100), pitch(0), tone(100), END};
+static const uint8_t PAT_CAL_FAIL[] = {pitch(8), tone(500), END};
+static const uint8_t PAT_SENSOR_ERROR[] = {tone(100), pitch(8), tone(200), END};
+static const uint8_t PAT_CAPTURE_OK[] = {tone(50), END};
+
+// Index = BeepPattern
+static const uint8_t* const PATTERNS[] = {
+    nullptr,           // NONE
+    PAT_LOW_BATTERY,   // LOW_BATTERY
+    PAT_DOUBLE,        // DOUBLE
+    PAT_TRIPLE,        // TRIPLE
+    nullptr,           // (4 beeps unused)
+    PAT_FIVE,          // FIVE
+    PAT_CAL_OK,        // CAL_OK
+    PAT_CAL_FAIL,      // CAL_FAIL
+    PAT_SENSOR_ERROR,  // SENSOR_ERROR
+    PAT_CAPTURE_OK,    // CAPTURE_OK
+};
+
+constexpr uint8_t NUM_PATTERNS = sizeof(PATTERNS) / sizeof(PATTERNS[0]);
+static_assert(NUM_PATTERNS == static_cast<uint8_t>(BeepPattern::CAPTURE_OK) + 1,
+              "One table entry per BeepPattern");
+
+// Pattern interpreter (stepped by the TCB0 interrupt)
 struct BuzzerState {
-    BeepPattern pattern;
-    uint8_t beeps_remaining;
-    uint8_t beep_phase;  // 0 = beep on, 1 = gap
-    uint16_t phase_counter;
+    const uint8_t* start;  // Pattern being played, nullptr = idle
+    const uint8_t* pc;     // Next op
+    uint8_t loops_done;    // LOOP jumps taken
+    uint8_t pitch;         // Current PITCH argument
+    uint8_t tone;          // 1 = tone phase, 0 = silence
+    uint8_t phase_ticks;   // TCB0 ticks left in current phase
 };
 
-static BuzzerState state = {BeepPattern::NONE, 0, 0, 0};
+static volatile BuzzerState state = {nullptr, nullptr, 0, 0, 0, 0};
+
+// Tuned (or nominal) period; PITCH scales from it
+static uint16_t tone_period;
+
+// Tone: TCA0 at F_CPU / 16, f = F_CPU / (16 * (PER + 1)), 50 % duty
+constexpr uint16_t period_for(uint32_t freq_hz) {
+    return (uint16_t)((F_CPU / 16 + freq_hz / 2) / freq_hz - 1);
+}
+
+constexpr uint16_t PER_NOMINAL = period_for(BUZZER_FREQ_HZ);
+
+// Resonance search band (±25 %); higher frequency = shorter period
+constexpr uint16_t PER_MIN = period_for(BUZZER_FREQ_HZ + BUZZER_FREQ_HZ / 4);
+constexpr uint16_t PER_MAX = period_for(BUZZER_FREQ_HZ - BUZZER_FREQ_HZ / 4);
+constexpr uint8_t TUNE_COARSE_STEPS = 16;
+constexpr uint16_t TUNE_COARSE_STEP = (PER_MAX - PER_MIN) / TUNE_COARSE_STEPS;
+constexpr uint16_t TUNE_FINE_STEP = (TUNE_COARSE_STEP >= 8) ? TUNE_COARSE_STEP / 8 : 1;
+constexpr uint8_t TUNE_SETTLE_MS = 5;  // Drive and supply settle after a step
 
-// Timing constants (in milliseconds, tracked by buzzer_update() calls)
-constexpr uint16_t BEEP_DURATION_MS = 100;
-constexpr uint16_t BEEP_GAP_MS = 100;
+static_assert(TUNE_COARSE_STEP > 0, "Tuning band too narrow at this F_CPU");
 
-void buzzer_init() {
+/**
+ * Select the tone period (50 % duty), restarting TCA0 if it is running
+ *
+ * A direct PER write below the running count would let it run to 0xFFFF.
+ */
+static void set_period(uint16_t period) {
+    uint8_t ctrla = TCA0.SINGLE.CTRLA;
+    TCA0.SINGLE.CTRLA = ctrla & ~TCA_SINGLE_ENABLE_bm;
+    TCA0.SINGLE.CNT = 0;
+    TCA0.SINGLE.PER = period;
+    TCA0.SINGLE.CMP0 = (period + 1) / 2;
+    TCA0.SINGLE.CTRLA = ctrla;
+}
+
+void buzzer_init(uint16_t period) {
     // Configure PA3 as output for PWM
     PORTA.DIRSET = pins::DRV_IN1;
     PORTA.OUTCLR = pins::DRV_IN1;  // Initially LOW
 
-    // Configure TCA0 for PWM generation
-    // Target frequency: 3800 Hz (resonant frequency)
-    // Clock source: CLK_PER (10 MHz)
-    // Prescaler: DIV16 → 625 kHz timer clock
-    // Period for 3800 Hz: 625 kHz / 3800 Hz ≈ 164
-
     TCA0.SINGLE.CTRLA = 0;  // Stop timer
 
     // Single-slope PWM mode
     TCA0.SINGLE.CTRLB = TCA_SINGLE_WGMODE_SINGLESLOPE_gc;
 
-    // Set period for 3800 Hz
-    // With prescaler DIV16: f = F_CPU / (16 * (PER + 1))
-    // PER = F_CPU / (16 * f) - 1
-    // PER = 10000000 / (16 * 3800) - 1 ≈ 164
-    TCA0.SINGLE.PER = 164;
-
-    // Set 50% duty cycle
-    TCA0.SINGLE.CMP0 = 82;  // 50% of 164
+    // Tuned period if it is plausible, else the nominal 3.8 kHz for F_CPU
+    if (period < PER_MIN || period > PER_MAX) {
+        period = PER_NOMINAL;
+    }
+    tone_period = period;
+    set_period(period);
 
     // Prescaler DIV16, but don't enable yet
     TCA0.SINGLE.CTRLA = TCA_SINGLE_CLKSEL_DIV16_gc;
 
+    // Configure TCB0 as periodic phase timer (started with a pattern)
+    TCB0.CTRLA = 0;
+    TCB0.CTRLB = TCB_CNTMODE_INT_gc;
+    TCB0.CCMP = BUZZER_TICK_COUNTS - 1;
+
     // Clear state
-    state.pattern = BeepPattern::NONE;
-    state.beeps_remaining = 0;
+    state.start = nullptr;
+    state.pc = nullptr;
+    state.pitch = 0;
 }
 
-static void buzzer_pwm_enable() {
+static void buzzer_tone_on() {
     // Enable PWM output on WO0 (PA3)
     TCA0.SINGLE.CTRLB = TCA_SINGLE_WGMODE_SINGLESLOPE_gc | TCA_SINGLE_CMP0EN_bm;
-
-    // Enable timer
-    TCA0.SINGLE.CTRLA |= TCA_SINGLE_ENABLE_bm;
 }
 
-static void buzzer_pwm_disable() {
-    // Disable timer
-    TCA0.SINGLE.CTRLA &= ~TCA_SINGLE_ENABLE_bm;
-
-    // Disable PWM output
+static void buzzer_tone_off() {
+    // Disable PWM output (TCA0 keeps running to clock TCB0)
     TCA0.SINGLE.CTRLB = TCA_SINGLE_WGMODE_SINGLESLOPE_gc;
 
     // Ensure pin is LOW
     PORTA.OUTCLR = pins::DRV_IN1;
 }
 
-void buzzer_start(BeepPattern pattern) {
-    if (pattern == BeepPattern::NONE) {
-        buzzer_stop();
-        return;
+/**
+ * Drive at one period and weigh the supply droop against the idle level
+ *
+ * Capacitive current is proportional to frequency, so droop * (PER + 1)
+ * is flat for a plain capacitor and peaks at the motional resonance.
+ */
+static uint32_t drive_response(uint16_t period, uint16_t idle) {
+    set_period(period);
+    _delay_ms(TUNE_SETTLE_MS);
+    uint16_t loaded = power_measure_supply();
+    if (loaded <= idle) {
+        return 0;
     }
+    return (uint32_t)(loaded - idle) * (period + 1);
+}
 
-    // Initialize state machine
-    state.pattern = pattern;
-    state.beeps_remaining = static_cast<uint8_t>(pattern);
-    state.beep_phase = 0;  // Start with beep on
-    state.phase_counter = 0;
+uint16_t buzzer_tune() {
+    buzzer_stop();
 
-    // Start PWM
-    buzzer_pwm_enable();
-}
+    // Supply at rest (rail on, tone off)
+    uint16_t idle = power_measure_supply();
 
-bool buzzer_update() {
-    if (state.pattern == BeepPattern::NONE || state.beeps_remaining == 0) {
-        return false;  // Not active
+    TCA0.SINGLE.CTRLA |= TCA_SINGLE_ENABLE_bm;
+    buzzer_tone_on();
+
+    uint16_t best_period = PER_NOMINAL;
+    uint32_t best = 0;
+    uint16_t lo = PER_MIN;
+    uint16_t hi = PER_MAX;
+    uint16_t step = TUNE_COARSE_STEP;
+    for (uint8_t pass = 0; pass < 2; pass++) {
+        for (uint16_t period = lo; period <= hi; period += step) {
+            uint32_t response = drive_response(period, idle);
+            if (response > best) {
+                best = response;
+                best_period = period;
+            }
+        }
+
+        // Fine pass around the coarse peak (clamped to the band)
+        lo = (best_period > PER_MIN + step) ? best_period - step : PER_MIN;
+        hi = (best_period + step < PER_MAX) ? best_period + step : PER_MAX;
+        step = TUNE_FINE_STEP;
     }
 
-    // Increment phase counter (assumes called every ~1 ms)
-    state.phase_counter++;
+    buzzer_tone_off();
+    TCA0.SINGLE.CTRLA &= ~TCA_SINGLE_ENABLE_bm;
 
-    if (state.beep_phase == 0) {
-        // Currently beeping
-        if (state.phase_counter >= BEEP_DURATION_MS) {
-            state.phase_counter = 0;
-            state.beeps_remaining--;
+    if (best == 0) {
+        set_period(tone_period);
+        return 0;
+    }
+    tone_period = best_period;
+    set_period(best_period);
+    return best_period;
+}
 
-            if (state.beeps_remaining == 0) {
-                // Pattern complete
-                buzzer_stop();
-                return false;
-            }
+/**
+ * Run ops up to the next timed phase (ISR context or interrupt disabled)
+ */
+static void pattern_step() {
+    for (;;) {
+        uint8_t op = *state.pc;
+        uint8_t arg = op & ARG_MASK;
+        state.pc = state.pc + 1;
 
-            // Move to gap phase
-            state.beep_phase = 1;
-            buzzer_pwm_disable();
-        }
-    } else {
-        // Currently in gap
-        if (state.phase_counter >= BEEP_GAP_MS) {
-            state.phase_counter = 0;
-            state.beep_phase = 0;
-            buzzer_pwm_enable();
+        switch (op & OP_MASK) {
+        case OP_TONE:
+            state.tone = 1;
+            state.phase_ticks = arg;
+            buzzer_tone_on();
+            return;
+        case OP_REST:
+            if (arg == 0) {
+                buzzer_stop();  // END
+                return;
+            }
+            state.tone = 0;
+            state.phase_ticks = arg;
+            buzzer_tone_off();
+            return;
+        case OP_LOOP:
+            if (state.loops_done < arg) {
+                state.loops_done = state.loops_done + 1;
+                state.pc = state.start;
+            }
+            break;
+        default:  // OP_PITCH
+            state.pitch = arg;
+            set_period((uint32_t)tone_period * (8 + arg) / 8);
+            break;
         }
     }
+}
+
+void buzzer_start(BeepPattern pattern) {
+    uint8_t index = static_cast<uint8_t>(pattern);
+    const uint8_t* code = (index < NUM_PATTERNS) ? PATTERNS[index] : nullptr;
+    if (code == nullptr) {
+        buzzer_stop();
+        return;
+    }
+
+    trace_phase(TracePhase::BEEP);
+
+    // Cut off a pattern still playing (and its PITCH)
+    if (buzzer_is_active()) {
+        buzzer_stop();
+    }
+
+    // Load the pattern and run up to its first phase
+    TCB0.INTCTRL = 0;
+    state.start = code;
+    state.pc = code;
+    state.loops_done = 0;
+    pattern_step();
+
+    // Start PWM clock and phase timer
+    TCA0.SINGLE.CTRLA |= TCA_SINGLE_ENABLE_bm;
+    TCB0.CNT = 0;
+    TCB0.INTFLAGS = TCB_CAPT_bm;
+    TCB0.INTCTRL = TCB_CAPT_bm;
+    TCB0.CTRLA = TCB_CLKSEL_CLKTCA_gc | TCB_ENABLE_bm;
+}
 
-    return true;  // Still active
+void buzzer_sleep() {
+    // IDLE keeps CLK_PER (TCA0/TCB0) running; STANDBY is restored afterwards
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    cli();
+    if (buzzer_is_active()) {
+        // sei() takes effect after the next instruction, so the phase
+        // interrupt can't slip in between the check and sleep_cpu()
+        sei();
+        sleep_cpu();
+    }
+    sei();
+    set_sleep_mode(SLEEP_MODE_STANDBY);
+}
+
+void buzzer_wait() {
+    while (buzzer_is_active()) {
+        buzzer_sleep();
+    }
 }
 
 void buzzer_stop() {
-    buzzer_pwm_disable();
-    state.pattern = BeepPattern::NONE;
-    state.beeps_remaining = 0;
-    state.phase_counter = 0;
-    state.beep_phase = 0;
+    // Stop phase timer and PWM
+    TCB0.INTCTRL = 0;
+    TCB0.CTRLA = 0;
+    TCA0.SINGLE.CTRLA &= ~TCA_SINGLE_ENABLE_bm;
+    buzzer_tone_off();
+
+    // Back to the tuned period for the next pattern
+    if (state.pitch != 0) {
+        state.pitch = 0;
+        set_period(tone_period);
+    }
+
+    state.start = nullptr;
+    state.pc = nullptr;
+    state.tone = 0;
+    state.phase_ticks = 0;
 }
 
 bool buzzer_is_active() {
-    return state.pattern != BeepPattern::NONE && state.beeps_remaining > 0;
+    return state.start != nullptr;
+}
+
+uint16_t buzzer_gap_left_ms() {
+    // The current tick may be almost over: count only the full ones after it
+    uint8_t ticks = state.phase_ticks;
+    if (!buzzer_is_active() || state.tone || ticks == 0) {
+        return 0;
+    }
+    return (ticks - 1) * BUZZER_TICK_MS;
+}
+
+// Phase timer interrupt: counts tone time, steps the pattern at phase edges
+ISR(TCB0_INT_vect) {
+    TCB0.INTFLAGS = TCB_CAPT_bm;
+
+    if (state.tone) {
+        stats_beep_ms(BUZZER_TICK_MS);
+    }
+    if (--state.phase_ticks != 0) {
+        return;
+    }
+    pattern_step();
 }
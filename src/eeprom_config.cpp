@@ -4,43 +4,76 @@
  */
 
 #include "eeprom_config.h"
+#include "crc.h"
+#include <avr/io.h>
 #include <avr/eeprom.h>
+#include <stddef.h>
 #include <string.h>
 
-// EEPROM storage location (start of EEPROM)
-static NvmConfig EEMEM eeprom_storage;
+// Journal geometry: fixed 8-byte slots over the whole EEPROM
+// (4 per 32 B page, never straddling one)
+constexpr uint8_t SLOT_SIZE = 8;
+constexpr uint8_t NUM_SLOTS = EEPROM_SIZE / SLOT_SIZE;
+constexpr uint8_t PAYLOAD_SIZE = 5;  // Payload bytes per record
 
-// Cached configuration
-static NvmConfig cached_config;
+// Config is journaled in fixed 4-byte chunks (two whole 16-bit fields),
+// so a torn multi-record save never leaves half a field written
+constexpr uint8_t CHUNK_SIZE = 4;
 
-/**
- * Calculate CRC-16/XMODEM
- * Polynomial: 0x1021 (x^16 + x^12 + x^5 + 1)
- * Initial value: 0x0000
- */
-static uint16_t calculate_crc16(const uint8_t* data, uint16_t length) {
-    uint16_t crc = 0x0000;
+// Journaled part of NvmConfig (crc16 is recomputed on replay)
+constexpr uint8_t CONFIG_BYTES = sizeof(NvmConfig) - sizeof(uint16_t);
+constexpr uint8_t CONFIG_CHUNKS = (CONFIG_BYTES + CHUNK_SIZE - 1) / CHUNK_SIZE;
 
-    for (uint16_t i = 0; i < length; i++) {
-        crc ^= (uint16_t)data[i] << 8;
-        for (uint8_t bit = 0; bit < 8; bit++) {
-            if (crc & 0x8000) {
-                crc = (crc << 1) ^ 0x1021;
-            } else {
-                crc = crc << 1;
-            }
-        }
-    }
+// Pre-journal firmware stored a single NvmConfig at address 0
+constexpr uint8_t LEGACY_SLOTS = (sizeof(NvmConfig) + SLOT_SIZE - 1) / SLOT_SIZE;
 
-    return crc;
-}
+// Every chunk live at once, plus the new record and the free oldest slot
+static_assert(NUM_SLOTS >= CONFIG_CHUNKS + 2, "EEPROM too small for config journal");
+static_assert(LEGACY_SLOTS + CONFIG_CHUNKS <= NUM_SLOTS, "EEPROM too small for migration");
+
+// Record tag: type (bits 7-6) | config offset, event code or counter index (bits 4-0)
+constexpr uint8_t TAG_EVENT = 0x00;
+constexpr uint8_t TAG_CONFIG = 0x40;     // Config bytes at offset
+constexpr uint8_t TAG_COUNTER = 0x80;    // Instrumentation counter value (stats.h)
+constexpr uint8_t TAG_TYPE_MASK = 0xC0;  // Other types = erased / invalid
+constexpr uint8_t TAG_FIELD_MASK = 0x1F;
+
+static_assert(CONFIG_BYTES <= TAG_FIELD_MASK + 1, "Config offset does not fit tag");
+static_assert(CONFIG_BYTES % 2 == 0, "Config chunks must stay field-aligned");
+static_assert(offsetof(NvmConfig, buzzer_per) / CHUNK_SIZE ==
+              (offsetof(NvmConfig, buzzer_per) + 1) / CHUNK_SIZE,
+              "buzzer_per must not straddle a chunk");
+
+struct __attribute__((packed)) JournalRecord {
+    uint8_t seq;                 // Sequence number, consecutive in ring order
+    uint8_t tag;                 // Record type + offset/event
+    uint8_t data[PAYLOAD_SIZE];  // CONFIG: chunk bytes; EVENT: tick + arg; COUNTER: value
+    uint8_t crc8;                // CRC-8 over the bytes above
+};
+
+static_assert(sizeof(JournalRecord) == SLOT_SIZE, "Journal record must fill a slot");
+
+// EEPROM storage (whole EEPROM)
+static uint8_t EEMEM journal_storage[NUM_SLOTS][SLOT_SIZE];
+
+// Journal position
+struct JournalState {
+    uint8_t head;      // Next slot to write (oldest, holds nothing live)
+    uint8_t next_seq;  // Sequence number of the next record
+    bool open;         // Scanned by eeprom_init()
+};
+
+static JournalState journal = {0, 0, false};
+
+// Cached configuration
+static NvmConfig cached_config;
 
 /**
  * Validate and fix CRC for config structure
  */
 static bool validate_crc(const NvmConfig* config) {
     // Calculate CRC over entire structure except CRC field itself
-    uint16_t calc_crc = calculate_crc16(
+    uint16_t calc_crc = crc16_xmodem(
         (const uint8_t*)config,
         sizeof(NvmConfig) - sizeof(uint16_t)  // Exclude crc16 field
     );
@@ -52,42 +85,293 @@ static bool validate_crc(const NvmConfig* config) {
  * Update CRC in config structure
  */
 static void update_crc(NvmConfig* config) {
-    config->crc16 = calculate_crc16(
+    config->crc16 = crc16_xmodem(
         (const uint8_t*)config,
         sizeof(NvmConfig) - sizeof(uint16_t)
     );
 }
 
+static uint8_t slot_next(uint8_t slot) {
+    return (slot + 1 == NUM_SLOTS) ? 0 : slot + 1;
+}
+
+static uint8_t slot_prev(uint8_t slot) {
+    return (slot == 0) ? NUM_SLOTS - 1 : slot - 1;
+}
+
+/**
+ * Payload length of the config chunk at offset
+ */
+static uint8_t chunk_len(uint8_t offset) {
+    uint8_t left = CONFIG_BYTES - offset;
+    return (left < CHUNK_SIZE) ? left : CHUNK_SIZE;
+}
+
+/**
+ * Access EEPROM in place through its data-space mapping (no copy)
+ */
+static const uint8_t* eeprom_mapped(const void* ee_addr) {
+    eeprom_busy_wait();  // Don't read a slot while it is being written
+    return (const uint8_t*)(MAPPED_EEPROM_START + (uintptr_t)ee_addr);
+}
+
+/**
+ * Map a slot and check it holds a valid record
+ *
+ * @return Record in mapped EEPROM, nullptr if erased or corrupt
+ */
+static const JournalRecord* read_slot(uint8_t slot) {
+    const JournalRecord* rec = (const JournalRecord*)eeprom_mapped(journal_storage[slot]);
+
+    uint8_t type = rec->tag & TAG_TYPE_MASK;
+    if (type != TAG_EVENT && type != TAG_CONFIG && type != TAG_COUNTER) {
+        return nullptr;  // Erased
+    }
+
+    if (crc8((const uint8_t*)rec, SLOT_SIZE - 1) != rec->crc8) {
+        return nullptr;
+    }
+
+    return rec;
+}
+
+static void erase_slot(uint8_t slot) {
+    uint8_t erased[SLOT_SIZE];
+    memset(erased, 0xFF, SLOT_SIZE);
+    eeprom_update_block(erased, journal_storage[slot], SLOT_SIZE);
+}
+
+/**
+ * Check if a slot holds the newest copy of a config chunk
+ *
+ * @param offset Set to the chunk offset if live
+ */
+static bool slot_live(uint8_t slot, uint8_t* offset) {
+    const JournalRecord* rec = read_slot(slot);
+    if (!rec || (rec->tag & TAG_TYPE_MASK) != TAG_CONFIG) {
+        return false;
+    }
+    *offset = rec->tag & TAG_FIELD_MASK;
+
+    // Look for a newer copy between it and the head
+    uint8_t seq = rec->seq;
+    for (uint8_t i = slot_next(slot); i != journal.head; i = slot_next(i)) {
+        seq++;
+        rec = read_slot(i);
+        if (!rec || rec->seq != seq) {
+            return true;  // Chain broken: keep it
+        }
+        if (rec->tag == (TAG_CONFIG | *offset)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Write one record at the head of the journal
+ */
+static void journal_append(uint8_t tag, const uint8_t* data, uint8_t len) {
+    JournalRecord rec;
+    rec.seq = journal.next_seq;
+    rec.tag = tag;
+    memset(rec.data, 0xFF, PAYLOAD_SIZE);
+    memcpy(rec.data, data, len);
+    rec.crc8 = crc8((const uint8_t*)&rec, SLOT_SIZE - 1);
+
+    // Sequence byte last: a torn write never links into the chain
+    uint8_t* slot = journal_storage[journal.head];
+    eeprom_update_block(&rec.tag, slot + 1, SLOT_SIZE - 1);
+    eeprom_update_byte(slot, rec.seq);
+
+    journal.head = slot_next(journal.head);
+    journal.next_seq++;
+}
+
+/**
+ * Append a record, keeping every config chunk alive
+ *
+ * The slot after the head becomes the oldest once the head is written.
+ * If it still holds the only copy of a chunk, that chunk is copied
+ * forward (from the cache) first, so replay never loses a field and a
+ * torn write only ever destroys a dead slot.
+ */
+static void journal_write(uint8_t tag, const uint8_t* data, uint8_t len) {
+    const uint8_t* bytes = (const uint8_t*)&cached_config;
+    uint8_t off;
+
+    while (slot_live(slot_next(journal.head), &off)) {
+        journal_append(TAG_CONFIG | off, bytes + off, chunk_len(off));
+    }
+
+    journal_append(tag, data, len);
+}
+
+/**
+ * Write every chunk of the cached config
+ */
+static void write_all_chunks() {
+    const uint8_t* bytes = (const uint8_t*)&cached_config;
+
+    for (uint8_t off = 0; off < CONFIG_BYTES; off += CHUNK_SIZE) {
+        journal_write(TAG_CONFIG | off, bytes + off, chunk_len(off));
+    }
+}
+
+/**
+ * Start a fresh journal holding the cached config
+ *
+ * Written after the legacy block, which is erased only once every chunk
+ * is in place.
+ */
+static void journal_format() {
+    for (uint8_t i = LEGACY_SLOTS; i < NUM_SLOTS; i++) {
+        erase_slot(i);
+    }
+
+    journal.head = LEGACY_SLOTS;
+    journal.next_seq = 0;
+    write_all_chunks();
+
+    for (uint8_t i = 0; i < LEGACY_SLOTS; i++) {
+        erase_slot(i);
+    }
+}
+
+/**
+ * Check a stored config version is one this firmware can use
+ */
+static bool version_known(uint16_t version) {
+    return version == NVM_CONFIG_VERSION || version == NVM_CONFIG_VERSION_SINGLE_ENDED;
+}
+
+/**
+ * Bring an older config up to NVM_CONFIG_VERSION
+ *
+ * Single-ended baselines mean nothing against differential readings (and
+ * the old trip sign), so the calibration is cleared. Thresholds,
+ * hysteresis and piezo tuning carry over.
+ *
+ * @return true if the config was changed
+ */
+static bool migrate(NvmConfig* config) {
+    if (config->version == NVM_CONFIG_VERSION) {
+        return false;
+    }
+
+    config->version = NVM_CONFIG_VERSION;
+    config->base_c1_ff = 0;
+    config->base_c2_ff = 0;
+    config->base_c3_ff = 0;
+    config->calibration_valid = 0;
+    config->ref_capdac = 0;
+    config->drift_steps = 0;
+    update_crc(config);
+    return true;
+}
+
+/**
+ * Load a config block written by pre-journal firmware
+ */
+static bool load_legacy(NvmConfig* config) {
+    const NvmConfig* legacy = (const NvmConfig*)eeprom_mapped(journal_storage);
+    if (!version_known(legacy->version) || !validate_crc(legacy)) {
+        return false;
+    }
+
+    memcpy(config, legacy, sizeof(NvmConfig));
+    return true;
+}
+
 void eeprom_init() {
+    journal.open = true;
+
     // Load from EEPROM
-    if (!eeprom_load(&cached_config)) {
-        // Load failed or CRC invalid, use factory defaults
+    if (eeprom_load(&cached_config)) {
+        if (migrate(&cached_config)) {
+            write_all_chunks();
+        }
+        return;
+    }
+
+    // No usable journal: migrate the old block, else use factory defaults
+    if (load_legacy(&cached_config)) {
+        migrate(&cached_config);
+    } else {
         memcpy(&cached_config, &FACTORY_DEFAULTS, sizeof(NvmConfig));
         update_crc(&cached_config);
     }
+
+    journal_format();
 }
 
 bool eeprom_load(NvmConfig* config) {
     if (!config) return false;
 
-    // Read from EEPROM
-    eeprom_read_block(config, &eeprom_storage, sizeof(NvmConfig));
+    const JournalRecord* rec;
 
-    // Validate version
-    if (config->version != NVM_CONFIG_VERSION) {
-        return false;
+    // Locate newest record: a valid record whose successor is not its sequel
+    uint8_t newest = NUM_SLOTS;
+    uint8_t newest_seq = 0;
+    for (uint8_t i = 0; i < NUM_SLOTS && newest == NUM_SLOTS; i++) {
+        rec = read_slot(i);
+        if (!rec) {
+            continue;
+        }
+        newest_seq = rec->seq;
+        rec = read_slot(slot_next(i));
+        if (!rec || rec->seq != (uint8_t)(newest_seq + 1)) {
+            newest = i;
+        }
     }
 
-    // Validate CRC
-    if (!validate_crc(config)) {
-        return false;
+    if (newest == NUM_SLOTS) {
+        return false;  // Empty journal
     }
 
-    return true;
+    journal.head = slot_next(newest);
+    journal.next_seq = newest_seq + 1;
+
+    // Walk back to the oldest record of the chain
+    uint8_t oldest = newest;
+    uint8_t count = 1;
+    uint8_t seq = newest_seq;
+    while (count < NUM_SLOTS) {
+        uint8_t prev = slot_prev(oldest);
+        rec = read_slot(prev);
+        if (!rec || rec->seq != (uint8_t)(seq - 1)) {
+            break;
+        }
+        oldest = prev;
+        seq = rec->seq;
+        count++;
+    }
+
+    // Replay oldest to newest on top of the defaults
+    memcpy(config, &FACTORY_DEFAULTS, sizeof(NvmConfig));
+    uint8_t* bytes = (uint8_t*)config;
+    bool have_version = false;
+
+    for (uint8_t n = 0, i = oldest; n < count; n++, i = slot_next(i)) {
+        rec = read_slot(i);
+        uint8_t off = rec->tag & TAG_FIELD_MASK;
+
+        if ((rec->tag & TAG_TYPE_MASK) == TAG_CONFIG && off < CONFIG_BYTES) {
+            memcpy(bytes + off, rec->data, chunk_len(off));
+            have_version |= (off == 0);
+        }
+    }
+
+    // Records were CRC-8 checked by read_slot(); crc16 is not journaled
+    update_crc(config);
+
+    // Chunk 0 is always kept alive; without it this is not a journal
+    return have_version && version_known(config->version);
 }
 
 bool eeprom_save(const NvmConfig* config) {
-    if (!config) return false;
+    if (!config || !journal.open) return false;
 
     // Create a copy and update CRC
     NvmConfig config_copy;
@@ -95,8 +379,18 @@ bool eeprom_save(const NvmConfig* config) {
     config_copy.version = NVM_CONFIG_VERSION;
     update_crc(&config_copy);
 
-    // Write to EEPROM
-    eeprom_update_block(&config_copy, &eeprom_storage, sizeof(NvmConfig));
+    // Journal the chunks that changed, keeping the cache in step so
+    // chunks copied forward in between carry the value already written
+    const uint8_t* src = (const uint8_t*)&config_copy;
+    uint8_t* cur = (uint8_t*)&cached_config;
+
+    for (uint8_t off = 0; off < CONFIG_BYTES; off += CHUNK_SIZE) {
+        uint8_t len = chunk_len(off);
+        if (memcmp(src + off, cur + off, len) != 0) {
+            journal_write(TAG_CONFIG | off, src + off, len);
+            memcpy(cur + off, src + off, len);
+        }
+    }
 
     // Update cached copy
     memcpy(&cached_config, &config_copy, sizeof(NvmConfig));
@@ -105,18 +399,26 @@ bool eeprom_save(const NvmConfig* config) {
 }
 
 bool eeprom_factory_reset() {
-    NvmConfig defaults;
-    memcpy(&defaults, &FACTORY_DEFAULTS, sizeof(NvmConfig));
-    return eeprom_save(&defaults);
+    // May run before eeprom_init() (boot-time button hold)
+    if (!journal.open) {
+        eeprom_init();
+    }
+
+    memcpy(&cached_config, &FACTORY_DEFAULTS, sizeof(NvmConfig));
+    update_crc(&cached_config);
+    write_all_chunks();
+
+    return true;
 }
 
-void eeprom_get_config(NvmConfig* config) {
-    if (config) {
-        memcpy(config, &cached_config, sizeof(NvmConfig));
-    }
+const NvmConfig& eeprom_config() {
+    return cached_config;
 }
 
-bool eeprom_update_calibration(int16_t c1_ff, int16_t c2_ff, int16_t c3_ff) {
+/**
+ * Check a full-tank baseline before it is saved
+ */
+static bool baseline_valid(int16_t c1_ff, int16_t c2_ff, int16_t c3_ff) {
     // Validate calibration values (must be within ±5 pF range)
     if (c1_ff < -5000 || c1_ff > 5000) return false;
     if (c2_ff < -5000 || c2_ff > 5000) return false;
@@ -126,12 +428,129 @@ bool eeprom_update_calibration(int16_t c1_ff, int16_t c2_ff, int16_t c3_ff) {
     // Each reading must be > 200 fF
     if (c1_ff < 200 || c2_ff < 200 || c3_ff < 200) return false;
 
-    // Update cached config
-    cached_config.base_c1_ff = c1_ff;
-    cached_config.base_c2_ff = c2_ff;
-    cached_config.base_c3_ff = c3_ff;
-    cached_config.calibration_valid = 1;
+    // The trip point (baseline - threshold) must sit above the hysteresis
+    // band, or a dry electrode (about 0 fF CINx - CIN4) may never trip it
+    const int16_t base_ff[] = {c1_ff, c2_ff, c3_ff};
+    const uint16_t th_ff[] = {cached_config.th_low_ff, cached_config.th_vlow_ff,
+                              cached_config.th_crit_ff};
+    for (uint8_t ch = 0; ch < 3; ch++) {
+        int32_t hyst_ff = ((int32_t)th_ff[ch] * cached_config.hysteresis_pct) / 100;
+        if (base_ff[ch] <= th_ff[ch] + hyst_ff) return false;
+    }
+
+    return true;
+}
+
+bool eeprom_update_calibration(int16_t c1_ff, int16_t c2_ff, int16_t c3_ff,
+                               uint8_t ref_capdac) {
+    if (!baseline_valid(c1_ff, c2_ff, c3_ff)) {
+        return false;
+    }
+
+    // Update a copy: eeprom_save() journals what differs from the cache
+    NvmConfig config;
+    memcpy(&config, &cached_config, sizeof(NvmConfig));
+    config.base_c1_ff = c1_ff;
+    config.base_c2_ff = c2_ff;
+    config.base_c3_ff = c3_ff;
+    config.ref_capdac = ref_capdac;
+    config.drift_steps = 0;  // New reference point for drift tracking
+    config.calibration_valid = 1;
 
     // Save to EEPROM
-    return eeprom_save(&cached_config);
+    return eeprom_save(&config);
+}
+
+bool eeprom_update_baseline(int16_t c1_ff, int16_t c2_ff, int16_t c3_ff, uint16_t drift_steps) {
+    if (!cached_config.calibration_valid || !baseline_valid(c1_ff, c2_ff, c3_ff)) {
+        return false;
+    }
+
+    NvmConfig config;
+    memcpy(&config, &cached_config, sizeof(NvmConfig));
+    config.base_c1_ff = c1_ff;
+    config.base_c2_ff = c2_ff;
+    config.base_c3_ff = c3_ff;
+    config.drift_steps = drift_steps;
+    return eeprom_save(&config);
+}
+
+bool eeprom_update_buzzer_period(uint16_t period) {
+    NvmConfig config;
+    memcpy(&config, &cached_config, sizeof(NvmConfig));
+    config.buzzer_per = period;
+    return eeprom_save(&config);
+}
+
+bool eeprom_log_event(NvmEvent event, uint8_t arg, uint32_t tick) {
+    if (!journal.open) return false;
+
+    uint8_t data[PAYLOAD_SIZE];
+    memcpy(data, &tick, sizeof(tick));
+    data[4] = arg;
+
+    journal_write(TAG_EVENT | static_cast<uint8_t>(event), data, PAYLOAD_SIZE);
+    return true;
+}
+
+bool eeprom_log_counter(uint8_t index, uint32_t value) {
+    if (!journal.open || index > TAG_FIELD_MASK) return false;
+
+    journal_write(TAG_COUNTER | index, (const uint8_t*)&value, sizeof(value));
+    return true;
+}
+
+/**
+ * Walk back from the newest record to the n-th one matching a tag
+ *
+ * @param mask Tag bits to compare (TAG_TYPE_MASK: any record of the type)
+ * @return Record in mapped EEPROM, nullptr past the oldest record
+ */
+static const JournalRecord* find_record(uint8_t tag, uint8_t mask, uint8_t n) {
+    uint8_t slot = journal.head;
+    uint8_t seq = journal.next_seq;
+
+    for (uint8_t i = 0; i < NUM_SLOTS; i++) {
+        slot = slot_prev(slot);
+        seq--;
+        const JournalRecord* rec = read_slot(slot);
+        if (!rec || rec->seq != seq) {
+            return nullptr;  // Ran past the oldest record
+        }
+
+        if ((rec->tag & mask) == tag) {
+            if (n == 0) {
+                return rec;
+            }
+            n--;
+        }
+    }
+
+    return nullptr;
+}
+
+bool eeprom_get_event(uint8_t index, NvmEventRecord* record) {
+    if (!record || !journal.open) return false;
+
+    const JournalRecord* rec = find_record(TAG_EVENT, TAG_TYPE_MASK, index);
+    if (!rec) {
+        return false;
+    }
+
+    memcpy(&record->tick, rec->data, sizeof(record->tick));
+    record->event = static_cast<NvmEvent>(rec->tag & TAG_FIELD_MASK);
+    record->arg = rec->data[4];
+    return true;
+}
+
+bool eeprom_get_counter(uint8_t index, uint32_t* value) {
+    if (!value || !journal.open) return false;
+
+    const JournalRecord* rec = find_record(TAG_COUNTER | index, 0xFF, 0);
+    if (!rec) {
+        return false;
+    }
+
+    memcpy(value, rec->data, sizeof(*value));
+    return true;
 }
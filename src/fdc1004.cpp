@@ -5,6 +5,9 @@
 
 #include "fdc1004.h"
 #include "twi.h"
+#include "power.h"
+#include "stats.h"
+#include "trace.h"
 #include <util/delay.h>
 
 // FDC1004 Register Map
@@ -40,10 +43,13 @@ namespace FdcConf {
     constexpr uint16_t CHA_OFFSET = 13;  // Positive input (bits 15:13)
     constexpr uint16_t CHB_OFFSET = 10;  // Negative input (bits 12:10)
     constexpr uint16_t CAPDAC_OFFSET = 5; // CAPDAC value (bits 9:5)
-    constexpr uint16_t CAPDAC_EN = (1 << 4);  // CAPDAC enable
+    constexpr uint16_t CHB_CAPDAC = 4;    // CHB = CAPDAC (offset enabled)
+    constexpr uint16_t CHB_DISABLED = 7;  // CHB = none (single-ended)
 
     // FDC_CONF register bits
     constexpr uint16_t RATE_100SPS = (0b01 << 10);  // 100 S/s (bits 11:10)
+    constexpr uint16_t RATE_200SPS = (0b10 << 10);  // 200 S/s
+    constexpr uint16_t RATE_400SPS = (0b11 << 10);  // 400 S/s
     constexpr uint16_t REPEAT = (1 << 8);           // Repeat measurements
     constexpr uint16_t MEAS1_EN = (1 << 7);         // Enable MEAS1
     constexpr uint16_t MEAS2_EN = (1 << 6);         // Enable MEAS2
@@ -56,137 +62,255 @@ namespace FdcConf {
     constexpr uint16_t RESET = (1 << 15);           // Software reset
 }
 
-// Helper: write 16-bit register
+// FDC_CONF rate field for FDC_SAMPLE_RATE
+constexpr uint16_t FDC_RATE = FDC_SAMPLE_RATE == 400 ? FdcConf::RATE_400SPS :
+                              FDC_SAMPLE_RATE == 200 ? FdcConf::RATE_200SPS : FdcConf::RATE_100SPS;
+
+// Register pointer cache
+// The FDC1004 keeps its pointer register between transactions, so a read of
+// the register last addressed can skip the pointer write
+constexpr uint8_t PTR_UNKNOWN = 0x7F;  // Reserved address, never targeted
+static uint8_t current_ptr = PTR_UNKNOWN;
+
+// Set once DEVICE_ID has been verified; cleared on any I2C error so the
+// next fdc_init() repeats the full cold-boot check
+static bool device_verified = false;
+
+// Helper: forget device state after a failed transaction
+static void bus_error() {
+    current_ptr = PTR_UNKNOWN;
+    device_verified = false;
+}
+
+// CAPDAC offset of MEAS4 programmed by fdc_init() (fdc_set_ref_capdac())
+static uint8_t ref_capdac_steps = 0;
+
+// Attempts per register transaction; a failed attempt clears the bus
+// (twi_recover()) before the next
+constexpr uint8_t FDC_TRANSACTION_TRIES = 2;
+
+// Conversion sets per fdc_measure_all(): a failed set is re-triggered
+// once, and the last try follows a soft reset
+constexpr uint8_t FDC_CONVERSION_TRIES = 3;
+
+// Helper: write 16-bit register (also moves the device pointer to reg)
 static bool write_reg16(uint8_t reg, uint16_t value) {
     uint8_t data[3] = {reg, (uint8_t)(value >> 8), (uint8_t)(value & 0xFF)};
-    return twi_write(FDC1004_ADDR, data, 3, 20) == TwiStatus::OK;
+    for (uint8_t attempt = 0; attempt < FDC_TRANSACTION_TRIES; attempt++) {
+        if (attempt > 0) {
+            twi_recover();
+        }
+        if (twi_write(FDC1004_ADDR, data, 3, 20) == TwiStatus::OK) {
+            current_ptr = reg;
+            return true;
+        }
+        bus_error();
+    }
+    return false;
 }
 
-// Helper: read 16-bit register
+// Helper: read 16-bit register (pointer write only when reg changes)
 static bool read_reg16(uint8_t reg, uint16_t* value) {
     uint8_t data[2];
-    if (twi_read_regs(FDC1004_ADDR, reg, data, 2, 20) != TwiStatus::OK) {
-        return false;
+    for (uint8_t attempt = 0; attempt < FDC_TRANSACTION_TRIES; attempt++) {
+        if (attempt > 0) {
+            twi_recover();
+        }
+        if (current_ptr != reg) {
+            if (twi_write(FDC1004_ADDR, &reg, 1, 20) != TwiStatus::OK) {
+                bus_error();
+                continue;
+            }
+            current_ptr = reg;
+        }
+        if (twi_read(FDC1004_ADDR, data, 2, 20) == TwiStatus::OK) {
+            *value = ((uint16_t)data[0] << 8) | data[1];
+            return true;
+        }
+        bus_error();  // Pointer rewritten on the retry
     }
-    *value = ((uint16_t)data[0] << 8) | data[1];
-    return true;
+    return false;
 }
 
-bool fdc_init() {
-    // Verify device ID
-    uint16_t dev_id;
-    if (!fdc_read_device_id(&dev_id)) {
-        return false;
+void fdc_invalidate_pointer() {
+    current_ptr = PTR_UNKNOWN;
+}
+
+// Helper: program CONF_MEASx for a channel
+static bool configure_measurement(FdcChannel ch) {
+    uint8_t idx = static_cast<uint8_t>(ch);
+
+    // Level channels: CINx - CIN4 (both inputs see the same parasitics)
+    // Reference: CIN4 single-ended, minus the CAPDAC offset if one is selected
+    uint16_t capdac = 0;
+    uint16_t cin_pos = idx;  // CIN1..CIN4
+    uint16_t cin_neg = FDC_REF;
+    if (ch == FdcChannel::REF) {
+        capdac = ref_capdac_steps;
+        cin_neg = capdac ? FdcConf::CHB_CAPDAC : FdcConf::CHB_DISABLED;
     }
+    uint16_t meas_conf = (cin_pos << FdcConf::CHA_OFFSET) |
+                         (cin_neg << FdcConf::CHB_OFFSET) |
+                         (capdac << FdcConf::CAPDAC_OFFSET);
+    return write_reg16(FdcReg::CONF_MEAS1 + idx, meas_conf);
+}
+
+void fdc_set_ref_capdac(uint8_t steps) {
+    ref_capdac_steps = (steps > FDC_CAPDAC_MAX) ? FDC_CAPDAC_MAX : steps;
+}
 
-    // FDC1004 should return 0x1004 or 0x1005
-    if (dev_id != 0x1004 && dev_id != 0x1005) {
+bool fdc_init() {
+    trace_phase(TracePhase::FDC_INIT);
+
+    // Device pointer is unknown after power-up
+    fdc_invalidate_pointer();
+
+    // Wait for the device to come out of power-on reset (first ACK)
+    // instead of a fixed rail-settle delay. Without one the bus may be
+    // stuck (SDA held by an interrupted transfer): free it and probe once
+    // more (the device is out of reset by now)
+    if (twi_probe(FDC1004_ADDR, FDC_POWERUP_TIMEOUT_MS) != TwiStatus::OK &&
+        (twi_recover() != TwiStatus::OK || twi_probe(FDC1004_ADDR, 1) != TwiStatus::OK)) {
+        device_verified = false;
         return false;
     }
 
-    // Initialize FDC_CONF register:
-    // - 100 S/s sample rate (best SNR)
-    // - Single-shot mode (REPEAT = 0)
-    // - All measurements disabled initially
-    uint16_t conf = FdcConf::RATE_100SPS;
-    if (!write_reg16(FdcReg::FDC_CONF, conf)) {
-        return false;
+    // Verify device ID on cold boot or after an error only
+    if (!device_verified) {
+        uint16_t dev_id;
+        if (!fdc_read_device_id(&dev_id)) {
+            return false;
+        }
+
+        // FDC1004 should return 0x1004 or 0x1005
+        if (dev_id != 0x1004 && dev_id != 0x1005) {
+            return false;
+        }
     }
 
-    _delay_ms(1);  // Allow config to settle
+    // Program CONF_MEAS1..4 back-to-back (lost with VDD_SW)
+    // FDC_CONF (rate, single-shot, enables) is written by the trigger functions
+    for (uint8_t i = 0; i < FDC_NUM_READINGS; i++) {
+        if (!configure_measurement(static_cast<FdcChannel>(i))) {
+            return false;
+        }
+    }
 
+    device_verified = true;
     return true;
 }
 
+// DONE bits the current conversion set is waiting on (set by trigger functions)
+static uint16_t pending_done = 0;
+static uint8_t pending_count = 0;
+static uint16_t pending_polls = 0;  // fdc_poll_ready() reads so far
+
 bool fdc_trigger_measurement(FdcChannel ch) {
-    // Map channel to measurement register and CIN pins
-    uint8_t meas_reg;
-    uint16_t cin_pos, cin_neg;
-    uint16_t meas_enable;
-
-    switch (ch) {
-        case FdcChannel::C1:
-            meas_reg = FdcReg::CONF_MEAS1;
-            cin_pos = 0;  // CIN1
-            cin_neg = 7;  // Disabled (single-ended)
-            meas_enable = FdcConf::MEAS1_EN;
-            break;
-        case FdcChannel::C2:
-            meas_reg = FdcReg::CONF_MEAS2;
-            cin_pos = 1;  // CIN2
-            cin_neg = 7;  // Disabled (single-ended)
-            meas_enable = FdcConf::MEAS2_EN;
-            break;
-        case FdcChannel::C3:
-            meas_reg = FdcReg::CONF_MEAS3;
-            cin_pos = 2;  // CIN3
-            cin_neg = 7;  // Disabled (single-ended)
-            meas_enable = FdcConf::MEAS3_EN;
-            break;
-        default:
-            return false;
+    uint8_t idx = static_cast<uint8_t>(ch);
+    if (idx >= FDC_NUM_READINGS) {
+        return false;
     }
 
-    // Configure measurement: CINx single-ended (CHB disabled), CAPDAC disabled
-    uint16_t meas_conf = (cin_pos << FdcConf::CHA_OFFSET) |
-                         (cin_neg << FdcConf::CHB_OFFSET);
-    if (!write_reg16(meas_reg, meas_conf)) {
+    // Enable measurement in FDC_CONF (CONF_MEASx programmed by fdc_init)
+    // - FDC_SAMPLE_RATE
+    // - Single-shot mode (REPEAT = 0)
+    uint16_t fdc_conf = FDC_RATE | (FdcConf::MEAS1_EN >> idx);
+    if (!write_reg16(FdcReg::FDC_CONF, fdc_conf)) {
         return false;
     }
 
-    // Enable measurement in FDC_CONF
-    uint16_t fdc_conf = FdcConf::RATE_100SPS | meas_enable;
+    pending_done = FdcConf::MEAS1_DONE >> idx;
+    pending_count = 1;
+    pending_polls = 0;
+    return true;
+}
+
+// Helper: enable MEAS1-4 in one FDC_CONF write (mode: 0 or REPEAT)
+static bool trigger_set(uint16_t mode) {
+    // The FDC1004 runs them back-to-back and sets each DONE bit in turn
+    // (in repeat mode it keeps cycling through them)
+    uint16_t fdc_conf = FDC_RATE | mode |
+                        FdcConf::MEAS1_EN | FdcConf::MEAS2_EN |
+                        FdcConf::MEAS3_EN | FdcConf::MEAS4_EN;
     if (!write_reg16(FdcReg::FDC_CONF, fdc_conf)) {
         return false;
     }
 
+    pending_done = FdcConf::MEAS1_DONE | FdcConf::MEAS2_DONE |
+                   FdcConf::MEAS3_DONE | FdcConf::MEAS4_DONE;
+    pending_count = FDC_NUM_READINGS;
+    pending_polls = 0;
     return true;
 }
 
+bool fdc_trigger_all() {
+    return trigger_set(0);
+}
+
 bool fdc_wait_ready(uint16_t timeout_ms) {
+    trace_phase(TracePhase::CONV_WAIT);
+
+    // Sleep through the expected conversion time instead of polling the bus
+    // Falls through to polling if the RTC wake timer is not available
+    uint16_t expected_ms = ((uint32_t)pending_count * FDC_CONVERSION_US + 999) / 1000;
+    if (expected_ms <= timeout_ms && power_sleep_ms(expected_ms)) {
+        timeout_ms -= expected_ms;
+    }
+
+    // Confirm DONE (normally set on the first read after sleeping)
     uint32_t timeout_us = (uint32_t)timeout_ms * 1000;
+    uint16_t polls = 0;
 
-    while (timeout_us > 0) {
+    do {
         uint16_t fdc_conf;
+        polls++;
         if (!read_reg16(FdcReg::FDC_CONF, &fdc_conf)) {
+            stats_fdc_wait(polls, false);  // Bus failure, counted by twi
             return false;
         }
 
-        // Check if any DONE bit is set
-        if (fdc_conf & (FdcConf::MEAS1_DONE | FdcConf::MEAS2_DONE |
-                        FdcConf::MEAS3_DONE | FdcConf::MEAS4_DONE)) {
+        // Check if every triggered measurement has its DONE bit set
+        if ((fdc_conf & pending_done) == pending_done) {
+            stats_fdc_wait(polls, false);
             return true;
         }
 
         _delay_us(100);
         timeout_us = (timeout_us > 100) ? (timeout_us - 100) : 0;
-    }
+    } while (timeout_us > 0);
 
+    stats_fdc_wait(polls, true);
     return false;  // Timeout
 }
 
+bool fdc_poll_ready(bool* done) {
+    uint16_t fdc_conf;
+
+    pending_polls++;
+    if (!read_reg16(FdcReg::FDC_CONF, &fdc_conf)) {
+        stats_fdc_wait(pending_polls, false);  // Bus failure, counted by twi
+        return false;
+    }
+
+    *done = (fdc_conf & pending_done) == pending_done;
+    if (*done) {
+        stats_fdc_wait(pending_polls, false);
+    }
+    return true;
+}
+
 FdcReading fdc_read_result(FdcChannel ch) {
     FdcReading result = {0, false};
 
-    // Map channel to result registers
-    uint8_t msb_reg, lsb_reg;
-    switch (ch) {
-        case FdcChannel::C1:
-            msb_reg = FdcReg::MEAS1_MSB;
-            lsb_reg = FdcReg::MEAS1_LSB;
-            break;
-        case FdcChannel::C2:
-            msb_reg = FdcReg::MEAS2_MSB;
-            lsb_reg = FdcReg::MEAS2_LSB;
-            break;
-        case FdcChannel::C3:
-            msb_reg = FdcReg::MEAS3_MSB;
-            lsb_reg = FdcReg::MEAS3_LSB;
-            break;
-        default:
-            return result;
+    uint8_t idx = static_cast<uint8_t>(ch);
+    if (idx >= FDC_NUM_READINGS) {
+        return result;
     }
 
+    // Result registers are laid out as MSB/LSB pairs per measurement
+    uint8_t msb_reg = FdcReg::MEAS1_MSB + 2 * idx;
+    uint8_t lsb_reg = FdcReg::MEAS1_LSB + 2 * idx;
+
     // Read 24-bit result (MSB + LSB)
     uint16_t msb, lsb;
     if (!read_reg16(msb_reg, &msb) || !read_reg16(lsb_reg, &lsb)) {
@@ -201,12 +325,8 @@ FdcReading fdc_read_result(FdcChannel ch) {
         raw |= 0xFF000000;
     }
 
-    // Convert to femtofarads
-    // FDC1004 range: ±15 pF over 24-bit signed range
-    // Resolution: 15 pF / 2^23 = ~1.79 fF per LSB
-    // Conversion: capacitance_fF = raw * 15000000 / 2^23
-    // Simplified: capacitance_fF = (raw * 15000000) >> 23
-    result.capacitance_ff = (int16_t)((raw * 15000LL) >> 23);  // Use LL for 64-bit intermediate
+    // Kept as a result code; callers compare in code units
+    result.raw = raw;
     result.valid = true;
 
     return result;
@@ -226,9 +346,89 @@ FdcReading fdc_measure(FdcChannel ch, uint16_t timeout_ms) {
     }
 
     // Read result
+    trace_phase(TracePhase::RESULT_READ);
     return fdc_read_result(ch);
 }
 
+/**
+ * Average FDC_BURST_SETS repeat-mode sets, the first one already DONE
+ *
+ * The device keeps converting, so waiting one set time between reads
+ * gives every channel a fresh result. Repeat mode is stopped at the end.
+ */
+static bool read_burst(FdcReading readings[FDC_NUM_READINGS]) {
+    int32_t sum[FDC_NUM_READINGS] = {};
+    uint8_t count[FDC_NUM_READINGS] = {};
+
+    for (uint8_t set = 0; set < FDC_BURST_SETS; set++) {
+        if (set > 0 && !power_sleep_ms(FDC_MEASURE_ALL_MS)) {
+            _delay_ms(FDC_MEASURE_ALL_MS);
+        }
+
+        FdcReading r[FDC_NUM_READINGS];
+        fdc_read_all(r);
+        for (uint8_t ch = 0; ch < FDC_NUM_READINGS; ch++) {
+            if (r[ch].valid) {
+                sum[ch] += r[ch].raw;
+                count[ch]++;
+            }
+        }
+    }
+
+    // Back to idle (a failure here only leaves it converting until the
+    // rail goes down)
+    write_reg16(FdcReg::FDC_CONF, FDC_RATE);
+
+    bool all_valid = true;
+    for (uint8_t ch = 0; ch < FDC_NUM_READINGS; ch++) {
+        readings[ch].valid = count[ch] > 0;
+        readings[ch].raw = readings[ch].valid ? sum[ch] / count[ch] : 0;
+        all_valid = all_valid && readings[ch].valid;
+    }
+    return all_valid;
+}
+
+bool fdc_measure_all(FdcReading readings[FDC_NUM_READINGS], uint16_t timeout_ms) {
+    for (uint8_t i = 0; i < FDC_NUM_READINGS; i++) {
+        readings[i].raw = 0;
+        readings[i].valid = false;
+    }
+
+    for (uint8_t attempt = 0; attempt < FDC_CONVERSION_TRIES; attempt++) {
+        // Failed twice: the device may have lost its configuration or
+        // stopped converting, start it over
+        if (attempt == FDC_CONVERSION_TRIES - 1 && !fdc_soft_reset()) {
+            return false;
+        }
+
+        // Trigger all four measurements at once and wait for all four
+        // DONE bits
+        if constexpr (FDC_BURST_SETS == 1) {
+            if (fdc_trigger_all() && fdc_wait_ready(timeout_ms)) {
+                return fdc_read_all(readings);
+            }
+        } else {
+            if (trigger_set(FdcConf::REPEAT) && fdc_wait_ready(timeout_ms)) {
+                return read_burst(readings);
+            }
+        }
+    }
+
+    return false;
+}
+
+bool fdc_read_all(FdcReading readings[FDC_NUM_READINGS]) {
+    trace_phase(TracePhase::RESULT_READ);
+    bool all_valid = true;
+    for (uint8_t i = 0; i < FDC_NUM_READINGS; i++) {
+        // A failed channel does not stop the others (partial result)
+        readings[i] = fdc_read_result(static_cast<FdcChannel>(i));
+        all_valid = all_valid && readings[i].valid;
+    }
+
+    return all_valid;
+}
+
 bool fdc_soft_reset() {
     // Write RESET bit to FDC_CONF
     if (!write_reg16(FdcReg::FDC_CONF, FdcConf::RESET)) {
@@ -236,8 +436,10 @@ bool fdc_soft_reset() {
     }
 
     _delay_ms(10);  // Wait for reset to complete
+    fdc_invalidate_pointer();
 
-    // Reinitialize
+    // Reinitialize (full ID check)
+    device_verified = false;
     return fdc_init();
 }
 
@@ -0,0 +1,81 @@
+/**
+ * @file governor.cpp
+ * @brief Energy governor implementation
+ */
+
+#include "governor.h"
+#include "scheduler.h"
+
+// Tier limits (index = EnergyTier)
+static const EnergyPolicy POLICIES[] = {
+    {0, 0, BeepPattern::FIVE, 3},    // NORMAL - as configured
+    {1, 1, BeepPattern::TRIPLE, 3},  // SAVING
+    {2, 1, BeepPattern::DOUBLE, 2},  // CRITICAL
+};
+
+// Entry thresholds (mV, index = worse tier - 1); leaving needs the margin on top
+static const uint16_t ENTER_MV[] = {2700, 2500};
+constexpr uint16_t HYSTERESIS_MV = 50;
+
+constexpr uint8_t NUM_TIERS = sizeof(POLICIES) / sizeof(POLICIES[0]);
+static_assert(sizeof(ENTER_MV) / sizeof(ENTER_MV[0]) == NUM_TIERS - 1, "One threshold per tier step");
+
+struct GovernorState {
+    EnergyTier tier;
+    uint32_t next_check_tick;
+    uint32_t next_chirp_tick;
+};
+
+static GovernorState state = {EnergyTier::NORMAL, 0, 0};
+
+void governor_init(uint32_t tick) {
+    state.tier = EnergyTier::NORMAL;
+    state.next_check_tick = tick;
+    state.next_chirp_tick = tick;
+}
+
+bool governor_check_due(uint32_t tick) {
+    return sched_tick_reached(state.next_check_tick, tick);
+}
+
+bool governor_update(uint16_t vdd_mv, uint32_t tick) {
+    state.next_check_tick = tick + GOVERNOR_CHECK_SEC;
+
+    // Worst tier whose threshold the reading is below; stepping back up
+    // needs the hysteresis margin above the current tier's threshold
+    uint8_t tier = 0;
+    for (uint8_t i = 0; i < NUM_TIERS - 1; i++) {
+        uint16_t threshold = ENTER_MV[i];
+        if (i < static_cast<uint8_t>(state.tier)) {
+            threshold += HYSTERESIS_MV;
+        }
+        if (vdd_mv < threshold) {
+            tier = i + 1;
+        }
+    }
+
+    if (tier == static_cast<uint8_t>(state.tier)) {
+        return false;
+    }
+    if (tier > static_cast<uint8_t>(state.tier)) {
+        state.next_chirp_tick = tick;  // Warn as soon as it gets worse
+    }
+    state.tier = static_cast<EnergyTier>(tier);
+    return true;
+}
+
+EnergyTier governor_tier() {
+    return state.tier;
+}
+
+const EnergyPolicy& governor_policy() {
+    return POLICIES[static_cast<uint8_t>(state.tier)];
+}
+
+bool governor_chirp_due(uint32_t tick) {
+    if (state.tier == EnergyTier::NORMAL || !sched_tick_reached(state.next_chirp_tick, tick)) {
+        return false;
+    }
+    state.next_chirp_tick = tick + LOW_BATTERY_CHIRP_SEC;
+    return true;
+}
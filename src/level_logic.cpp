@@ -5,132 +5,391 @@
 
 #include "level_logic.h"
 #include "fdc1004.h"
+#include "feature_set.h"
+
+// Debounce configuration (overridable for offline re-scoring, simulator/replay.cpp)
+#ifndef LEVEL_DEBOUNCE_SAMPLES
+#define LEVEL_DEBOUNCE_SAMPLES 3
+#endif
+constexpr uint8_t DEBOUNCE_SAMPLES = LEVEL_DEBOUNCE_SAMPLES;  // Consistent readings before changing level
+static_assert(DEBOUNCE_SAMPLES >= 1, "Debounce needs at least one sample");
+
+// Per-channel IIR on the readings: y += (x - y) / 2^n (0 = off). Steps
+// larger than STABLE_DELTA_RAW pass straight through, so the filter only
+// smooths noise and never delays a real level change by more than that
+#ifndef LEVEL_IIR_SHIFT
+#define LEVEL_IIR_SHIFT 1
+#endif
+constexpr uint8_t IIR_SHIFT = LEVEL_IIR_SHIFT;
+
+// Baseline drift tracking: EMA weight 1/2^n per solid NORMAL wake
+// (~2 h at the 120 s ladder top)
+#ifndef LEVEL_BASELINE_SHIFT
+#define LEVEL_BASELINE_SHIFT 6
+#endif
+constexpr uint8_t BASELINE_SHIFT = LEVEL_BASELINE_SHIFT;
 
 // Module state
 struct LevelState {
-    LevelThresholds thresholds;
-    CalibrationData calibration;
+    // Effective trip points in result codes (threshold, or baseline -
+    // threshold when calibrated), per channel: [0] going down, [1] with
+    // hysteresis (required to come back up)
+    int32_t trip_raw[FDC_NUM_CHANNELS][2];
     WaterLevel current_level;
     uint8_t debounce_counter;
+    uint8_t debounce_required;  // Consistent samples to change level (level_set_debounce)
     WaterLevel pending_level;
-    int16_t last_c1_ff;
-    int16_t last_c2_ff;
-    int16_t last_c3_ff;
+    int32_t last_raw[FDC_NUM_READINGS];  // Filtered result codes (IIR state), CIN4 unfiltered
+    int32_t ref_offset_raw;  // CAPDAC offset subtracted from the CIN4 reading
     bool readings_valid;
+    bool readings_stable;  // Last reading close to the one before it
+    uint8_t held_mask;     // Channels holding last_raw after a failed read (bit = channel)
+};
+
+// Baseline drift tracking (calibrated units, BASELINE_TRACK only)
+struct BaselineTrack {
+    int16_t base_ff[FDC_NUM_CHANNELS];  // Saved baseline
+    int32_t est_raw[FDC_NUM_CHANNELS];  // Slow estimate of the full-tank reading
+    uint16_t drift_steps;  // Saved net drift (NvmConfig::drift_steps)
+    uint8_t solid_wakes;   // Consecutive stable NORMAL wakes
+    bool active;           // Calibrated: there is a baseline to track
 };
 
+static BaselineTrack baseline = {};
+
 static LevelState state = {
-    .thresholds = {800, 500, 300, 10},  // Default thresholds
-    .calibration = {0, 0, 0, false},
+    .trip_raw = {},
     .current_level = WaterLevel::NORMAL,
     .debounce_counter = 0,
+    .debounce_required = DEBOUNCE_SAMPLES,
     .pending_level = WaterLevel::NORMAL,
-    .last_c1_ff = 0,
-    .last_c2_ff = 0,
-    .last_c3_ff = 0,
-    .readings_valid = false
+    .last_raw = {},
+    .ref_offset_raw = 0,
+    .readings_valid = false,
+    .readings_stable = false,
+    .held_mask = 0
 };
 
-// Debounce configuration
-constexpr uint8_t DEBOUNCE_SAMPLES = 3;  // Require 3 consistent readings before changing level
+// Fast confirm: extra back-to-back conversions per wake while debouncing,
+// per required sample (0 = off, debounce across wakes only)
+constexpr uint8_t FAST_CONFIRM_PER_SAMPLE = 2;
+
+// Max change between consecutive readings (any channel) to count as stable
+constexpr int32_t STABLE_DELTA_RAW = fdc_ff_to_raw(25);
+
+// CIN4 reference limits: absolute minimum (open electrode) and the code
+// above which MEAS4 is clipping at full scale (shorted or flooded)
+constexpr int32_t REF_MIN_RAW = fdc_ff_to_raw(LEVEL_REF_MIN_FF);
+constexpr int32_t REF_MAX_RAW = fdc_ff_to_raw(14500);
+
+// Bits of held_mask for the level channels
+constexpr uint8_t LEVEL_MASK = (1 << FDC_NUM_CHANNELS) - 1;
+
+// Baseline drift: stable NORMAL wakes before the estimate learns, readings
+// too far from it to learn from (partly dry electrode), the step saved per
+// journal write and the net steps a channel may drift from calibration
+// (bounds how far a slow drain could ever pull the trip points down)
+constexpr uint8_t BASELINE_SOLID_WAKES = 6;
+constexpr int32_t BASELINE_WINDOW_RAW = fdc_ff_to_raw(100);
+constexpr int16_t BASELINE_STEP_FF = 25;
+constexpr int8_t BASELINE_MAX_STEPS = 15;
+constexpr uint8_t DRIFT_BITS = 5;  // Signed steps per channel in drift_steps
+static_assert(BASELINE_MAX_STEPS < (1 << (DRIFT_BITS - 1)), "Drift steps must fit their field");
+static_assert(FDC_NUM_CHANNELS * DRIFT_BITS <= 16, "Drift steps must fit NvmConfig::drift_steps");
+
+// Trend history: ring buffer of result codes for drain-rate estimation,
+// stored as raw >> HISTORY_SHIFT (~0.46 fF per unit) to fit 16 bits
+constexpr uint8_t HISTORY_LEN = 4;
+constexpr uint8_t HISTORY_SHIFT = 8;
+
+struct LevelHistory {
+    int16_t code[HISTORY_LEN][FDC_NUM_CHANNELS];  // Scaled result codes
+    uint16_t time_sec[HISTORY_LEN];               // Low 16 bits of tick
+    uint8_t head;                                 // Next slot to write
+    uint8_t count;                                // Valid entries
+};
+
+static LevelHistory history = {};
+
+static void history_clear() {
+    history.head = 0;
+    history.count = 0;
+}
+
+static void history_push(uint32_t now_sec, const int32_t raw[FDC_NUM_CHANNELS]) {
+    uint8_t i = history.head;
+    for (uint8_t ch = 0; ch < FDC_NUM_CHANNELS; ch++) {
+        history.code[i][ch] = (int16_t)(raw[ch] >> HISTORY_SHIFT);
+    }
+    history.time_sec[i] = (uint16_t)now_sec;
+    history.head = (i + 1) % HISTORY_LEN;
+    if (history.count < HISTORY_LEN) {
+        history.count++;
+    }
+}
+
+/**
+ * Recompute trip points from thresholds, hysteresis and baseline
+ *
+ * Runs only when configuration changes, so the per-wake path is compares.
+ */
+static void build_trip_table(const NvmConfig& config) {
+    const int16_t th_ff[FDC_NUM_CHANNELS] = {
+        (int16_t)config.th_low_ff,   // CIN1
+        (int16_t)config.th_vlow_ff,  // CIN2
+        (int16_t)config.th_crit_ff   // CIN3
+    };
+    const int16_t base_ff[FDC_NUM_CHANNELS] = {
+        config.base_c1_ff,
+        config.base_c2_ff,
+        config.base_c3_ff
+    };
+
+    // Calibrated: the baseline is the full-tank reading and a channel trips
+    // once it has dropped its threshold below it
+    for (uint8_t ch = 0; ch < FDC_NUM_CHANNELS; ch++) {
+        int16_t hyst_ff = (int16_t)(((int32_t)th_ff[ch] * config.hysteresis_pct) / 100);
+        int32_t trip = fdc_ff_to_raw(th_ff[ch]);
+        if (config.calibration_valid) {
+            trip = fdc_ff_to_raw(base_ff[ch]) - trip;
+        }
+        state.trip_raw[ch][0] = trip;
+        state.trip_raw[ch][1] = features::LEVEL_FILTER ? trip + fdc_ff_to_raw(hyst_ff) : trip;
+    }
+
+    // Drift tracking starts over from the saved baseline
+    if constexpr (features::BASELINE_TRACK) {
+        for (uint8_t ch = 0; ch < FDC_NUM_CHANNELS; ch++) {
+            baseline.base_ff[ch] = base_ff[ch];
+            baseline.est_raw[ch] = fdc_ff_to_raw(base_ff[ch]);
+        }
+        baseline.drift_steps = config.drift_steps;
+        baseline.solid_wakes = 0;
+        baseline.active = config.calibration_valid;
+    }
+
+    // The reference was calibrated with this offset
+    uint8_t ref_capdac = config.calibration_valid ? config.ref_capdac : 0;
+    if (ref_capdac > FDC_CAPDAC_MAX) {
+        ref_capdac = FDC_CAPDAC_MAX;
+    }
+    fdc_set_ref_capdac(ref_capdac);
+    state.ref_offset_raw = ref_capdac * fdc_ff_to_raw(FDC_CAPDAC_STEP_FF);
+}
+
+static bool ref_in_range(int32_t raw) {
+    return raw + state.ref_offset_raw >= REF_MIN_RAW && raw <= REF_MAX_RAW;
+}
+
+// Net drift of a channel in BASELINE_STEP_FF steps (signed field of drift_steps)
+static int8_t drift_get(uint16_t packed, uint8_t ch) {
+    int8_t steps = (packed >> (ch * DRIFT_BITS)) & ((1 << DRIFT_BITS) - 1);
+    return (steps & (1 << (DRIFT_BITS - 1))) ? steps - (1 << DRIFT_BITS) : steps;
+}
+
+static uint16_t drift_set(uint16_t packed, uint8_t ch, int8_t steps) {
+    uint16_t mask = ((1 << DRIFT_BITS) - 1) << (ch * DRIFT_BITS);
+    return (packed & ~mask) | (((uint16_t)steps << (ch * DRIFT_BITS)) & mask);
+}
 
-void level_init(const LevelThresholds& thresholds, const CalibrationData& calibration) {
-    state.thresholds = thresholds;
-    state.calibration = calibration;
+static bool within_delta(int32_t a, int32_t b) {
+    int32_t d = a - b;
+    return d > -STABLE_DELTA_RAW && d < STABLE_DELTA_RAW;
+}
+
+void level_init(const NvmConfig& config) {
     state.current_level = WaterLevel::NORMAL;
     state.debounce_counter = 0;
     state.pending_level = WaterLevel::NORMAL;
     state.readings_valid = false;
+    state.readings_stable = false;
+    state.held_mask = 0;
+    build_trip_table(config);
+    history_clear();
 }
 
-void level_set_thresholds(const LevelThresholds& thresholds) {
-    state.thresholds = thresholds;
+void level_set_debounce(uint8_t samples) {
+    if (samples < 1 || samples > DEBOUNCE_SAMPLES) {
+        samples = DEBOUNCE_SAMPLES;
+    }
+    state.debounce_required = samples;
+    if (state.debounce_counter > samples) {
+        state.debounce_counter = samples;
+    }
 }
 
-void level_set_calibration(const CalibrationData& calibration) {
-    state.calibration = calibration;
+void level_save_warm(LevelWarmState& out) {
+    for (uint8_t ch = 0; ch < FDC_NUM_READINGS; ch++) {
+        out.last_raw[ch] = state.last_raw[ch];
+    }
+    out.current_level = state.current_level;
+    out.pending_level = state.pending_level;
+    out.debounce_counter = state.debounce_counter;
+    out.readings_valid = state.readings_valid;
+}
+
+void level_restore_warm(const LevelWarmState& in) {
+    for (uint8_t ch = 0; ch < FDC_NUM_READINGS; ch++) {
+        state.last_raw[ch] = in.last_raw[ch];
+    }
+    state.current_level = in.current_level;
+    state.pending_level = in.pending_level;
+    state.debounce_counter = in.debounce_counter;
+    if (state.debounce_counter > state.debounce_required) {
+        state.debounce_counter = state.debounce_required;
+    }
+    state.readings_valid = in.readings_valid;
+}
+
+void level_set_config(const NvmConfig& config) {
+    build_trip_table(config);  // History holds uncalibrated codes, still valid
 }
 
 /**
- * Determine water level from calibrated readings with hysteresis
+ * Determine water level from result codes with hysteresis
  */
-static WaterLevel determine_level(int16_t c1_ff, int16_t c2_ff, int16_t c3_ff) {
-    // Calculate hysteresis offset
-    int16_t hyst_low = (state.thresholds.low_ff * state.thresholds.hysteresis_pct) / 100;
-    int16_t hyst_vlow = (state.thresholds.vlow_ff * state.thresholds.hysteresis_pct) / 100;
-    int16_t hyst_crit = (state.thresholds.crit_ff * state.thresholds.hysteresis_pct) / 100;
+static WaterLevel determine_level(const int32_t raw[FDC_NUM_CHANNELS]) {
+    // Channel ch guards level ch + 1 (CIN1 = Low, CIN2 = Very-Low,
+    // CIN3 = Critical). At or below that level, its hysteresis trip point
+    // applies: more water is required to exit.
+    uint8_t cur = static_cast<uint8_t>(state.current_level);
+    if (state.current_level == WaterLevel::ERROR) {
+        cur = 0;
+    }
 
-    // Apply hysteresis based on current state
-    // When transitioning DOWN (water decreasing), use lower threshold
-    // When transitioning UP (water increasing), use higher threshold
+    // Check thresholds in order (worst to best)
+    for (int8_t ch = FDC_NUM_CHANNELS - 1; ch >= 0; ch--) {
+        bool hyst = cur > (uint8_t)ch;
+        if (raw[ch] < state.trip_raw[ch][hyst]) {
+            return static_cast<WaterLevel>(ch + 1);
+        }
+    }
 
-    int16_t th_crit = state.thresholds.crit_ff;
-    int16_t th_vlow = state.thresholds.vlow_ff;
-    int16_t th_low = state.thresholds.low_ff;
+    return WaterLevel::NORMAL;
+}
 
-    // Apply hysteresis band
-    if (state.current_level <= WaterLevel::CRITICAL) {
-        th_crit += hyst_crit;  // Require more water to exit Critical
-    }
-    if (state.current_level <= WaterLevel::VERY_LOW) {
-        th_vlow += hyst_vlow;  // Require more water to exit Very-Low
+/**
+ * Follow the full-tank reading while the level is solidly NORMAL
+ *
+ * Every electrode is wet then, so the readings are the current baseline.
+ * Fed only on the first sample of a wake with stable readings, after
+ * BASELINE_SOLID_WAKES such wakes in a row.
+ */
+static void track_baseline(const int32_t raw[FDC_NUM_CHANNELS]) {
+    bool solid = state.readings_stable &&
+                 state.current_level == WaterLevel::NORMAL &&
+                 state.pending_level == WaterLevel::NORMAL &&
+                 state.debounce_counter >= state.debounce_required;
+    if (!solid) {
+        baseline.solid_wakes = 0;
+        return;
     }
-    if (state.current_level <= WaterLevel::LOW) {
-        th_low += hyst_low;  // Require more water to exit Low
+    if (baseline.solid_wakes < BASELINE_SOLID_WAKES) {
+        baseline.solid_wakes++;
+        return;
     }
 
-    // Check thresholds in order (worst to best)
-    // CIN3 = Critical level
-    if (c3_ff < th_crit) {
-        return WaterLevel::CRITICAL;
+    for (uint8_t ch = 0; ch < FDC_NUM_CHANNELS; ch++) {
+        int32_t d = raw[ch] - baseline.est_raw[ch];
+        if (d > -BASELINE_WINDOW_RAW && d < BASELINE_WINDOW_RAW) {
+            baseline.est_raw[ch] += d >> BASELINE_SHIFT;
+        }
     }
+}
 
-    // CIN2 = Very-Low level
-    if (c2_ff < th_vlow) {
-        return WaterLevel::VERY_LOW;
-    }
+/**
+ * Sensor error: forget the readings, level becomes ERROR
+ */
+static bool sensor_error() {
+    state.readings_valid = false;
+    state.readings_stable = false;
+    state.held_mask = 0;
+    state.current_level = WaterLevel::ERROR;
+    return false;
+}
 
-    // CIN1 = Low level
-    if (c1_ff < th_low) {
-        return WaterLevel::LOW;
+/**
+ * Run one measurement through the trip table and debouncing
+ *
+ * Only the first sample of a wake updates stability and trend history;
+ * fast-confirm samples are too close together to say anything about drift.
+ *
+ * A partial result is kept: a channel that failed (after the driver's
+ * retries) holds its last reading for one sample while the others are
+ * evaluated as usual. Failing again, or with nothing to hold, is a sensor
+ * error. So is a CIN4 reference outside its plausible range: the
+ * differential readings mean nothing without it.
+ *
+ * @return false on sensor error
+ */
+static bool add_sample(uint32_t now_sec, const FdcReading r[FDC_NUM_READINGS], bool valid,
+                       bool first) {
+    if (!valid) {
+        return sensor_error();
     }
 
-    return WaterLevel::NORMAL;
-}
+    int32_t raw[FDC_NUM_READINGS];
+    uint8_t held = 0;
+    for (uint8_t ch = 0; ch < FDC_NUM_READINGS; ch++) {
+        raw[ch] = r[ch].raw;
+        if (!r[ch].valid) {
+            if (!state.readings_valid || (state.held_mask & (1 << ch))) {
+                return sensor_error();
+            }
+            raw[ch] = state.last_raw[ch];
+            held |= 1 << ch;
+        }
+    }
+    if ((held & LEVEL_MASK) == LEVEL_MASK) {
+        return sensor_error();  // Nothing measured
+    }
+    if (!ref_in_range(raw[FDC_REF])) {
+        return sensor_error();  // Reference open, shorted or flooded
+    }
+    state.held_mask = held;
 
-WaterLevel level_update() {
-    // Measure all three channels
-    FdcReading r1 = fdc_measure(FdcChannel::C1, 20);
-    FdcReading r2 = fdc_measure(FdcChannel::C2, 20);
-    FdcReading r3 = fdc_measure(FdcChannel::C3, 20);
+    // Track stability against the previous reading and record the trend
+    // (both only feed the wake interval policy; a held channel says nothing)
+    bool track = features::ADAPTIVE_WAKE && first && !held;
+    if (track) {
+        state.readings_stable = state.readings_valid;
+        for (uint8_t ch = 0; ch < FDC_NUM_CHANNELS; ch++) {
+            if (!within_delta(raw[ch], state.last_raw[ch])) {
+                state.readings_stable = false;
+            }
+        }
+    }
 
-    // Check if all readings are valid
-    if (!r1.valid || !r2.valid || !r3.valid) {
-        state.readings_valid = false;
-        state.current_level = WaterLevel::ERROR;
-        return WaterLevel::ERROR;
+    // Smooth small deviations (noise); a held channel is already filtered
+    if constexpr (features::LEVEL_FILTER && IIR_SHIFT > 0) {
+        for (uint8_t ch = 0; ch < FDC_NUM_CHANNELS; ch++) {
+            if (state.readings_valid && within_delta(raw[ch], state.last_raw[ch])) {
+                raw[ch] = state.last_raw[ch] + ((raw[ch] - state.last_raw[ch]) >> IIR_SHIFT);
+            }
+        }
+    }
+    if (features::PREDICTIVE_WAKE && track) {
+        history_push(now_sec, raw);
     }
 
     // Store raw readings
-    state.last_c1_ff = r1.capacitance_ff;
-    state.last_c2_ff = r2.capacitance_ff;
-    state.last_c3_ff = r3.capacitance_ff;
+    for (uint8_t ch = 0; ch < FDC_NUM_READINGS; ch++) {
+        state.last_raw[ch] = raw[ch];
+    }
     state.readings_valid = true;
 
-    // Apply calibration offsets if valid
-    int16_t c1_cal = r1.capacitance_ff;
-    int16_t c2_cal = r2.capacitance_ff;
-    int16_t c3_cal = r3.capacitance_ff;
+    // Determine new level with hysteresis (baseline is in the trip table)
+    WaterLevel new_level = determine_level(raw);
 
-    if (state.calibration.valid) {
-        c1_cal -= state.calibration.base_c1_ff;
-        c2_cal -= state.calibration.base_c2_ff;
-        c3_cal -= state.calibration.base_c3_ff;
+    if constexpr (!features::LEVEL_FILTER) {
+        // No debouncing: level follows the sample, and a change is not stable
+        if (new_level != state.current_level) {
+            state.readings_stable = false;
+        }
+        state.current_level = new_level;
+        return true;
     }
 
-    // Determine new level with hysteresis
-    WaterLevel new_level = determine_level(c1_cal, c2_cal, c3_cal);
-
     // Apply debouncing
     if (new_level != state.pending_level) {
         // New level detected, reset debounce counter
@@ -140,43 +399,152 @@ WaterLevel level_update() {
         // Same level as pending, increment counter
         state.debounce_counter++;
 
-        if (state.debounce_counter >= DEBOUNCE_SAMPLES) {
+        if (state.debounce_counter >= state.debounce_required) {
             // Debounce complete, update current level
             state.current_level = new_level;
-            state.debounce_counter = DEBOUNCE_SAMPLES;  // Clamp
+            state.debounce_counter = state.debounce_required;  // Clamp
         }
     }
 
+    if constexpr (features::BASELINE_TRACK) {
+        if (baseline.active && track) {
+            track_baseline(raw);
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Measure all channels in a single conversion cycle and add the sample
+ */
+static bool sample_and_debounce(uint32_t now_sec, bool first) {
+    FdcReading r[FDC_NUM_READINGS];
+    fdc_measure_all(r);  // Failed channels come back invalid
+    return add_sample(now_sec, r, true, first);
+}
+
+WaterLevel level_add_sample(uint32_t now_sec, const FdcReading r[FDC_NUM_READINGS], bool valid,
+                            bool first) {
+    if (!add_sample(now_sec, r, valid, first)) {
+        return WaterLevel::ERROR;
+    }
     return state.current_level;
 }
 
+bool level_is_settling() {
+    return features::LEVEL_FILTER && state.readings_valid &&
+           state.debounce_counter < state.debounce_required;
+}
+
+WaterLevel level_settle(uint32_t now_sec) {
+    // Fast confirm: settle a pending change (or its rejection) now, while
+    // the rail is still up, instead of over the next wakes
+    uint8_t max_samples = FAST_CONFIRM_PER_SAMPLE * state.debounce_required;
+    for (uint8_t n = 0; level_is_settling() && n < max_samples; n++) {
+        if (!sample_and_debounce(now_sec, false)) {
+            return WaterLevel::ERROR;
+        }
+    }
+
+    return state.current_level;
+}
+
+WaterLevel level_update(uint32_t now_sec) {
+    if (!sample_and_debounce(now_sec, true)) {
+        return WaterLevel::ERROR;
+    }
+    return level_settle(now_sec);
+}
+
 WaterLevel level_get_current() {
     return state.current_level;
 }
 
+uint32_t level_predict_seconds_to_threshold() {
+    if (!features::PREDICTIVE_WAKE || history.count < 2) {
+        return LEVEL_PREDICT_NONE;
+    }
+
+    // Next threshold down from the current level (no hysteresis going down)
+    // CIN1 when NORMAL, CIN2 when LOW, CIN3 when VERY_LOW
+    if (state.current_level > WaterLevel::VERY_LOW) {
+        return LEVEL_PREDICT_NONE;  // CRITICAL / ERROR: nothing below
+    }
+    uint8_t ch = static_cast<uint8_t>(state.current_level);
+    int16_t th = (int16_t)(state.trip_raw[ch][0] >> HISTORY_SHIFT);
+
+    // Drain rate from oldest to newest sample in the ring
+    uint8_t newest = (history.head + HISTORY_LEN - 1) % HISTORY_LEN;
+    uint8_t oldest = (history.head + HISTORY_LEN - history.count) % HISTORY_LEN;
+    int16_t drop = history.code[oldest][ch] - history.code[newest][ch];
+    uint16_t dt_sec = history.time_sec[newest] - history.time_sec[oldest];
+
+    if (drop <= 0 || dt_sec == 0) {
+        return LEVEL_PREDICT_NONE;  // Not draining
+    }
+
+    int16_t margin = history.code[newest][ch] - th;
+    if (margin <= 0) {
+        return 0;  // Already at/below threshold (debounce pending)
+    }
+
+    // Linear extrapolation: margin / (drop / dt)
+    return (uint32_t)margin * dt_sec / (uint16_t)drop;
+}
+
+bool level_baseline_drift(int16_t base_ff[FDC_NUM_CHANNELS], uint16_t* drift_steps) {
+    if (!features::BASELINE_TRACK || !baseline.active) {
+        return false;
+    }
+
+    // One step per channel whose estimate has moved a full step away,
+    // within its net budget since calibration
+    constexpr int32_t step_raw = fdc_ff_to_raw(BASELINE_STEP_FF);
+    uint16_t packed = baseline.drift_steps;
+    bool moved = false;
+    for (uint8_t ch = 0; ch < FDC_NUM_CHANNELS; ch++) {
+        int32_t d = baseline.est_raw[ch] - fdc_ff_to_raw(baseline.base_ff[ch]);
+        int8_t steps = drift_get(packed, ch);
+        base_ff[ch] = baseline.base_ff[ch];
+        if (d >= step_raw && steps < BASELINE_MAX_STEPS) {
+            base_ff[ch] += BASELINE_STEP_FF;
+            packed = drift_set(packed, ch, steps + 1);
+            moved = true;
+        } else if (d <= -step_raw && steps > -BASELINE_MAX_STEPS) {
+            base_ff[ch] -= BASELINE_STEP_FF;
+            packed = drift_set(packed, ch, steps - 1);
+            moved = true;
+        }
+    }
+
+    *drift_steps = packed;
+    return moved;
+}
+
+bool level_is_stable() {
+    if constexpr (!features::LEVEL_FILTER) {
+        return state.readings_stable;
+    }
+    return state.readings_stable &&
+           state.pending_level == state.current_level &&
+           state.debounce_counter >= state.debounce_required;
+}
+
 bool level_get_raw_readings(int16_t* c1_ff, int16_t* c2_ff, int16_t* c3_ff) {
-    if (c1_ff) *c1_ff = state.last_c1_ff;
-    if (c2_ff) *c2_ff = state.last_c2_ff;
-    if (c3_ff) *c3_ff = state.last_c3_ff;
+    // fF conversion only happens here (diagnostics/calibration)
+    if (c1_ff) *c1_ff = fdc_raw_to_ff(state.last_raw[0]);
+    if (c2_ff) *c2_ff = fdc_raw_to_ff(state.last_raw[1]);
+    if (c3_ff) *c3_ff = fdc_raw_to_ff(state.last_raw[2]);
     return state.readings_valid;
 }
 
 bool level_validate_cin4(int16_t min_ref_ff) {
-    // Measure CIN4 directly (not differential)
-    // We'll approximate by checking if any measurement is reasonable
-    // A better approach would be to add a direct CIN4 measurement function to fdc1004
-
-    // For now, use a heuristic: if all three differential readings are valid
-    // and within reasonable range, CIN4 is probably OK
-    if (!state.readings_valid) {
+    // MEAS4 is CIN4 single-ended, read with every conversion set
+    if (!state.readings_valid || (state.held_mask & (1 << FDC_REF))) {
         return false;
     }
 
-    // Check that readings are within expected differential range (±5 pF = ±5000 fF)
-    if (state.last_c1_ff < -5000 || state.last_c1_ff > 5000) return false;
-    if (state.last_c2_ff < -5000 || state.last_c2_ff > 5000) return false;
-    if (state.last_c3_ff < -5000 || state.last_c3_ff > 5000) return false;
-
-    // All readings in valid range
-    return true;
+    int32_t ref = state.last_raw[FDC_REF];
+    return ref + state.ref_offset_raw >= fdc_ff_to_raw(min_ref_ff) && ref <= REF_MAX_RAW;
 }
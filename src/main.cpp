@@ -5,14 +5,26 @@
  * State flow:
  * BOOT → SLEEP → (wake) → MEASURE → ALERT_CHECK → TEARDOWN → SLEEP → ...
  *
- * Every 10 seconds:
- * 1. Wake from sleep
- * 2. Enable VDD_SW (power on FDC1004 + DRV8210)
- * 3. Measure water level
- * 4. Update alert state
- * 5. If alert active, play beep pattern
- * 6. Disable VDD_SW
- * 7. Return to sleep
+ * Work is scheduled as timed events (scheduler.h); the MCU wakes exactly
+ * when the next one is due:
+ * - MEASURE: every wake interval (10 s, stretched while NORMAL and stable)
+ *   1. Enable VDD_SW (power on FDC1004 + DRV8210)
+ *   2. Measure water level, update alert state
+ * - ALERT_BURST: at the alert level's cadence (10 / 8 / 5 s); the
+ *   measurement runs in the beep gaps of the same VDD_SW window and
+ *   MEASURE moves back, so an alert needs no separate measurement wakes
+ * - CALIBRATION: on long press
+ * Then VDD_SW is disabled and the MCU returns to sleep.
+ *
+ * Once an hour a measurement also checks VDD (governor.h); on a sagging
+ * cell the measurement interval and alert cadence stretch, bursts get
+ * shorter and a low-battery chirp sounds every 6 hours.
+ *
+ * Both targets build this file; feature_set.h selects what is compiled in.
+ * The ATtiny202 profile keeps the sleep / power-gated cycle but measures
+ * every 10 s with trip points from a dry / wet capture at power-up and,
+ * for 5 minutes after the level gets worse, beeps its pattern on each
+ * measurement (no config, button, per-level cadence or escalation).
  */
 
 #include <avr/io.h>
@@ -29,6 +41,12 @@
 #include "buzzer.h"
 #include "button.h"
 #include "eeprom_config.h"
+#include "scheduler.h"
+#include "governor.h"
+#include "warm_state.h"
+#include "stats.h"
+#include "trace.h"
+#include "feature_set.h"
 
 // LED helper functions
 static void led_on() {
@@ -58,25 +76,205 @@ static void led_blink(uint8_t count, uint16_t on_ms, uint16_t off_ms) {
     }
 }
 
+// Wake interval ladder (seconds)
+// Step up while NORMAL and stable, drop back to 10 s on any change or alert
+static const uint8_t WAKE_INTERVALS_SEC[] = {10, 30, 60, 120};
+constexpr uint8_t NUM_WAKE_INTERVALS = sizeof(WAKE_INTERVALS_SEC) / sizeof(WAKE_INTERVALS_SEC[0]);
+constexpr uint8_t STABLE_WAKES_PER_STEP = 3;  // Stable wakes before stepping up
+
+// Predictive scheduling while draining: sleep half the predicted time to the
+// next threshold crossing, so sampling gets denser as the crossing approaches
+// and a steady drain is still caught within about 10 s of it. Far from a
+// crossing this stretches the ladder's top step, up to 10x; a drain that
+// speeds up past the prediction is seen at most MAX_PREDICTED_WAKE_SEC late.
+constexpr uint16_t MIN_WAKE_SEC = 10;
+constexpr uint16_t MAX_PREDICTED_WAKE_SEC = 1200;
+
+static uint8_t wake_interval_step = 0;
+static uint8_t stable_wakes = 0;
+
+// Without ALERT_WINDOWS: one fixed window per worsening level, beeping the
+// level's pattern on every measurement until it ends
+constexpr uint16_t SIMPLE_ALERT_SEC = 300;  // Same length as alert_manager windows
+
+struct SimpleAlert {
+    bool active;
+    uint32_t end_tick;
+};
+
+static SimpleAlert simple_alert = {false, 0};
+
+// Sensor-error buzz: when the level goes to ERROR, at most once per
+// ERROR_BUZZ_SEC so a flaky bus doesn't keep buzzing
+constexpr uint32_t ERROR_BUZZ_SEC = 3600;
+
+static bool error_buzz_due = false;
+static uint32_t next_error_buzz_tick = 0;
+
+// Baseline drift: at most one journaled step every BASELINE_SAVE_SEC
+constexpr uint32_t BASELINE_SAVE_SEC = 6UL * 3600;
+
+static uint32_t next_baseline_save_tick = 0;
+
 /**
- * Calibration mode: Learn baseline with tank full
- * Takes 8 samples per channel and averages (reduced from 16 for flash savings)
+ * Active configuration (EEPROM journal, or factory defaults without it)
  */
-static bool perform_calibration() {
+static const NvmConfig& active_config() {
+    if constexpr (features::CONFIG) {
+        return eeprom_config();
+    } else {
+        return FACTORY_DEFAULTS;
+    }
+}
+
+/**
+ * Journal an event (no-op without CONFIG)
+ */
+static void log_event(NvmEvent event, WaterLevel level, uint32_t tick) {
+    if constexpr (features::CONFIG) {
+        eeprom_log_event(event, static_cast<uint8_t>(level), tick);
+    }
+}
+
+/**
+ * Check for an alert in progress
+ */
+static bool alerting() {
+    if constexpr (features::ALERT_WINDOWS) {
+        return alert_is_active();
+    } else {
+        return simple_alert.active;
+    }
+}
+
+/**
+ * Choose the next measurement interval from level state
+ *
+ * @return Seconds until the next measurement
+ */
+static uint16_t update_wake_interval() {
+    if constexpr (!features::ADAPTIVE_WAKE) {
+        return MIN_WAKE_SEC;
+    }
+
+    uint16_t wake_sec;
+
+    if (level_get_current() == WaterLevel::NORMAL && level_is_stable() &&
+        !alerting()) {
+        if (++stable_wakes >= STABLE_WAKES_PER_STEP &&
+            wake_interval_step < NUM_WAKE_INTERVALS - 1) {
+            wake_interval_step++;
+            stable_wakes = 0;
+        }
+    } else {
+        wake_interval_step = 0;
+        stable_wakes = 0;
+    }
+    wake_sec = WAKE_INTERVALS_SEC[wake_interval_step];
+
+    if constexpr (!features::PREDICTIVE_WAKE) {
+        return wake_sec;
+    }
+
+    // A predicted crossing closer than the ladder step shortens it; a distant
+    // one stretches it once the ladder has reached its top step (a long
+    // stable run, with the trend history full). Only from a settled level,
+    // so a trend taken mid-debounce or during an alert is ignored
+    uint32_t eta_sec = level_predict_seconds_to_threshold();
+    if (eta_sec != LEVEL_PREDICT_NONE && level_is_stable() && !alerting() &&
+        level_get_current() != WaterLevel::ERROR) {
+        uint32_t half = eta_sec / 2;
+        if (half < MIN_WAKE_SEC) {
+            half = MIN_WAKE_SEC;
+        } else if (half > MAX_PREDICTED_WAKE_SEC) {
+            half = MAX_PREDICTED_WAKE_SEC;
+        }
+        if (half < wake_sec || wake_interval_step == NUM_WAKE_INTERVALS - 1) {
+            wake_sec = (uint16_t)half;
+        }
+    }
+
+    return wake_sec;
+}
+
+/**
+ * Next measurement interval, stretched by the energy governor
+ */
+static uint16_t next_measure_interval() {
+    uint16_t wake_sec = update_wake_interval();
+    if constexpr (features::ENERGY_GOVERNOR) {
+        wake_sec <<= governor_policy().interval_shift;
+    }
+    return wake_sec;
+}
+
+/**
+ * Measure VDD if a check is due and apply the governor's tier
+ *
+ * Call with VDD_SW just up and nothing else drawing (no beep).
+ */
+static void energy_check(uint32_t tick) {
+    if constexpr (features::ENERGY_GOVERNOR) {
+        if (!governor_check_due(tick) || !governor_update(power_measure_vdd(), tick)) {
+            return;
+        }
+        const EnergyPolicy& policy = governor_policy();
+        if constexpr (features::ALERT_WINDOWS) {
+            alert_set_limits(policy.cadence_shift, policy.max_pattern);
+        }
+        level_set_debounce(policy.debounce_samples);
+        if constexpr (features::CONFIG) {
+            eeprom_log_event(NvmEvent::ENERGY_TIER, static_cast<uint8_t>(governor_tier()), tick);
+        }
+    } else {
+        (void)tick;
+    }
+}
+
+/**
+ * Save a due baseline drift step and apply it (rail may be off: EEPROM only)
+ */
+static void baseline_check(uint32_t tick) {
+    if constexpr (features::BASELINE_TRACK) {
+        int16_t base_ff[FDC_NUM_CHANNELS];
+        uint16_t drift_steps;
+        if (!sched_tick_reached(next_baseline_save_tick, tick) ||
+            !level_baseline_drift(base_ff, &drift_steps)) {
+            return;
+        }
+        next_baseline_save_tick = tick + BASELINE_SAVE_SEC;
+        if (eeprom_update_baseline(base_ff[0], base_ff[1], base_ff[2], drift_steps)) {
+            level_set_config(eeprom_config());
+        }
+    } else {
+        (void)tick;
+    }
+}
+
+// Calibration: a CIN4 reference above CAL_REF_MAX_FF is moved down with
+// the CAPDAC (headroom below the ±15 pF full scale), re-measuring up to
+// CAL_CAPDAC_PASSES times
+constexpr int16_t CAL_REF_MAX_FF = 5000;
+constexpr uint8_t CAL_CAPDAC_PASSES = 3;
+
+/**
+ * Average 8 samples per channel (reduced from 16 for flash savings)
+ *
+ * @return false if fewer than half the samples were valid
+ */
+static bool calibration_average(int16_t avg_ff[FDC_NUM_READINGS]) {
     constexpr uint8_t NUM_SAMPLES = 8;
-    int32_t sum_c1 = 0, sum_c2 = 0, sum_c3 = 0;
+    int32_t sum[FDC_NUM_READINGS] = {};
     uint8_t valid_samples = 0;
 
     // Take multiple samples
     for (uint8_t i = 0; i < NUM_SAMPLES; i++) {
-        FdcReading r1 = fdc_measure(FdcChannel::C1, 20);
-        FdcReading r2 = fdc_measure(FdcChannel::C2, 20);
-        FdcReading r3 = fdc_measure(FdcChannel::C3, 20);
-
-        if (r1.valid && r2.valid && r3.valid) {
-            sum_c1 += r1.capacitance_ff;
-            sum_c2 += r2.capacitance_ff;
-            sum_c3 += r3.capacitance_ff;
+        FdcReading r[FDC_NUM_READINGS];
+
+        if (fdc_measure_all(r)) {
+            for (uint8_t ch = 0; ch < FDC_NUM_READINGS; ch++) {
+                sum[ch] += r[ch].raw;
+            }
             valid_samples++;
         }
 
@@ -88,127 +286,438 @@ static bool perform_calibration() {
         return false;
     }
 
-    // Calculate averages
-    int16_t avg_c1 = sum_c1 / valid_samples;
-    int16_t avg_c2 = sum_c2 / valid_samples;
-    int16_t avg_c3 = sum_c3 / valid_samples;
-
-    // Save to EEPROM
-    bool success = eeprom_update_calibration(avg_c1, avg_c2, avg_c3);
-
-    // Beep feedback: 2 beeps = success, 5 beeps = failed
-    if (success) {
-        buzzer_start(BeepPattern::DOUBLE);  // 2 beeps = success
-    } else {
-        buzzer_start(BeepPattern::FIVE);    // 5 beeps = failed
-    }
-
-    // Wait for beep to complete
-    while (buzzer_is_active()) {
-        buzzer_update();
-        delay_ms(1);
+    // Calculate averages (baseline is stored in fF)
+    for (uint8_t ch = 0; ch < FDC_NUM_READINGS; ch++) {
+        avg_ff[ch] = fdc_raw_to_ff(sum[ch] / valid_samples);
     }
-
-    return success;
+    return true;
 }
 
 /**
- * Check for factory reset on boot (5-second button hold)
+ * Calibration mode: Learn baseline (and the reference CAPDAC) with tank full
  */
-static void check_factory_reset() {
-    if (button_is_pressed()) {
-        // Button pressed on boot, wait to see if held for 5 seconds
-        for (uint8_t i = 0; i < 50; i++) {  // 50 × 100ms = 5 seconds
-            if (!button_is_pressed()) {
-                return;  // Released before 5 seconds
-            }
-            delay_ms(100);
+static bool perform_calibration() {
+    // Piezo resonance first (the sweep is audible and draws the most
+    // current; nothing else runs meanwhile). No peak: keep the old one.
+    uint16_t buzzer_per = buzzer_tune();
+    if (buzzer_per != 0 && buzzer_per != eeprom_config().buzzer_per) {
+        eeprom_update_buzzer_period(buzzer_per);
+    }
+
+    // Baseline, starting without offset; save once the reference needs no
+    // (more) CAPDAC and is plausible (electrode connected)
+    uint8_t ref_capdac = 0;
+    int16_t avg_ff[FDC_NUM_READINGS];
+    bool success = false;
+    for (uint8_t pass = 0; pass < CAL_CAPDAC_PASSES; pass++) {
+        fdc_set_ref_capdac(ref_capdac);
+        if (!fdc_init() || !calibration_average(avg_ff)) {
+            break;
         }
 
-        // Button held for 5 seconds, perform factory reset
-        eeprom_factory_reset();
-        delay_ms(1000);  // Give user time to release button
+        int16_t ref_ff = avg_ff[FDC_REF];
+        if (ref_ff > CAL_REF_MAX_FF && ref_capdac < FDC_CAPDAC_MAX) {
+            uint16_t steps = (ref_ff - CAL_REF_MAX_FF + FDC_CAPDAC_STEP_FF - 1) / FDC_CAPDAC_STEP_FF;
+            ref_capdac = (ref_capdac + steps > FDC_CAPDAC_MAX) ? FDC_CAPDAC_MAX : ref_capdac + steps;
+            continue;
+        }
+        if ((int32_t)ref_ff + (int32_t)ref_capdac * FDC_CAPDAC_STEP_FF >= LEVEL_REF_MIN_FF) {
+            success = eeprom_update_calibration(avg_ff[0], avg_ff[1], avg_ff[2], ref_capdac);
+        }
+        break;
     }
+
+    // Apply the new baseline and offsets, or go back to the saved ones
+    level_set_config(eeprom_config());
+
+    // Beep feedback: low-high chirp = saved, long low tone = failed
+    buzzer_start(success ? BeepPattern::CAL_OK : BeepPattern::CAL_FAIL);
+
+    // Wait for beep to complete (IDLE sleep between phase edges)
+    buzzer_wait();
+
+    return success;
 }
 
 /**
  * Initialize all peripherals and modules
  */
 static void system_init() {
+    // Reset cause first: a warm reset resumes the saved level and alert
+    bool warm = false;
+    if constexpr (features::WARM_START) {
+        warm = warm_check();
+    }
+
     // Initialize power management
     power_init();
 
-    // Check for factory reset (no LED indication to save flash)
-    check_factory_reset();
-
-    // Initialize button
-    button_init();
-
-    // Initialize RTC for 10-second wakes
+    // Initialize RTC (seconds time base + scheduled wakeups)
     rtc_init();
+    sched_init();
+
+    // Initialize button (edge timestamps need the RTC; a button already
+    // held here is reported as BOOT_HOLD when released after 5 s, unless
+    // it was held through a warm reset)
+    if constexpr (features::BUTTON) {
+        button_init(!warm);
+    }
 
     // Initialize EEPROM config
-    eeprom_init();
+    if constexpr (features::CONFIG) {
+        eeprom_init();
+    }
 
-    // Load configuration
-    NvmConfig config;
-    eeprom_get_config(&config);
+    // Instrumentation counters (lifetime totals come from the journal)
+    stats_init();
 
-    // Initialize level logic with loaded config
-    LevelThresholds thresholds = {
-        .low_ff = (int16_t)config.th_low_ff,
-        .vlow_ff = (int16_t)config.th_vlow_ff,
-        .crit_ff = (int16_t)config.th_crit_ff,
-        .hysteresis_pct = (uint8_t)config.hysteresis_pct
-    };
+    // Initialize level logic from the config view
+    level_init(active_config());
 
-    CalibrationData calibration = {
-        .base_c1_ff = config.base_c1_ff,
-        .base_c2_ff = config.base_c2_ff,
-        .base_c3_ff = config.base_c3_ff,
-        .valid = (config.calibration_valid != 0)
-    };
+    // Initialize alert manager
+    if constexpr (features::ALERT_WINDOWS) {
+        alert_init();
+    }
 
-    level_init(thresholds, calibration);
+    // Warm reset: confirmed level and alert window as before it
+    if constexpr (features::WARM_START) {
+        if (warm) {
+            warm_restore(rtc_get_ticks());
+        }
+    }
 
-    // Initialize alert manager
-    alert_init();
+    // Energy governor (first VDD check at the first measurement)
+    if constexpr (features::ENERGY_GOVERNOR) {
+        governor_init(rtc_get_ticks());
+    }
 
-    // Initialize buzzer
-    buzzer_init();
+    // Initialize buzzer (tuned period from calibration mode, if any)
+    buzzer_init(active_config().buzzer_per);
 
     // Enable global interrupts
     sei();
 }
 
 /**
- * Perform measurement cycle
+ * Switch VDD_SW on (if off) and bring up TWI and the FDC1004
+ *
+ * A rail switched on here also takes a due VDD check once the FDC1004
+ * answers (rail settled, cell lightly loaded).
+ *
+ * @return false if the FDC1004 did not respond (after recovery)
  */
-static void measurement_cycle() {
-    // Enable peripherals (VDD_SW on)
-    power_enable_peripherals();
-
-    // Initialize TWI
+static bool sensor_init(uint32_t tick) {
+    bool rail_was_on = power_peripherals_enabled();
+    if (!rail_was_on) {
+        power_enable_peripherals();
+    }
     twi_init();
+    // fdc_init() frees a stuck bus itself; a device that answers but fails
+    // its setup gets one soft reset before the cycle is given up
+    if (!fdc_init() && !fdc_soft_reset()) {
+        return false;
+    }
+    if (!rail_was_on) {
+        energy_check(tick);
+    }
+    return true;
+}
+
+// Boot capture (BOOT_CAPTURE): a dry conversion set at power-up, a wet one
+// BOOT_CAPTURE_WET_MS later (electrodes covered meanwhile); each channel
+// then trips midway between its two readings
+constexpr uint16_t BOOT_CAPTURE_WET_MS = 3000;
+constexpr int16_t BOOT_CAPTURE_MIN_SPAN_FF = 200;  // Less wet - dry: electrode not covered
 
-    // Initialize FDC1004
-    if (!fdc_init()) {
-        // FDC1004 init failed - skip this cycle
+/**
+ * Capture dry and wet readings and set the trip points (RAM only)
+ *
+ * A CAPTURE_OK blip starts each capture. Unless every channel reads at least
+ * BOOT_CAPTURE_MIN_SPAN_FF more wet than dry, the factory thresholds stay.
+ * Beep feedback as in calibration mode.
+ */
+static void boot_capture() {
+    if constexpr (features::BOOT_CAPTURE) {
+        FdcReading dry[FDC_NUM_READINGS] = {};
+        FdcReading wet[FDC_NUM_READINGS] = {};
+        bool ok = sensor_init(rtc_get_ticks());
+
+        buzzer_start(BeepPattern::CAPTURE_OK);  // Blip: dry set next
+        buzzer_wait();
+        ok = ok && fdc_measure_all(dry);
+
+        if (!power_sleep_ms(BOOT_CAPTURE_WET_MS)) {
+            delay_ms(BOOT_CAPTURE_WET_MS);
+        }
+        buzzer_start(BeepPattern::CAPTURE_OK);  // Blip: wet set next
+        buzzer_wait();
+        ok = ok && fdc_measure_all(wet);
+
+        // As a calibration: the wet reading is the baseline and half the
+        // span the threshold (trip = baseline - threshold)
+        int16_t base_ff[FDC_NUM_CHANNELS];
+        uint16_t th_ff[FDC_NUM_CHANNELS];
+        for (uint8_t ch = 0; ch < FDC_NUM_CHANNELS; ch++) {
+            base_ff[ch] = fdc_raw_to_ff(wet[ch].raw);
+            int16_t span_ff = base_ff[ch] - fdc_raw_to_ff(dry[ch].raw);
+            ok = ok && span_ff >= BOOT_CAPTURE_MIN_SPAN_FF;
+            th_ff[ch] = span_ff / 2;
+        }
+        if (ok) {
+            NvmConfig config = FACTORY_DEFAULTS;
+            config.th_low_ff = th_ff[0];
+            config.th_vlow_ff = th_ff[1];
+            config.th_crit_ff = th_ff[2];
+            config.base_c1_ff = base_ff[0];
+            config.base_c2_ff = base_ff[1];
+            config.base_c3_ff = base_ff[2];
+            config.calibration_valid = 1;
+            level_set_config(config);
+        }
+
+        buzzer_start(ok ? BeepPattern::CAL_OK : BeepPattern::CAL_FAIL);
+        buzzer_wait();
+        power_disable_peripherals();
+    }
+}
+
+/**
+ * Journal a level change and update the alert state
+ */
+static void level_changed(WaterLevel old_level, WaterLevel new_level, uint32_t tick) {
+    if (new_level != old_level) {
+        log_event(NvmEvent::LEVEL_CHANGE, new_level, tick);
+        error_buzz_due = false;
+        if (new_level == WaterLevel::ERROR && sched_tick_reached(next_error_buzz_tick, tick)) {
+            error_buzz_due = true;
+            next_error_buzz_tick = tick + ERROR_BUZZ_SEC;
+        }
+        if constexpr (features::ALERT_WINDOWS) {
+            if (new_level != WaterLevel::ERROR) {
+                alert_on_level_change(new_level);
+            }
+        } else {
+            // Worse: (re)start the window; better or sensor error: stop
+            uint8_t was = (old_level == WaterLevel::ERROR) ? 0 : static_cast<uint8_t>(old_level);
+            simple_alert.active = new_level != WaterLevel::ERROR &&
+                                  static_cast<uint8_t>(new_level) > was;
+            simple_alert.end_tick = tick + SIMPLE_ALERT_SEC;
+        }
+    }
+}
+
+/**
+ * Perform measurement cycle
+ */
+static void measurement_cycle(uint32_t tick) {
+    // VDD_SW on, TWI and FDC1004 up
+    if (!sensor_init(tick)) {
+        // FDC1004 init failed after recovery - skip this cycle
         power_disable_peripherals();
         return;
     }
 
     // Perform level measurement
     WaterLevel old_level = level_get_current();
-    WaterLevel new_level = level_update();
+    level_changed(old_level, level_update(tick), tick);
 
-    // Check if level changed
-    if (new_level != old_level && new_level != WaterLevel::ERROR) {
-        alert_on_level_change(new_level);
+    // Peripherals stay up in case an alert is about to beep; the main loop
+    // powers them down
+}
+
+/**
+ * Check whether an alert burst (or window expiry) is due
+ */
+static bool alert_burst_due(uint32_t tick) {
+    if constexpr (features::ALERT_WINDOWS) {
+        return alert_is_active() && sched_tick_reached(alert_next_event_tick(), tick);
+    } else {
+        (void)tick;
+        return false;
     }
+}
 
-    // Disable TWI and power down peripherals (unless alert is about to beep)
-    // We'll check alert status after this
+/**
+ * Switch VDD_SW on for the DRV8210 if the measurement left it off
+ */
+static void power_for_buzzer() {
+    if (!power_peripherals_enabled()) {
+        power_enable_peripherals();
+        delay_ms(1);  // TPS22860 rise time
+    }
+}
+
+/**
+ * Sleep through a started burst, measuring the level in its gaps
+ *
+ * The FDC1004 is brought up during the first beep. A conversion set is
+ * triggered at the start of each gap long enough to hold it (first sample,
+ * then more while the level is settling) and collected before the next
+ * beep, so no conversion runs while the piezo is driven and the
+ * measurement costs no rail time beyond the burst.
+ *
+ * @param tick Current tick
+ * @param measure Sample the level (false: just play the burst)
+ * @return true if the level was sampled
+ */
+static bool play_burst(uint32_t tick, bool measure) {
+    WaterLevel old_level = level_get_current();
+    bool sensor = measure && sensor_init(tick);
+    bool converting = false;
+    uint8_t samples = 0;
+
+    // The buzzer interrupt sequences the beeps and wakes us at each phase
+    // edge; a button press (pin change) also wakes us
+    while (buzzer_is_active()) {
+        buzzer_sleep();
+
+        // Check button during beep
+        if constexpr (features::BUTTON) {
+            if (button_is_pressed()) {
+                alert_silence();
+                buzzer_stop();
+                break;
+            }
+        }
+
+        if (!sensor) {
+            continue;
+        }
+
+        bool ok = true;
+        if (converting) {
+            bool done = false;
+            ok = fdc_poll_ready(&done);
+            if (ok && done) {
+                FdcReading r[FDC_NUM_READINGS];
+                converting = false;
+                // A partial result still counts; no more conversions on a
+                // bus that just lost a channel
+                sensor = fdc_read_all(r);
+                level_add_sample(tick, r, true, samples == 0);
+                samples++;
+            }
+        } else if ((samples == 0 || level_is_settling()) &&
+                   buzzer_gap_left_ms() >= FDC_MEASURE_ALL_MS) {
+            ok = converting = fdc_trigger_all();
+        }
+
+        if (!ok) {
+            // Sensor error: no more conversions this wake
+            level_add_sample(tick, nullptr, false, samples == 0);
+            samples++;
+            sensor = false;
+            converting = false;
+        }
+    }
+
+    // Burst cut short with a conversion in flight: collect it now
+    if (converting) {
+        FdcReading r[FDC_NUM_READINGS] = {};
+        if (fdc_wait_ready(FDC_MEASURE_ALL_TIMEOUT_MS)) {
+            fdc_read_all(r);
+        }
+        level_add_sample(tick, r, true, samples == 0);
+        samples++;
+    }
+
+    if (samples == 0) {
+        return false;
+    }
+
+    // Too few gaps to settle a pending change: finish while the rail is up
+    level_changed(old_level, level_settle(tick), tick);
+    return true;
+}
+
+/**
+ * Play the alert burst if one is due
+ *
+ * Runs right after a level change starts a window, and on ALERT_BURST
+ * wakes without a measurement. Reschedules the next burst.
+ *
+ * Without ALERT_WINDOWS every wake is a measurement: the level's pattern
+ * plays once per wake until the window ends.
+ *
+ * @param tick Current tick
+ * @param measure Sample the level in the burst's gaps
+ * @return true if the level was sampled
+ */
+static bool alert_cycle(uint32_t tick, bool measure) {
+    trace_phase(TracePhase::ALERT_EVAL);
+
+    if constexpr (!features::ALERT_WINDOWS) {
+        static const BeepPattern LEVEL_PATTERNS[] = {
+            BeepPattern::NONE, BeepPattern::DOUBLE, BeepPattern::TRIPLE, BeepPattern::FIVE
+        };
+        if (simple_alert.active && sched_tick_reached(simple_alert.end_tick, tick)) {
+            simple_alert.active = false;
+        }
+
+        if (simple_alert.active) {
+            BeepPattern pattern = LEVEL_PATTERNS[static_cast<uint8_t>(level_get_current())];
+            if constexpr (features::ENERGY_GOVERNOR) {
+                if (pattern > governor_policy().max_pattern) {
+                    pattern = governor_policy().max_pattern;
+                }
+            }
+            power_for_buzzer();
+            buzzer_start(pattern);
+            buzzer_wait();
+        }
+        (void)measure;
+        return false;
+    } else {
+        bool sampled = false;
+        sched_cancel(SchedEvent::ALERT_BURST);
+
+        // A level change in the gaps can start a new window: its first
+        // burst plays right away (no more sampling)
+        while (alert_burst_due(tick)) {
+            power_for_buzzer();
+
+            if (!alert_update(tick)) {
+                break;  // Window expired
+            }
+            if constexpr (features::WARM_START) {
+                warm_save(tick, false);  // The burst may brown out the cell
+            }
+            sampled |= play_burst(tick, measure && !sampled);
+        }
+
+        if (alert_is_active()) {
+            sched_at(SchedEvent::ALERT_BURST, alert_next_event_tick());
+        }
+        return sampled;
+    }
+}
+
+/**
+ * Handle a classified button event
+ *
+ * Long press requests calibration, short press silences, a 5 s hold from
+ * power-up restores factory defaults.
+ */
+static void button_cycle(uint32_t tick) {
+    ButtonEvent btn_event = button_check();
+
+    if (btn_event == ButtonEvent::BOOT_HOLD) {
+        if constexpr (features::CONFIG) {
+            eeprom_factory_reset();
+            level_set_config(eeprom_config());
+        }
+    } else if (btn_event == ButtonEvent::LONG_PRESS) {
+        if constexpr (features::CALIBRATION) {
+            sched_at(SchedEvent::CALIBRATION, tick);
+        }
+    } else if (btn_event == ButtonEvent::SHORT_PRESS) {
+        if constexpr (features::ALERT_WINDOWS) {
+            if (alert_is_active()) {
+                log_event(NvmEvent::ALERT_SILENCED, level_get_current(), tick);
+            }
+            alert_silence();
+        }
+    }
 }
 
 /**
@@ -218,56 +727,89 @@ int main(void) {
     // Initialize system
     system_init();
 
+    // No config: trip points from a dry / wet capture
+    boot_capture();
+
+    // First measurement right away
+    sched_at(SchedEvent::MEASURE, rtc_get_ticks());
+
     // Main loop
     while (1) {
-        // Get current tick count
+        // Get current tick count (seconds)
         uint32_t current_tick = rtc_get_ticks();
 
-        // Perform measurement cycle
-        measurement_cycle();
-
-        // Update alert manager
-        bool alert_active = alert_update(current_tick);
-
-        // If alert is active, keep VDD_SW on and update buzzer
-        if (alert_active) {
-            // Keep buzzer updated (1ms granularity for timing)
-            uint16_t timeout = 0;
-            while (buzzer_is_active() && timeout < 2000) {  // Max 2 second beep sequence
-                buzzer_update();
-                delay_ms(1);
-                timeout++;
-
-                // Check button during beep
-                if (button_is_pressed()) {
-                    alert_silence();
-                    buzzer_stop();
-                    break;
-                }
+        // Check button
+        if constexpr (features::BUTTON) {
+            button_cycle(current_tick);
+        }
+
+        // Perform measurement cycle if due (a due burst measures in its
+        // gaps instead)
+        bool measure = sched_take(SchedEvent::MEASURE, current_tick);
+        bool measured = measure && !alert_burst_due(current_tick);
+        if (measured) {
+            measurement_cycle(current_tick);
+        }
+
+        // Beep if a burst is due; while alerting every burst also samples
+        // the level, so the next separate measurement moves back
+        if (alert_cycle(current_tick, !measured)) {
+            measured = true;
+        } else if (measure && !measured) {
+            measurement_cycle(current_tick);  // Burst gave no sample
+            measured = true;
+        }
+        if (measured) {
+            sched_at(SchedEvent::MEASURE, current_tick + next_measure_interval());
+        }
+
+        // Low-battery chirp, with the rail still up from the measurement
+        if constexpr (features::ENERGY_GOVERNOR) {
+            if (measured && !alerting() && governor_chirp_due(current_tick)) {
+                power_for_buzzer();
+                buzzer_start(BeepPattern::LOW_BATTERY);
+                buzzer_wait();
             }
         }
 
+        // Sensor fault: a single buzz when the level goes to ERROR
+        if (error_buzz_due) {
+            error_buzz_due = false;
+            power_for_buzzer();
+            buzzer_start(BeepPattern::SENSOR_ERROR);
+            buzzer_wait();
+        }
+
         // Power down peripherals
         power_disable_peripherals();
 
-        // Check button for calibration request
-        ButtonEvent btn_event = button_check();
-        if (btn_event == ButtonEvent::LONG_PRESS) {
-            // Enter calibration mode
-            power_enable_peripherals();
-            twi_init();
-            fdc_init();
-            perform_calibration();
-            power_disable_peripherals();
-        } else if (btn_event == ButtonEvent::SHORT_PRESS) {
-            // Silence alert
-            alert_silence();
+        // Baseline drift step from the readings just taken
+        if (measured) {
+            baseline_check(current_tick);
         }
 
-        // Enter sleep mode
+        // Calibration mode
+        if constexpr (features::CALIBRATION) {
+            if (sched_take(SchedEvent::CALIBRATION, current_tick)) {
+                power_enable_peripherals();
+                twi_init();
+                fdc_init();
+                perform_calibration();
+                power_disable_peripherals();
+            }
+        }
+
+        // Enter sleep mode until the next event (or button)
+        if constexpr (features::WARM_START) {
+            warm_save(current_tick, true);
+        }
+        stats_wake_end(current_tick);
+        sched_arm();
         power_sleep();
 
         // Wake up here (RTC or button)
+        stats_wake_begin();
+        power_clear_wake_source();
         // Loop continues...
     }
 
@@ -95,11 +95,8 @@ static void beep_for_level(uint8_t level) {
 
     buzzer_start(pattern);
 
-    // Update buzzer (blocking)
-    while (buzzer_is_active()) {
-        buzzer_update();
-        _delay_ms(1);
-    }
+    // Wait for pattern (blocking, IDLE sleep between phase edges)
+    buzzer_wait();
 }
 
 /**
@@ -178,7 +175,9 @@ int main(void) {
         }
 
         // Sleep until next wake (10 seconds)
+        rtc_set_wakeup_tick(rtc_get_ticks() + RTC_DEFAULT_WAKE_SEC);
         power_sleep();
+        power_clear_wake_source();
     }
 
     return 0;
@@ -5,6 +5,10 @@
 
 #include "power.h"
 #include "pins.hpp"
+#include "rtc.h"
+#include "fdc1004.h"
+#include "stats.h"
+#include "trace.h"
 #include <avr/io.h>
 #include <avr/sleep.h>
 #include <avr/interrupt.h>
@@ -13,6 +17,11 @@
 // Wake source tracking
 static volatile uint8_t wake_sources = 0;
 
+// Internal reference start-up time before the first conversion
+constexpr uint8_t VREF_STARTUP_US = 25;
+
+static_assert(POWER_SUPPLY_SAMPLES == 64, "ADC0.CTRLB accumulation below assumes 64 samples");
+
 void power_init() {
     // Configure PWR_EN (PA1) as output, initially LOW
     PORTA.DIRSET = pins::PWR_EN;
@@ -34,13 +43,20 @@ void power_init() {
 void power_enable_peripherals() {
     // Set PWR_EN HIGH to enable VDD_SW
     PORTA.OUTSET = pins::PWR_EN;
+    trace_phase(TracePhase::RAIL_UP);
+    stats_rail_on();
 
-    // Wait for VDD_SW to stabilize and FDC1004/DRV8210 to power up
-    // TPS22860 rise time ~1ms, add margin for peripheral startup
-    _delay_ms(5);
+    // No fixed settle delay: fdc_init() polls the FDC1004 for its first ACK
+    // (bounded), which also covers the TPS22860 rise time for the DRV8210
+}
+
+bool power_peripherals_enabled() {
+    return (PORTA.OUT & pins::PWR_EN) != 0;
 }
 
 void power_disable_peripherals() {
+    trace_phase(TracePhase::RAIL_DOWN);
+
     // CRITICAL: Disable TWI peripheral first
     TWI0.MCTRLA = 0;  // Disable master mode
 
@@ -52,19 +68,84 @@ void power_disable_peripherals() {
 
     // Now safe to disable VDD_SW
     PORTA.OUTCLR = pins::PWR_EN;
+    stats_rail_off();
+
+    // FDC1004 loses its register pointer with the rail
+    fdc_invalidate_pointer();
+}
+
+uint16_t power_measure_supply() {
+    // 1.1 V reference as the input, VDD as the reference (ADC clock
+    // F_CPU / 16: 625 kHz at 10 MHz, 1.25 MHz at 20 MHz)
+    VREF.CTRLA = VREF_ADC0REFSEL_1V1_gc;
+    VREF.CTRLB = VREF_ADC0REFEN_bm;
+    ADC0.CTRLB = ADC_SAMPNUM_ACC64_gc;
+    ADC0.CTRLC = ADC_SAMPCAP_bm | ADC_REFSEL_VDDREF_gc | ADC_PRESC_DIV16_gc;
+    ADC0.CTRLD = ADC_INITDLY_DLY16_gc;
+    ADC0.MUXPOS = ADC_MUXPOS_INTREF_gc;
+    ADC0.CTRLA = ADC_RESSEL_10BIT_gc | ADC_ENABLE_bm;
+    _delay_us(VREF_STARTUP_US);
+
+    ADC0.INTFLAGS = ADC_RESRDY_bm;
+    ADC0.COMMAND = ADC_STCONV_bm;
+    while (!(ADC0.INTFLAGS & ADC_RESRDY_bm)) {
+    }
+    uint16_t result = ADC0.RES;
+
+    // ADC0 and the forced reference draw current in STANDBY otherwise
+    ADC0.CTRLA = 0;
+    VREF.CTRLB = 0;
+    return result;
+}
+
+uint16_t power_measure_vdd() {
+    uint16_t result = power_measure_supply();
+    if (result == 0) {
+        return 0xFFFF;  // Reference not seen: treat as a full cell
+    }
+    return (uint16_t)((uint32_t)POWER_SUPPLY_SAMPLES * 1023 * 1100 / result);
 }
 
 void power_sleep() {
+    trace_phase(TracePhase::SLEEP);
+
+    // Sleep until a wake source is flagged
+    // RTC overflows in between (every 64 s) wake the CPU only for the ISR
+    for (;;) {
+        cli();
+        if (wake_sources) {
+            break;
+        }
+        sei();
+        sleep_cpu();
+    }
+
     // Ensure interrupts are enabled
     sei();
 
-    // Enter sleep mode
-    // CPU stops here until interrupt occurs
-    sleep_cpu();
-
     // Woke up - execution continues here
 }
 
+bool power_sleep_ms(uint16_t ms) {
+    if (!rtc_start_wakeup(ms)) {
+        return false;
+    }
+
+    for (;;) {
+        cli();
+        if (rtc_wakeup_expired()) {
+            break;
+        }
+        // sei() takes effect after the next instruction, so a wakeup
+        // firing between the check and sleep_cpu() can't be missed
+        sei();
+        sleep_cpu();
+    }
+    sei();
+
+    return true;
+}
+
 uint8_t power_get_wake_source() {
     return wake_sources;
 }
@@ -77,10 +158,14 @@ void power_clear_wake_source() {
 // These will be defined by rtc.cpp and button.cpp
 // but we provide weak symbols here for linker
 
-void __attribute__((weak)) RTC_PIT_vect_impl() {
+void __attribute__((weak)) RTC_CNT_vect_impl() {
     wake_sources |= WAKE_RTC;
 }
 
 void __attribute__((weak)) PORTA_PORT_vect_impl() {
     wake_sources |= WAKE_BUTTON;
 }
+
+// Weak default for builds without the FDC1004 driver (test bench)
+void __attribute__((weak)) fdc_invalidate_pointer() {
+}
@@ -1,6 +1,6 @@
 /**
  * @file rtc.cpp
- * @brief RTC/PIT implementation for 10-second wake timer
+ * @brief RTC counter implementation for the tickless wake timer
  */
 
 #include "rtc.h"
@@ -9,10 +9,84 @@
 #include <avr/interrupt.h>
 
 // Forward declaration for power module wake source notification
-extern void RTC_PIT_vect_impl();
+extern void RTC_CNT_vect_impl();
 
-// Tick counter (increments every 10 seconds)
-static volatile uint32_t tick_counter = 0;
+// RTC counter clock: 32.768 kHz / 32 = 1024 counts per second
+// PER = 0xFFFF, so the counter overflows every 64 seconds
+constexpr uint8_t COUNTS_PER_SEC_SHIFT = 10;  // 1024 counts
+static_assert((1u << COUNTS_PER_SEC_SHIFT) == RTC_COUNTS_PER_SEC, "RTC prescaler mismatch");
+constexpr uint8_t SEC_PER_OVF = 64;
+
+// Overflow counter (increments every 64 seconds)
+static volatile uint32_t ovf_counter = 0;
+
+// Scheduled wakeup (seconds since boot)
+static volatile uint32_t wake_tick = 0;
+static volatile bool wake_armed = false;
+
+// One-shot wakeup in progress (shares the compare channel with wake_tick)
+static volatile bool oneshot_active = false;
+
+// Set by the compare ISR when the one-shot wakeup fires
+static volatile bool wakeup_expired = true;
+
+// Minimum compare distance so CMP sync (~2 RTC cycles) can't miss the match
+constexpr uint16_t WAKEUP_MIN_COUNTS = 3;
+
+static void write_cmp(uint16_t value) {
+    while (RTC.STATUS & RTC_CMPBUSY_bm);
+    RTC.CMP = value;
+    RTC.INTFLAGS = RTC_CMP_bm;
+}
+
+// Overflow count and counter value (interrupts disabled or ISR context)
+static uint32_t ovf_locked(uint16_t& cnt) {
+    cnt = RTC.CNT;
+    uint32_t ovf = ovf_counter;
+
+    // Overflow happened but its interrupt hasn't been serviced yet
+    if ((RTC.INTFLAGS & RTC_OVF_bm) && cnt < 0x8000) {
+        ovf++;
+    }
+
+    return ovf;
+}
+
+// Current time in seconds (interrupts disabled or ISR context)
+static uint32_t ticks_locked() {
+    uint16_t cnt;
+    uint32_t ovf = ovf_locked(cnt);
+    return ovf * SEC_PER_OVF + (cnt >> COUNTS_PER_SEC_SHIFT);
+}
+
+// Program the compare channel for wake_tick if it falls in the current
+// 64 s overflow period; otherwise the overflow ISR re-evaluates
+// (interrupts disabled or ISR context)
+static void arm_wake_locked() {
+    if (oneshot_active) {
+        return;  // Re-armed when the one-shot fires
+    }
+
+    RTC.INTCTRL = RTC_OVF_bm;
+    if (!wake_armed) {
+        return;
+    }
+
+    uint32_t now = ticks_locked();
+    if ((int32_t)(wake_tick - now) <= 0) {
+        // Already due
+        wake_armed = false;
+        RTC_CNT_vect_impl();
+        return;
+    }
+
+    if ((wake_tick / SEC_PER_OVF) == (now / SEC_PER_OVF)) {
+        // Wake a few counts after the second boundary (never early)
+        uint16_t counts = (uint16_t)((wake_tick % SEC_PER_OVF) << COUNTS_PER_SEC_SHIFT);
+        write_cmp(counts + WAKEUP_MIN_COUNTS);
+        RTC.INTCTRL = RTC_OVF_bm | RTC_CMP_bm;
+    }
+}
 
 void rtc_init() {
     // Wait for all RTC registers to be ready
@@ -21,59 +95,93 @@ void rtc_init() {
     // Select 32.768 kHz internal ULP oscillator
     RTC.CLKSEL = RTC_CLKSEL_INT32K_gc;
 
-    // Configure PIT for 10-second period
-    // PIT period options on ATtiny202:
-    // - RTC_PERIOD_CYC32768_gc = 1 second @ 32.768 kHz
-    // - Need 10 seconds, so we'll use RTC_PERIOD_CYC32768_gc and count in ISR
-    // OR use longer period if available
-    //
-    // For 10 seconds with 32.768 kHz clock:
-    // Closest available: RTC_PERIOD_CYC16384_gc = 0.5s
-    // or RTC_PERIOD_CYC32768_gc = 1s
-    //
-    // Let's use 1-second period and count 10 ticks in ISR
-    // Or better: check datasheet for longer periods
-    //
-    // ATtiny202 PIT periods (at 32.768 kHz):
-    // CYC4_gc = 122 us
-    // CYC8_gc = 244 us
-    // ...
-    // CYC256_gc = 7.8 ms
-    // CYC512_gc = 15.6 ms
-    // CYC1024_gc = 31.2 ms
-    // CYC2048_gc = 62.5 ms
-    // CYC4096_gc = 125 ms
-    // CYC8192_gc = 250 ms
-    // CYC16384_gc = 500 ms
-    // CYC32768_gc = 1 second
-    //
-    // Use 1 second and count 10 in ISR
-    RTC.PITCTRLA = RTC_PERIOD_CYC32768_gc | RTC_PITEN_bm;
-
-    // Enable PIT interrupt
-    RTC.PITINTCTRL = RTC_PI_bm;
-
-    // Start RTC (just for PIT, we're not using RTC counter itself)
-    // PIT runs independently
+    // PIT not used: the counter provides both time base and wakeups
+    RTC.PITINTCTRL = 0;
+    RTC.PITCTRLA = 0;
+
+    // Free-running RTC counter, overflow interrupt extends it to 32 bits
+    RTC.PER = 0xFFFF;
+    RTC.INTFLAGS = RTC_OVF_bm | RTC_CMP_bm;
+    RTC.INTCTRL = RTC_OVF_bm;
+    RTC.CTRLA = RTC_PRESCALER_DIV32_gc | RTC_RUNSTDBY_bm | RTC_RTCEN_bm;
 }
 
 uint32_t rtc_get_ticks() {
     uint32_t ticks;
-    // Atomic read of 32-bit counter
+    // Atomic read of counter + overflow count
     cli();
-    ticks = tick_counter;
+    ticks = ticks_locked();
     sei();
     return ticks;
 }
 
-// PIT interrupt service routine
-ISR(RTC_PIT_vect) {
-    // Clear interrupt flag
-    RTC.PITINTFLAGS = RTC_PI_bm;
+uint32_t rtc_get_counts_locked() {
+    uint16_t cnt;
+    uint32_t ovf = ovf_locked(cnt);
+    return (ovf << 16) | cnt;
+}
+
+uint32_t rtc_get_counts() {
+    uint32_t counts;
+    cli();
+    counts = rtc_get_counts_locked();
+    sei();
+    return counts;
+}
+
+void rtc_set_wakeup_tick(uint32_t tick) {
+    cli();
+    wake_tick = tick;
+    wake_armed = true;
+    arm_wake_locked();
+    sei();
+}
+
+bool rtc_start_wakeup(uint16_t ms) {
+    if (!(RTC.CTRLA & RTC_RTCEN_bm)) {
+        return false;  // rtc_init() not called (e.g. minimal build)
+    }
+
+    // 1 ms = 1.024 counts; add ~3% and one count so we never wake early,
+    // plus one for the part of the current count already elapsed
+    uint16_t counts = ms + (ms >> 5) + 2;
+    if (counts < WAKEUP_MIN_COUNTS) {
+        counts = WAKEUP_MIN_COUNTS;
+    }
+
+    cli();
+    oneshot_active = true;
+    wakeup_expired = false;
+    write_cmp(RTC.CNT + counts);  // Wraps with the counter
+    RTC.INTCTRL = RTC_OVF_bm | RTC_CMP_bm;
+    sei();
+    return true;
+}
+
+bool rtc_wakeup_expired() {
+    return wakeup_expired;
+}
+
+// RTC counter interrupt: overflow (time base) and compare (wakeups)
+ISR(RTC_CNT_vect) {
+    if (RTC.INTFLAGS & RTC_OVF_bm) {
+        RTC.INTFLAGS = RTC_OVF_bm;
+        ovf_counter++;
+        arm_wake_locked();  // Scheduled wake may fall in the new period
+    }
 
-    // Wake every 1 second
-    tick_counter++;
+    // Re-read: arming from the overflow clears a CMP flag left over from a
+    // match while the compare interrupt was off (it is not this wake)
+    if ((RTC.INTFLAGS & RTC_CMP_bm) && (RTC.INTCTRL & RTC_CMP_bm)) {
+        RTC.INTFLAGS = RTC_CMP_bm;
 
-    // Notify power module of wake source
-    RTC_PIT_vect_impl();
+        if (oneshot_active) {
+            oneshot_active = false;
+            wakeup_expired = true;
+        } else if (wake_armed) {
+            wake_armed = false;
+            RTC_CNT_vect_impl();  // Notify power module of wake source
+        }
+        arm_wake_locked();
+    }
 }
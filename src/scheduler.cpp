@@ -0,0 +1,62 @@
+/**
+ * @file scheduler.cpp
+ * @brief Deadline-based event scheduler implementation
+ */
+
+#include "scheduler.h"
+#include "rtc.h"
+
+constexpr uint8_t NUM_EVENTS = static_cast<uint8_t>(SchedEvent::COUNT);
+
+// Scheduler state
+struct SchedState {
+    uint32_t due[NUM_EVENTS];  // Deadline per event (seconds)
+    uint8_t pending;           // Bitmask of pending events
+};
+
+static SchedState state = {{0}, 0};
+
+void sched_init() {
+    state.pending = 0;
+}
+
+void sched_at(SchedEvent ev, uint32_t tick) {
+    uint8_t i = static_cast<uint8_t>(ev);
+    state.due[i] = tick;
+    state.pending |= (1 << i);
+}
+
+void sched_cancel(SchedEvent ev) {
+    state.pending &= ~(1 << static_cast<uint8_t>(ev));
+}
+
+bool sched_take(SchedEvent ev, uint32_t now) {
+    uint8_t i = static_cast<uint8_t>(ev);
+    if (!(state.pending & (1 << i)) || !sched_tick_reached(state.due[i], now)) {
+        return false;
+    }
+    state.pending &= ~(1 << i);
+    return true;
+}
+
+void sched_arm() {
+    if (state.pending == 0) {
+        return;
+    }
+
+    // Find earliest deadline relative to now (wrap-safe)
+    uint32_t now = rtc_get_ticks();
+    uint32_t earliest = 0;
+    int32_t earliest_delta = INT32_MAX;
+    for (uint8_t i = 0; i < NUM_EVENTS; i++) {
+        if (state.pending & (1 << i)) {
+            int32_t delta = (int32_t)(state.due[i] - now);
+            if (delta < earliest_delta) {
+                earliest_delta = delta;
+                earliest = state.due[i];
+            }
+        }
+    }
+
+    rtc_set_wakeup_tick(earliest);
+}
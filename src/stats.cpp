@@ -0,0 +1,98 @@
+/**
+ * @file stats.cpp
+ * @brief Field instrumentation counters implementation
+ */
+
+#include "stats.h"
+
+#if STATS_ENABLE
+
+#include "rtc.h"
+#include "eeprom_config.h"
+#include <string.h>
+
+StatsBlock stats_block;
+
+constexpr uint8_t TOTAL_WORDS = sizeof(StatsTotals) / sizeof(uint32_t);
+
+// Interval start times (low 16 bits of rtc_get_counts(); wakes and rail-on
+// periods are far shorter than the 64 s this covers)
+struct StatsState {
+    uint16_t wake_since;
+    uint16_t rail_since;
+    bool rail_on;
+    uint32_t last_commit_tick;
+};
+
+static StatsState state = {0, 0, false, 0};
+
+/**
+ * Journal every lifetime total (one record per 4-byte word)
+ */
+static void commit_totals() {
+    const uint8_t* words = (const uint8_t*)&stats_block.totals;
+
+    for (uint8_t i = 0; i < TOTAL_WORDS; i++) {
+        uint32_t value;
+        memcpy(&value, words + i * sizeof(value), sizeof(value));
+        eeprom_log_counter(i, value);
+    }
+    stats_block.commits++;
+}
+
+void stats_init() {
+    memset(&stats_block, 0, sizeof(stats_block));
+    stats_block.magic[0] = 'S';
+    stats_block.magic[1] = 'T';
+    stats_block.version = STATS_VERSION;
+    stats_block.size = sizeof(StatsBlock);
+
+    // Continue from the last commit (counts since then are lost on reset)
+    uint8_t* words = (uint8_t*)&stats_block.totals;
+    for (uint8_t i = 0; i < TOTAL_WORDS; i++) {
+        uint32_t value;
+        if (eeprom_get_counter(i, &value)) {
+            memcpy(words + i * sizeof(value), &value, sizeof(value));
+        }
+    }
+
+    state.rail_on = false;
+    state.last_commit_tick = rtc_get_ticks();
+    stats_wake_begin();
+}
+
+void stats_wake_begin() {
+    state.wake_since = (uint16_t)rtc_get_counts();
+    stats_block.totals.wakes++;
+}
+
+void stats_wake_end(uint32_t tick) {
+    uint16_t awake = (uint16_t)rtc_get_counts() - state.wake_since;
+
+    stats_block.totals.awake_counts += awake;
+    stats_block.last_awake_counts = awake;
+    if (awake > stats_block.max_awake_counts) {
+        stats_block.max_awake_counts = awake;
+    }
+
+    if (tick - state.last_commit_tick >= STATS_COMMIT_SEC) {
+        state.last_commit_tick = tick;
+        commit_totals();
+    }
+}
+
+void stats_rail_on() {
+    if (!state.rail_on) {
+        state.rail_on = true;
+        state.rail_since = (uint16_t)rtc_get_counts();
+    }
+}
+
+void stats_rail_off() {
+    if (state.rail_on) {
+        state.rail_on = false;
+        stats_block.totals.rail_counts += (uint16_t)((uint16_t)rtc_get_counts() - state.rail_since);
+    }
+}
+
+#endif
@@ -4,15 +4,54 @@
  *
  * ATtiny202 hardware TWI only works on PA1/PA2, but our hardware uses PA6/PA7.
  * This implements I2C in software by manually toggling the pins.
+ *
+ * Edge timing is cycle-counted at compile time from F_CPU (see TWI_FAST_MODE).
+ * Clock stretching is honoured: after releasing SCL we wait for the line to
+ * actually go high, bounded by the transaction's timeout_ms.
  */
 
 #include "twi.h"
 #include "pins.hpp"
+#include "stats.h"
+#include "trace.h"
 #include <avr/io.h>
 #include <util/delay.h>
 
-// I2C timing for ~100 kHz (5us half-period = 10us full period = 100kHz)
-#define I2C_DELAY_US 5
+#ifndef F_CPU
+#error "F_CPU must be defined for I2C edge timing"
+#endif
+
+// I2C bus timing minimums (nanoseconds)
+#if TWI_FAST_MODE
+constexpr uint32_t I2C_T_LOW_NS  = 1300;  // Fast-mode (400 kHz) SCL low
+constexpr uint32_t I2C_T_HIGH_NS = 600;   // Fast-mode (400 kHz) SCL high
+#else
+constexpr uint32_t I2C_T_LOW_NS  = 4700;  // Standard-mode (100 kHz) SCL low
+constexpr uint32_t I2C_T_HIGH_NS = 4000;  // Standard-mode (100 kHz) SCL high
+#endif
+
+// Cycles already spent per half-period on pin writes and bit bookkeeping
+constexpr uint32_t I2C_EDGE_OVERHEAD_CYCLES = 4;
+
+static constexpr uint32_t ns_to_cycles(uint32_t ns) {
+    return ((F_CPU / 1000000UL) * ns + 999) / 1000;  // Round up
+}
+
+static constexpr uint32_t ns_to_delay_cycles(uint32_t ns) {
+    return ns_to_cycles(ns) > I2C_EDGE_OVERHEAD_CYCLES
+         ? ns_to_cycles(ns) - I2C_EDGE_OVERHEAD_CYCLES
+         : 0;
+}
+
+constexpr uint32_t I2C_LOW_CYCLES  = ns_to_delay_cycles(I2C_T_LOW_NS);
+constexpr uint32_t I2C_HIGH_CYCLES = ns_to_delay_cycles(I2C_T_HIGH_NS);
+
+static inline void delay_low()  { __builtin_avr_delay_cycles(I2C_LOW_CYCLES); }
+static inline void delay_high() { __builtin_avr_delay_cycles(I2C_HIGH_CYCLES); }
+
+// Clock-stretch budget for the current transaction (in ~1 us polls)
+constexpr uint32_t STRETCH_UNLIMITED = 0xFFFFFFFF;
+static uint32_t stretch_budget_us = STRETCH_UNLIMITED;
 
 // Software I2C pin control
 // To drive low: set as output (DIRSET), pin will output 0
@@ -22,17 +61,41 @@ static inline void sda_high() { PORTA.DIRCLR = pins::SDA; }
 static inline void scl_low()  { PORTA.DIRSET = pins::SCL; }
 static inline void scl_high() { PORTA.DIRCLR = pins::SCL; }
 static inline bool sda_read() { return (PORTA.IN & pins::SDA) != 0; }
+static inline bool scl_read() { return (PORTA.IN & pins::SCL) != 0; }
+
+// Start the timeout budget for a transaction (0 = no timeout)
+static void stretch_budget_start(uint16_t timeout_ms)
+{
+    stretch_budget_us = timeout_ms ? (uint32_t)timeout_ms * 1000 : STRETCH_UNLIMITED;
+}
+
+// Release SCL and wait for it to go high (slave may hold it low to stretch)
+// Returns false if the timeout budget runs out
+static bool scl_release()
+{
+    scl_high();
+    while (!scl_read())
+    {
+        if (stretch_budget_us == 0)
+            return false;
+        if (stretch_budget_us != STRETCH_UNLIMITED)
+            stretch_budget_us--;
+        _delay_us(1);
+    }
+    return true;
+}
 
 // I2C START condition: SDA falls while SCL is high
-static void i2c_start()
+static bool i2c_start()
 {
     sda_high();
-    scl_high();
-    _delay_us(I2C_DELAY_US);
+    if (!scl_release())
+        return false;
+    delay_low();  // Bus free / repeated-start setup time
     sda_low();
-    _delay_us(I2C_DELAY_US);
+    delay_high();
     scl_low();
-    _delay_us(I2C_DELAY_US);
+    return true;
 }
 
 // I2C STOP condition: SDA rises while SCL is high
@@ -40,15 +103,15 @@ static void i2c_stop()
 {
     sda_low();
     scl_low();
-    _delay_us(I2C_DELAY_US);
-    scl_high();
-    _delay_us(I2C_DELAY_US);
+    delay_low();
+    scl_release();
+    delay_high();
     sda_high();
-    _delay_us(I2C_DELAY_US);
+    delay_low();  // Bus free time before next START
 }
 
-// Write one byte, return true if ACK received
-static bool i2c_write_byte(uint8_t byte)
+// Write one byte, return OK if ACK received
+static TwiStatus i2c_write_byte(uint8_t byte)
 {
     // Write 8 data bits
     for (uint8_t i = 0; i < 8; i++)
@@ -59,41 +122,43 @@ static bool i2c_write_byte(uint8_t byte)
             sda_low();
 
         byte <<= 1;
-        _delay_us(I2C_DELAY_US);
-        scl_high();
-        _delay_us(I2C_DELAY_US);
+        delay_low();
+        if (!scl_release())
+            return TwiStatus::TIMEOUT;
+        delay_high();
         scl_low();
     }
 
     // Read ACK bit
     sda_high();  // Release SDA
-    _delay_us(I2C_DELAY_US);
-    scl_high();
-    _delay_us(I2C_DELAY_US);
+    delay_low();
+    if (!scl_release())
+        return TwiStatus::TIMEOUT;
+    delay_high();
     bool ack = !sda_read();  // ACK=0, NACK=1
     scl_low();
-    _delay_us(I2C_DELAY_US);
 
-    return ack;
+    return ack ? TwiStatus::OK : TwiStatus::NACK;
 }
 
 // Read one byte, send ACK if send_ack=true
-static uint8_t i2c_read_byte(bool send_ack)
+static TwiStatus i2c_read_byte(uint8_t *byte, bool send_ack)
 {
-    uint8_t byte = 0;
+    uint8_t value = 0;
 
     sda_high();  // Release SDA for reading
 
     // Read 8 data bits
     for (uint8_t i = 0; i < 8; i++)
     {
-        byte <<= 1;
-        _delay_us(I2C_DELAY_US);
-        scl_high();
-        _delay_us(I2C_DELAY_US);
+        value <<= 1;
+        delay_low();
+        if (!scl_release())
+            return TwiStatus::TIMEOUT;
+        delay_high();
 
         if (sda_read())
-            byte |= 1;
+            value |= 1;
 
         scl_low();
     }
@@ -104,25 +169,27 @@ static uint8_t i2c_read_byte(bool send_ack)
     else
         sda_high();  // NACK
 
-    _delay_us(I2C_DELAY_US);
-    scl_high();
-    _delay_us(I2C_DELAY_US);
+    delay_low();
+    if (!scl_release())
+        return TwiStatus::TIMEOUT;
+    delay_high();
     scl_low();
-    _delay_us(I2C_DELAY_US);
     sda_high();  // Release
 
-    return byte;
+    *byte = value;
+    return TwiStatus::OK;
 }
 
 void twi_init()
 {
+    trace_phase(TracePhase::TWI_INIT);
+
     // Configure pins as inputs (external pull-ups will pull high)
     // Ensure output registers are 0 so when we set DIRSET, pin drives low
     PORTA.OUTCLR = pins::SDA | pins::SCL;
     PORTA.DIRCLR = pins::SDA | pins::SCL;
 
-    // Give bus time to settle
-    _delay_us(50);
+    // No settle delay: twi_probe() waits for the pull-ups and first ACK
 }
 
 void twi_disable()
@@ -131,64 +198,107 @@ void twi_disable()
     PORTA.DIRCLR = pins::SDA | pins::SCL;
 }
 
-TwiStatus twi_write(uint8_t addr, const uint8_t *data, uint8_t len, uint16_t timeout_ms)
+// START, address and data bytes, STOP; *sent = bytes on the bus
+static TwiStatus write_transfer(uint8_t addr, const uint8_t *data, uint8_t len, uint8_t *sent)
 {
-    (void)timeout_ms;  // Timeout not implemented for software I2C
-
     // START condition
-    i2c_start();
-
-    // Send address with write bit (0)
-    if (!i2c_write_byte((addr << 1) | 0))
+    if (!i2c_start())
     {
-        i2c_stop();
-        return TwiStatus::NACK;
+        *sent = 0;
+        return TwiStatus::TIMEOUT;
     }
 
+    // Send address with write bit (0)
+    TwiStatus status = i2c_write_byte((addr << 1) | 0);
+
     // Write data bytes
-    for (uint8_t i = 0; i < len; i++)
-    {
-        if (!i2c_write_byte(data[i]))
-        {
-            i2c_stop();
-            return TwiStatus::NACK;
-        }
-    }
+    uint8_t i = 0;
+    for (; i < len && status == TwiStatus::OK; i++)
+        status = i2c_write_byte(data[i]);
 
     // STOP condition
     i2c_stop();
 
-    return TwiStatus::OK;
+    *sent = 1 + i;
+    return status;
 }
 
-TwiStatus twi_read(uint8_t addr, uint8_t *data, uint8_t len, uint16_t timeout_ms)
+TwiStatus twi_write(uint8_t addr, const uint8_t *data, uint8_t len, uint16_t timeout_ms)
 {
-    (void)timeout_ms;  // Timeout not implemented for software I2C
+    stretch_budget_start(timeout_ms);
 
+    uint8_t sent;
+    TwiStatus status = write_transfer(addr, data, len, &sent);
+
+    stats_i2c(sent, status);
+    return status;
+}
+
+TwiStatus twi_read(uint8_t addr, uint8_t *data, uint8_t len, uint16_t timeout_ms)
+{
     if (len == 0)
         return TwiStatus::OK;
 
-    // START condition
-    i2c_start();
+    stretch_budget_start(timeout_ms);
 
-    // Send address with read bit (1)
-    if (!i2c_write_byte((addr << 1) | 1))
+    // START condition
+    if (!i2c_start())
     {
-        i2c_stop();
-        return TwiStatus::NACK;
+        stats_i2c(0, TwiStatus::TIMEOUT);
+        return TwiStatus::TIMEOUT;
     }
 
+    // Send address with read bit (1)
+    TwiStatus status = i2c_write_byte((addr << 1) | 1);
+
     // Read data bytes
-    for (uint8_t i = 0; i < len; i++)
+    uint8_t i = 0;
+    for (; i < len && status == TwiStatus::OK; i++)
     {
         bool is_last = (i == len - 1);
-        data[i] = i2c_read_byte(!is_last);  // ACK all except last byte
+        status = i2c_read_byte(&data[i], !is_last);  // ACK all except last byte
     }
 
     // STOP condition
     i2c_stop();
 
-    return TwiStatus::OK;
+    stats_i2c(1 + i, status);
+    return status;
+}
+
+TwiStatus twi_probe(uint8_t addr, uint16_t timeout_ms)
+{
+    // 100 us per attempt, worked out in 32 bits and saturated to the 16-bit
+    // counter (about 6.5 s); 0 still makes a single attempt
+    uint32_t wanted = (uint32_t)timeout_ms * 10;
+    uint16_t attempts;
+    if (wanted == 0)
+        attempts = 1;
+    else if (wanted > UINT16_MAX)
+        attempts = UINT16_MAX;
+    else
+        attempts = (uint16_t)wanted;
+
+    do
+    {
+        // Wait for the pull-ups (on VDD_SW) before driving the bus
+        if (scl_read() && sda_read())
+        {
+            uint8_t sent;
+            stretch_budget_start(1);
+            TwiStatus status = write_transfer(addr, nullptr, 0, &sent);
+
+            // A NACK here is the device still in reset, not an error
+            stats_i2c_probe(sent, status);
+            if (status == TwiStatus::OK)
+                return TwiStatus::OK;
+        }
+
+        _delay_us(100);
+    } while (--attempts);
+
+    stats_i2c_probe_failed();
+    return TwiStatus::TIMEOUT;
 }
 
 TwiStatus twi_write_reg(uint8_t addr, uint8_t reg, uint8_t value, uint16_t timeout_ms)
@@ -222,3 +332,24 @@ TwiStatus twi_read_regs(uint8_t addr, uint8_t reg, uint8_t *data, uint8_t len, u
     // Read multiple bytes
     return twi_read(addr, data, len, timeout_ms);
 }
+
+TwiStatus twi_recover()
+{
+    // Short stretch budget: a slave holding SCL low is not recoverable here
+    stretch_budget_start(1);
+
+    sda_high();
+    for (uint8_t i = 0; i < 9 && !sda_read(); i++)
+    {
+        scl_low();
+        delay_low();
+        if (!scl_release())
+            break;
+        delay_high();
+    }
+
+    // STOP ends whatever transfer the slave thought was in progress
+    i2c_stop();
+
+    return (scl_read() && sda_read()) ? TwiStatus::OK : TwiStatus::BUS_ERROR;
+}
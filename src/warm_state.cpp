@@ -0,0 +1,76 @@
+/**
+ * @file warm_state.cpp
+ * @brief Warm-reset state block implementation
+ */
+
+#include "warm_state.h"
+#include "level_logic.h"
+#include "alert_manager.h"
+#include "feature_set.h"
+#include "crc.h"
+#include <avr/io.h>
+#include <stddef.h>
+
+constexpr uint8_t WARM_VERSION = 1;
+
+// Resets that keep SRAM; PORF (RAM lost) and UPDIRF (reprogrammed) do not
+constexpr uint8_t WARM_RESET_FLAGS = RSTCTRL_BORF_bm | RSTCTRL_EXTRF_bm |
+                                     RSTCTRL_WDRF_bm | RSTCTRL_SWRF_bm;
+constexpr uint8_t COLD_RESET_FLAGS = RSTCTRL_PORF_bm | RSTCTRL_UPDIRF_bm;
+
+struct WarmBlock {
+    uint8_t version;
+    uint8_t size;
+    uint8_t resumes;  // Resumes since the last completed wake
+    uint32_t tick;    // Time base of the ticks below
+    LevelWarmState level;
+    AlertWarmState alert;
+    uint16_t crc16;   // CRC-16/XMODEM over the bytes above
+};
+
+static_assert(sizeof(WarmBlock) < 256, "size field is 8 bits");
+
+// Not cleared by the C runtime (garbage after power-on)
+static WarmBlock warm __attribute__((section(".noinit")));
+
+static uint16_t block_crc() {
+    return crc16_xmodem((const uint8_t*)&warm, offsetof(WarmBlock, crc16));
+}
+
+bool warm_check() {
+    uint8_t flags = RSTCTRL.RSTFR;
+    RSTCTRL.RSTFR = flags;  // Write 1 to clear
+
+    bool intact = (flags & WARM_RESET_FLAGS) && !(flags & COLD_RESET_FLAGS) &&
+                  warm.version == WARM_VERSION && warm.size == sizeof(WarmBlock) &&
+                  warm.crc16 == block_crc() && warm.resumes < WARM_MAX_RESUMES;
+    if (!intact) {
+        warm.resumes = 0;  // Cold: the first warm_save() starts a clean block
+    }
+    return intact;
+}
+
+void warm_restore(uint32_t tick) {
+    level_restore_warm(warm.level);
+    if constexpr (features::ALERT_WINDOWS) {
+        alert_restore_warm(warm.alert, tick - warm.tick);
+    }
+
+    // Counted until a wake completes (reset loop)
+    warm.resumes++;
+    warm.crc16 = block_crc();
+}
+
+void warm_save(uint32_t tick, bool wake_complete) {
+    warm.version = WARM_VERSION;
+    warm.size = sizeof(WarmBlock);
+    if (wake_complete) {
+        warm.resumes = 0;
+    }
+    warm.tick = tick;
+    level_save_warm(warm.level);
+    if constexpr (features::ALERT_WINDOWS) {
+        alert_save_warm(warm.alert);
+    }
+    warm.crc16 = block_crc();
+}